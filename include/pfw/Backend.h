@@ -0,0 +1,35 @@
+#ifndef PFW_BACKEND_H
+#define PFW_BACKEND_H
+
+#include <filesystem>
+#include <vector>
+
+#include "pfw/Filter.h"
+
+namespace pfw {
+
+/**
+ * The interface every file system observation service implements. A
+ * backend reports its events to the Filter it has been created with.
+ */
+class Backend
+{
+  public:
+    virtual ~Backend() {}
+
+    virtual bool isWatching() = 0;
+
+    /**
+     * Applies the options which have been set on the Filter already,
+     * `previous` allows to compute the difference.
+     */
+    virtual void applyFilterOptions(const FilterOptions &previous) = 0;
+
+    virtual bool addRoot(const std::filesystem::path &path)    = 0;
+    virtual bool removeRoot(const std::filesystem::path &path) = 0;
+    virtual std::vector<std::filesystem::path> roots()         = 0;
+};
+
+}  // namespace pfw
+
+#endif /* PFW_BACKEND_H */
@@ -0,0 +1,74 @@
+#ifndef PFW_BACKEND_REGISTRY_H
+#define PFW_BACKEND_REGISTRY_H
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "pfw/Backend.h"
+#include "pfw/Filter.h"
+
+namespace pfw {
+
+/**
+ * Maps backend names to factories, so that the backend of a watcher can be
+ * chosen at runtime. The backends available on the platform are registered
+ * on first use, further ones can be added by the application.
+ */
+class BackendRegistry
+{
+  public:
+    using Factory = std::function<std::unique_ptr<Backend>(
+        std::shared_ptr<Filter>, const std::filesystem::path &,
+        std::chrono::milliseconds)>;
+
+    // probes the file system under the root for the cheapest backend
+    static constexpr const char *AUTO = "auto";
+    // the notification service of the operating system
+    static constexpr const char *NATIVE   = "native";
+    static constexpr const char *INOTIFY  = "inotify";
+    // falls back to inotify without the required capabilities
+    static constexpr const char *FANOTIFY = "fanotify";
+    static constexpr const char *FSEVENTS = "fsevents";
+    static constexpr const char *WINDOWS  = "windows";
+    static constexpr const char *POLLING  = "polling";
+    // an in-memory backend which only delivers injected events
+    static constexpr const char *REPLAY = "replay";
+
+    static BackendRegistry &instance();
+
+    void registerBackend(const std::string &name, Factory factory);
+    bool contains(const std::string &name);
+    std::vector<std::string> names();
+
+    /**
+     * Resolves `AUTO` and `NATIVE` to the name of a registered backend.
+     */
+    std::string resolve(const std::string &          name,
+                        const std::filesystem::path &root);
+
+    /**
+     * \return the backend or nullptr if the name is unknown
+     */
+    std::unique_ptr<Backend> create(const std::string &             name,
+                                    std::shared_ptr<Filter>         filter,
+                                    const std::filesystem::path &   path,
+                                    const std::chrono::milliseconds latency);
+
+  private:
+    BackendRegistry();
+
+    static std::string nativeName();
+
+    std::mutex                     mMutex;
+    std::map<std::string, Factory> mFactories;
+};
+
+}  // namespace pfw
+
+#endif /* PFW_BACKEND_REGISTRY_H */
@@ -0,0 +1,342 @@
+#ifndef PFW_BASIC_FILESYSTEM_WATCHER_H
+#define PFW_BASIC_FILESYSTEM_WATCHER_H
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <numeric>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "pfw/BackendRegistry.h"
+#include "pfw/Dispatcher.h"
+#include "pfw/NativeInterface.h"
+#include "pfw/StormSummarizer.h"
+
+namespace pfw {
+
+/**
+ * The stages of a BasicFileSystemWatcher which are chosen at compile time.
+ * They run on the delivering thread after the runtime stages of the Filter,
+ * one batch at a time, as the callback the Filter invokes.
+ */
+namespace policy {
+
+// the backend, by its name in the BackendRegistry; an explicit
+// `WatcherOptions::backend` takes precedence
+struct AutoBackend {
+    static constexpr const char *name = BackendRegistry::AUTO;
+};
+struct NativeBackend {
+    static constexpr const char *name = BackendRegistry::NATIVE;
+};
+struct PollingBackend {
+    static constexpr const char *name = BackendRegistry::POLLING;
+};
+struct ReplayBackend {
+    static constexpr const char *name = BackendRegistry::REPLAY;
+};
+
+struct NoCoalescing {
+    void operator()(std::vector<EventPtr> &) {}
+};
+
+/**
+ * Merges the events of the same path into the last of them, as the
+ * collectors of the native backends do. Useful for the backends which do not
+ * batch their events, like polling. The buffer is reused across batches.
+ */
+class PathCoalescing
+{
+  public:
+    void operator()(std::vector<EventPtr> &events)
+    {
+        mOrder.resize(events.size());
+        std::iota(mOrder.begin(), mOrder.end(), size_t(0));
+        std::stable_sort(mOrder.begin(), mOrder.end(),
+                         [&](size_t lhs, size_t rhs) {
+                             const auto &l = *events[lhs];
+                             const auto &r = *events[rhs];
+                             return l.root != r.root
+                                        ? l.root < r.root
+                                        : l.relativePath < r.relativePath;
+                         });
+
+        for (size_t end = mOrder.size(); end > 0;) {
+            auto &kept  = events[mOrder[end - 1]];
+            auto  begin = end - 1;
+            for (; begin > 0; --begin) {
+                auto &event = events[mOrder[begin - 1]];
+                if (event->root != kept->root ||
+                    event->relativePath != kept->relativePath) {
+                    break;
+                }
+                kept->type = kept->type | event->type;
+                if (kept->previousPath.empty()) {
+                    kept->previousPath = std::move(event->previousPath);
+                }
+                event.reset();
+            }
+            end = begin;
+        }
+
+        events.erase(std::remove(events.begin(), events.end(), nullptr),
+                     events.end());
+    }
+
+  private:
+    std::vector<size_t> mOrder;
+};
+
+// see StormSummarizer
+template <size_t Threshold>
+struct StormSummarizing {
+    void operator()(std::vector<EventPtr> &events)
+    {
+        StormSummarizer::summarize(events, Threshold);
+    }
+};
+
+// applies several coalescers in order
+template <class... Coalescers>
+class Coalescing
+{
+  public:
+    void operator()(std::vector<EventPtr> &events)
+    {
+        std::apply([&](auto &... stage) { (stage(events), ...); }, mStages);
+    }
+
+  private:
+    std::tuple<Coalescers...> mStages;
+};
+
+struct InlineDispatch {
+    template <class Batch, class Handler>
+    void operator()(Batch &&batch, Handler &handler)
+    {
+        handler(std::move(batch));
+    }
+};
+
+// invokes the handler in parallel, see pfw::Dispatcher
+template <size_t Concurrency,
+          pfw::Dispatcher::Partition Partition = pfw::Dispatcher::BY_PATH>
+class ParallelDispatch
+{
+  public:
+    ParallelDispatch()
+        : mDispatcher(Concurrency, Partition)
+    {
+    }
+
+    template <class Batch, class Handler>
+    void operator()(Batch &&batch, Handler &handler)
+    {
+        static_assert(std::is_same<std::decay_t<Batch>,
+                                   std::vector<EventPtr>>::value,
+                      "the parallel dispatch requires the default allocator");
+        mDispatcher.dispatch(std::move(batch),
+                             [&handler](std::vector<EventPtr> &&shard) {
+                                 handler(std::move(shard));
+                             });
+    }
+
+  private:
+    pfw::Dispatcher mDispatcher;
+};
+
+}  // namespace policy
+
+namespace detail {
+
+// initialized before the NativeInterface, which might deliver events while
+// it is constructed
+template <class Coalescer, class Dispatcher, class Allocator, class Handler>
+class WatcherStages
+{
+  public:
+    using Batch = std::vector<EventPtr, Allocator>;
+
+    // the default stages hand the callback to the Filter as it is
+    static constexpr bool isPassThrough =
+        std::is_same<Coalescer, policy::NoCoalescing>::value &&
+        std::is_same<Dispatcher, policy::InlineDispatch>::value &&
+        std::is_same<Batch, std::vector<EventPtr>>::value &&
+        std::is_same<Handler, CallBackSignatur>::value;
+
+    WatcherStages(Handler handler, std::pmr::memory_resource *resource)
+        : mHandler(std::move(handler))
+        , mBuffer(makeBatch(resource))
+    {
+    }
+
+    CallBackSignatur callback()
+    {
+        if constexpr (isPassThrough) {
+            return std::move(mHandler);
+        } else {
+            return [this](std::vector<EventPtr> &&events) {
+                deliver(std::move(events));
+            };
+        }
+    }
+
+  private:
+    // a polymorphic allocator draws from `WatcherOptions::memoryResource`
+    static Batch makeBatch(std::pmr::memory_resource *resource)
+    {
+        using Resource = std::pmr::memory_resource *;
+        if constexpr (std::is_constructible<Allocator, Resource>::value) {
+            return Batch(Allocator(resource != nullptr
+                                       ? resource
+                                       : std::pmr::get_default_resource()));
+        } else {
+            return Batch();
+        }
+    }
+
+    void deliver(std::vector<EventPtr> &&events)
+    {
+        mCoalescer(events);
+        if (events.empty()) {
+            return;
+        }
+
+        if constexpr (std::is_same<Batch, std::vector<EventPtr>>::value) {
+            mDispatcher(std::move(events), mHandler);
+        } else {
+            // reused unless the handler keeps it
+            mBuffer.clear();
+            mBuffer.insert(mBuffer.end(),
+                           std::make_move_iterator(events.begin()),
+                           std::make_move_iterator(events.end()));
+            mDispatcher(std::move(mBuffer), mHandler);
+        }
+    }
+
+    Coalescer  mCoalescer;
+    Dispatcher mDispatcher;
+    Handler    mHandler;
+    Batch      mBuffer;
+};
+
+}  // namespace detail
+
+/**
+ * A watcher with user stages which are chosen at compile time and run after
+ * the Filter has delivered a batch, in place of the callback:
+ *
+ * - `Backend` selects the backend, see `policy::AutoBackend`
+ * - `Coalescer` rewrites each batch in place, see `policy::PathCoalescing`
+ * - `Dispatcher` hands the batch to the handler, see
+ *   `policy::ParallelDispatch`
+ * - `Allocator` allocates the batches the handler receives; a
+ *   `std::pmr::polymorphic_allocator` draws from
+ *   `WatcherOptions::memoryResource`, see PmrFileSystemWatcher
+ * - `Handler` is invoked with each batch
+ *
+ * The stages add to the runtime path of the Filter, they do not replace it.
+ * As they keep state across batches, they are invoked for one batch at a
+ * time: `WatcherOptions::dispatchConcurrency` is ignored unless the stages
+ * pass the callback through, `policy::ParallelDispatch` parallelizes the
+ * handler instead.
+ *
+ * FileSystemWatcher is the default instantiation, which hands the callback
+ * to the Filter without any additional stage.
+ */
+template <class Backend    = policy::AutoBackend,
+          class Coalescer  = policy::NoCoalescing,
+          class Dispatcher = policy::InlineDispatch,
+          class Allocator  = std::allocator<EventPtr>,
+          class Handler =
+              std::function<void(std::vector<EventPtr, Allocator> &&)>>
+class BasicFileSystemWatcher
+    : private detail::WatcherStages<Coalescer, Dispatcher, Allocator, Handler>
+    , public NativeInterface
+{
+    using Stages =
+        detail::WatcherStages<Coalescer, Dispatcher, Allocator, Handler>;
+
+  public:
+    BasicFileSystemWatcher(const fs::path &          path,
+                           std::chrono::milliseconds sleepDuration,
+                           Handler                   handler,
+                           WatcherOptions            options = {})
+        : Stages(std::move(handler), options.memoryResource)
+        , NativeInterface(path,
+                          sleepDuration,
+                          Stages::callback(),
+                          withBackend(std::move(options)))
+    {
+    }
+
+    BasicFileSystemWatcher(const std::vector<fs::path> &paths,
+                           std::chrono::milliseconds    sleepDuration,
+                           Handler                      handler,
+                           WatcherOptions               options = {})
+        : Stages(std::move(handler), options.memoryResource)
+        , NativeInterface(paths,
+                          sleepDuration,
+                          Stages::callback(),
+                          withBackend(std::move(options)))
+    {
+    }
+
+    /**
+     * Queues the events instead of invoking a handler, see
+     * `NativeInterface::eventQueue()`. Only available with the default
+     * stages.
+     */
+    template <bool PassThrough                   = Stages::isPassThrough,
+              std::enable_if_t<PassThrough, int> = 0>
+    BasicFileSystemWatcher(const fs::path &          path,
+                           std::chrono::milliseconds sleepDuration,
+                           WatcherOptions            options = {})
+        : Stages(Handler(), options.memoryResource)
+        , NativeInterface(path, sleepDuration, withBackend(std::move(options)))
+    {
+    }
+
+    template <bool PassThrough                   = Stages::isPassThrough,
+              std::enable_if_t<PassThrough, int> = 0>
+    BasicFileSystemWatcher(const std::vector<fs::path> &paths,
+                           std::chrono::milliseconds    sleepDuration,
+                           WatcherOptions               options = {})
+        : Stages(Handler(), options.memoryResource)
+        , NativeInterface(paths, sleepDuration, withBackend(std::move(options)))
+    {
+    }
+
+  private:
+    static WatcherOptions withBackend(WatcherOptions options)
+    {
+        if (options.backend == BackendRegistry::AUTO) {
+            options.backend = Backend::name;
+        }
+        // the stages are not reentrant
+        if (!Stages::isPassThrough) {
+            options.dispatchConcurrency = 1;
+        }
+        return options;
+    }
+};
+
+/**
+ * Hands the batches to the handler in a buffer from
+ * `WatcherOptions::memoryResource`, which is reused as long as the handler
+ * does not keep it.
+ */
+using PmrFileSystemWatcher =
+    BasicFileSystemWatcher<policy::AutoBackend,
+                           policy::NoCoalescing,
+                           policy::InlineDispatch,
+                           std::pmr::polymorphic_allocator<EventPtr>>;
+
+}  // namespace pfw
+
+#endif /* PFW_BASIC_FILESYSTEM_WATCHER_H */
@@ -0,0 +1,84 @@
+#ifndef PFW_CHANGE_INDEX_H
+#define PFW_CHANGE_INDEX_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "pfw/Event.h"
+
+namespace pfw {
+
+/**
+ * A position in the ChangeIndex. It is only meaningful for the index which
+ * handed it out, a token of a previous watcher is answered with a fresh
+ * instance.
+ */
+struct ChangeToken {
+    uint64_t instance = 0;
+    uint64_t clock    = 0;
+};
+
+struct Changes {
+    // the changes since the token are unknown, either because the token is
+    // too old, belongs to another instance, or events have been lost; the
+    // consumer has to treat every path as changed
+    bool isFreshInstance = false;
+    // the token to ask with next time
+    ChangeToken token;
+    // one event per changed path, carrying every type the path changed by
+    // since the token, e.g. CREATED | MODIFIED for a new file written to
+    std::vector<EventPtr> events;
+};
+
+/**
+ * Remembers the paths which changed recently, ordered by a logical clock
+ * which advances with every event. Any number of consumers is able to ask
+ * for the changes since their last token without buffering events
+ * themselves. The index is bounded, the least recently changed paths are
+ * forgotten first.
+ */
+class ChangeIndex
+{
+  public:
+    explicit ChangeIndex(size_t maxPaths);
+
+    void add(const std::vector<EventPtr> &events);
+
+    ChangeToken token();
+
+    /**
+     * \return the deduplicated changes since the token
+     */
+    Changes changesSince(const ChangeToken &token);
+
+  private:
+    using Key = std::pair<fs::path, fs::path>;
+
+    struct Entry {
+        uint64_t clock;
+        // the clock each bit of the type has been recorded at last
+        std::array<uint64_t, 8 * sizeof(EventType)> typeClocks;
+    };
+    using Paths = std::map<Key, Entry>;
+
+    void record(const fs::path &root,
+                const fs::path &relativePath,
+                EventType       type);
+
+    const size_t   mMaxPaths;
+    const uint64_t mInstance;
+    std::mutex     mMutex;
+    uint64_t       mClock;
+    // tokens before this clock can not be answered anymore
+    uint64_t                            mOldestClock;
+    Paths                               mPaths;
+    std::map<uint64_t, Paths::iterator> mByClock;
+};
+
+}  // namespace pfw
+
+#endif /* PFW_CHANGE_INDEX_H */
@@ -0,0 +1,112 @@
+#ifndef PFW_DIGEST_CACHE_H
+#define PFW_DIGEST_CACHE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "pfw/Event.h"
+
+namespace pfw {
+
+/**
+ * Keeps a digest of the content of every file which has been reported, so
+ * that a modification which did not change the content is not delivered,
+ * e.g. the one of `touch`, `chmod` or a tool rewriting a file identically.
+ *
+ * The digest is only computed again if the (inode, size, mtime) of the file
+ * changed. A file is hashed the first time it is created or modified, that
+ * event is always delivered.
+ *
+ * Hashing blocks the thread delivering the batch. The time it takes is
+ * bounded by a budget of bytes per batch: the files beyond it are delivered
+ * without a digest and hashed again with their next event.
+ */
+class DigestCache
+{
+  public:
+    static constexpr uint64_t DEFAULT_HASH_BUDGET = 64 << 20;
+
+    /**
+     * \param concurrency the number of threads hashing a batch; the calling
+     *        thread is one of them, the others are kept by the cache
+     * \param hashBudget the number of bytes hashed per batch at most
+     */
+    explicit DigestCache(size_t   concurrency = 1,
+                         size_t   maxFiles    = 1 << 20,
+                         uint64_t hashBudget  = DEFAULT_HASH_BUDGET);
+    ~DigestCache();
+
+    DigestCache(const DigestCache &) = delete;
+    DigestCache &operator=(const DigestCache &) = delete;
+
+    /**
+     * Attaches the digest to the events of regular files and removes the
+     * `MODIFIED` events whose content did not change. It returns once the
+     * files within the hash budget are hashed.
+     */
+    void apply(std::vector<EventPtr> &events);
+
+    /**
+     * XXH64 of the data with a seed of 0.
+     */
+    static uint64_t hash(const char *data, size_t size);
+
+    /**
+     * \return false if the file could not be read
+     */
+    static bool hashFile(const std::filesystem::path &path, uint64_t &digest);
+
+  private:
+    using Key = std::filesystem::path::string_type;
+
+    struct Entry {
+        uint64_t inode;
+        uint64_t size;
+        int64_t  mtime;
+        // the time the digest has been computed at
+        int64_t  hashed;
+        uint64_t digest;
+    };
+
+    // the state of an event while it is processed
+    struct Pending {
+        Event *    event{nullptr};
+        Key        key;
+        FileStatus status{};
+        bool       known{false};
+        Entry      previous{};
+        bool       needsHash{false};
+        bool       isReadable{false};
+        uint64_t   digest{0};
+    };
+
+    // hashes files of the current batch until none is left
+    void work(std::unique_lock<std::mutex> &lock);
+    void run();
+
+    const size_t                   mMaxFiles;
+    const uint64_t                 mHashBudget;
+    std::mutex                     mMutex;
+    std::unordered_map<Key, Entry> mFiles;
+
+    // the batches are hashed one after another by the pool
+    std::mutex               mBatchMutex;
+    std::vector<std::thread> mWorkers;
+    std::mutex               mWorkMutex;
+    std::condition_variable  mWorkAvailable;
+    std::condition_variable  mBatchDone;
+    std::vector<Pending> *   mBatch;
+    size_t                   mNextFile;
+    size_t                   mRunningFiles;
+    bool                     mIsStopping;
+};
+
+}  // namespace pfw
+
+#endif /* PFW_DIGEST_CACHE_H */
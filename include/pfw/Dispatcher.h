@@ -0,0 +1,79 @@
+#ifndef PFW_DISPATCHER_H
+#define PFW_DISPATCHER_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "pfw/Event.h"
+
+namespace pfw {
+
+/**
+ * Splits each delivered batch into shards which are handed to the callback
+ * in parallel by a pool of workers. The events of a path always end up in
+ * the same shard, so their order is kept, and a batch is completed before
+ * the next one is dispatched. The paths a rename links within a batch share
+ * a shard as well, so that both keep their order relative to the rename.
+ */
+class Dispatcher
+{
+  public:
+    enum Partition {
+        // the shard is chosen by the hash of the path
+        BY_PATH,
+        // every event below a top level directory ends up in the same
+        // shard, so that the order within a subtree is kept as well
+        BY_TOP_LEVEL_DIRECTORY
+    };
+    using Callback = std::function<void(std::vector<EventPtr> &&)>;
+
+    /**
+     * \param concurrency the number of shards; the calling thread handles
+     *        one of them, the workers the others
+     */
+    explicit Dispatcher(size_t concurrency, Partition partition = BY_PATH);
+    ~Dispatcher();
+
+    Dispatcher(const Dispatcher &) = delete;
+    Dispatcher &operator=(const Dispatcher &) = delete;
+
+    /**
+     * Invokes the callback for each non-empty shard and returns once every
+     * invocation is done.
+     */
+    void dispatch(std::vector<EventPtr> &&events, const Callback &callback);
+
+    /**
+     * \return the shard the event is dispatched to on its own, unless a
+     *         rename links it to another path
+     */
+    static size_t shard(const Event &event, Partition partition, size_t shards);
+
+  private:
+    // the part of the relative path the shard is chosen by
+    static fs::path keyOf(const fs::path &relativePath, Partition partition);
+    static size_t
+    shard(const fs::path &root, const fs::path &key, size_t shards);
+
+    // handles shards of the current batch until none is left
+    void work(std::unique_lock<std::mutex> &lock);
+    void run();
+
+    const Partition                    mPartition;
+    std::vector<std::thread>           mWorkers;
+    std::mutex                         mMutex;
+    std::condition_variable            mWorkAvailable;
+    std::condition_variable            mBatchDone;
+    std::vector<std::vector<EventPtr>> mShards;
+    size_t                             mNextShard;
+    size_t                             mRunningShards;
+    const Callback *                   mCallback;
+    bool                               mIsStopping;
+};
+
+}  // namespace pfw
+
+#endif /* PFW_DISPATCHER_H */
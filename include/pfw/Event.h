@@ -1,7 +1,11 @@
 #ifndef PFW_EVENT_H
 #define PFW_EVENT_H
 
+#include <cstdint>
 #include <filesystem>
+#include <optional>
+
+#include "pfw/FileStatus.h"
 
 namespace pfw {
 
@@ -14,7 +18,10 @@ enum EventType : uint8_t {
     DELETED         = 0b00000100,
     RENAMED         = 0b00001000,
     BUFFER_OVERFLOW = 0b00010000,
-    FAILED          = 0b00100000
+    FAILED          = 0b00100000,
+    // stands for many changes below the directory, which has to be scanned
+    // again; combined with MODIFIED or DELETED
+    SUBTREE         = 0b01000000
 };
 
 inline bool noop(EventType eventType) { return eventType == EventType::NOOP; }
@@ -50,6 +57,11 @@ inline bool failed(EventType eventType)
     return (eventType & EventType::FAILED) == EventType::FAILED;
 }
 
+inline bool subtree(EventType eventType)
+{
+    return (eventType & EventType::SUBTREE) == EventType::SUBTREE;
+}
+
 inline EventType operator|(EventType lhs, EventType rhs)
 {
     return static_cast<EventType>(static_cast<uint8_t>(lhs) |
@@ -67,16 +79,33 @@ inline EventType operator~(EventType lhs)
 }
 
 struct Event {
-    Event(const EventType type, const fs::path &relativePath)
+    Event(const EventType type,
+          const fs::path &relativePath,
+          const fs::path &root = fs::path())
         : type(type)
         , relativePath(relativePath)
+        , root(root)
+        , sequence(0)
     {
         timePoint = std::chrono::high_resolution_clock::now();
     }
 
-    EventType                                      type;
-    fs::path                          relativePath;
+    EventType type;
+    fs::path  relativePath;
+    // the watched root the relative path belongs to
+    fs::path                                       root;
     std::chrono::high_resolution_clock::time_point timePoint;
+    // the relative path before a rename, if `WatcherOptions::combineRenames`
+    // reports it as a single `RENAMED` event instead of a pair
+    fs::path previousPath;
+    // the position in the EventJournal, 0 if no journal is configured
+    uint64_t sequence;
+    // the status of the path once the event has been collected, only set if
+    // `WatcherOptions::statEvents` is enabled and the path still exists
+    std::optional<FileStatus> status;
+    // the digest of the content of a regular file, only set if
+    // `WatcherOptions::digestContents` is enabled
+    std::optional<uint64_t> digest;
 };
 using EventPtr = std::unique_ptr<Event>;
 
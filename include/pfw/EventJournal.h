@@ -0,0 +1,137 @@
+#ifndef PFW_EVENT_JOURNAL_H
+#define PFW_EVENT_JOURNAL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pfw/Event.h"
+
+namespace pfw {
+
+struct JournalOptions {
+    // a new segment is started once the current one exceeds this size
+    size_t segmentSize = 16 * 1024 * 1024;
+    // the oldest segments are pruned beyond this total size or age
+    size_t               maxSize = 256 * 1024 * 1024;
+    std::chrono::seconds maxAge  = std::chrono::hours(24 * 7);
+    // appended events are written and synced to disk at this interval
+    std::chrono::milliseconds syncInterval = std::chrono::milliseconds(200);
+};
+
+/**
+ * An append-only log of the delivered events, which gives every event a
+ * monotonically increasing sequence number. A consumer which remembers the
+ * last sequence number it has processed is able to resume from there after
+ * a crash, as long as the segment containing it is still retained.
+ *
+ * The log is split into segment files named after their first sequence
+ * number. Each batch is written as one checksummed frame; paths are front
+ * coded against their predecessor and numbers are stored as varints. A torn
+ * frame at the end of the log is discarded on startup. Appending only
+ * buffers the batch, a background thread writes and syncs it periodically.
+ *
+ * Sequence numbers are never handed out twice, even if their events were
+ * lost in a crash before being synced: a range of them is reserved durably
+ * in advance, and numbering continues past that range after a crash.
+ */
+class EventJournal
+{
+  public:
+    EventJournal(const std::filesystem::path &directory,
+                 JournalOptions               options = JournalOptions());
+    ~EventJournal();
+
+    bool isValid();
+
+    /**
+     * Assigns the next sequence numbers to the events and appends them.
+     */
+    void append(std::vector<EventPtr> &events);
+
+    /**
+     * Reads the retained events with a sequence number greater than
+     * `sequence`, including the ones which are not written yet.
+     *
+     * \return false if some of these events have been pruned already, `out`
+     *         contains the retained ones then
+     */
+    bool readSince(uint64_t sequence, std::vector<EventPtr> &out);
+
+    /**
+     * \return the sequence number of the oldest retained event, or the next
+     *         one if the journal is empty
+     */
+    uint64_t firstSequence();
+    uint64_t lastSequence();
+
+    /**
+     * Writes the buffered events and syncs them to disk.
+     */
+    bool flush();
+
+  private:
+    struct Segment {
+        uint64_t              firstSequence;
+        std::filesystem::path path;
+        size_t                size;
+    };
+
+    // the following require mFileMutex
+    bool writeBuffer();
+    bool sync();
+    bool openSegment(uint64_t firstSequence);
+    void prune();
+    void syncLoop();
+
+    // requires mMutex, unless called from the constructor
+    bool reserveSequences(uint64_t limit);
+
+    static bool fsyncFile(std::FILE *file);
+
+    static bool readSegment(const std::filesystem::path &path,
+                            uint64_t                     after,
+                            std::vector<EventPtr> *      out,
+                            uint64_t &                   lastSequence,
+                            size_t &                     validSize);
+    static void encode(const std::vector<EventPtr> &events,
+                       uint64_t                     firstSequence,
+                       std::string &                out);
+    static bool decode(const char *           data,
+                       size_t                 size,
+                       uint64_t               after,
+                       std::vector<EventPtr> *out,
+                       uint64_t &             lastSequence);
+
+    std::filesystem::path mDirectory;
+    JournalOptions        mOptions;
+
+    // guards the appended frames; it is never held while the file is
+    // written, and taken after mFileMutex
+    std::mutex              mMutex;
+    std::condition_variable mCondition;
+    std::thread             mSyncThread;
+    bool                    mStopped;
+    bool                    mIsValid;
+    bool                    mDirty;
+    std::string             mBuffer;
+    uint64_t                mNextSequence;
+    // the handed out sequence numbers are below it, it is durable
+    uint64_t mReservedSequence;
+
+    // guards the segments and the file
+    std::mutex           mFileMutex;
+    std::vector<Segment> mSegments;
+    std::FILE *          mFile;
+    std::string          mWriteBuffer;
+};
+
+}  // namespace pfw
+
+#endif /* PFW_EVENT_JOURNAL_H */
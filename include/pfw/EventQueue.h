@@ -0,0 +1,65 @@
+#ifndef PFW_EVENT_QUEUE_H
+#define PFW_EVENT_QUEUE_H
+
+#include <mutex>
+#include <vector>
+
+#include "pfw/Event.h"
+
+namespace pfw {
+
+/**
+ * Hands the delivered events over to a thread of the consumer instead of
+ * invoking a callback. The descriptor of `fd()` is readable as long as
+ * events are queued, so that it is able to join the `epoll()`, `poll()` or
+ * `select()` loop of the consumer, which fetches them with `poll()`.
+ *
+ * Linux signals with an eventfd, the other POSIX systems with a pipe. On
+ * Windows there is no descriptor and the queue has to be polled.
+ *
+ * Once a consumer falls `capacity` events behind, its queued events are
+ * replaced by a `BUFFER_OVERFLOW` event for each of their roots.
+ */
+class EventQueue
+{
+  public:
+    explicit EventQueue(size_t capacity = 1 << 20);
+    ~EventQueue();
+
+    EventQueue(const EventQueue &) = delete;
+    EventQueue &operator=(const EventQueue &) = delete;
+
+    /**
+     * Appends a batch, the events of several batches are handed over
+     * together.
+     */
+    void push(std::vector<EventPtr> &&events);
+
+    /**
+     * Replaces the content of `batch` with every queued event without
+     * blocking. The storage of `batch` is reused for the next events.
+     *
+     * \return false if no event has been queued
+     */
+    bool poll(std::vector<EventPtr> &batch);
+
+    /**
+     * \return the descriptor which is readable while events are queued, or
+     *         -1 if the platform does not provide one
+     */
+    int fd() const;
+
+  private:
+    void signal();
+    void drain();
+
+    const size_t          mCapacity;
+    std::mutex            mMutex;
+    std::vector<EventPtr> mEvents;
+    int                   mReadFd;
+    int                   mWriteFd;
+};
+
+}  // namespace pfw
+
+#endif /* PFW_EVENT_QUEUE_H */
@@ -0,0 +1,159 @@
+#ifndef PFW_EVENT_STREAM_H
+#define PFW_EVENT_STREAM_H
+
+#include "pfw/internal/definitions.h"
+
+#ifdef PFW_COROUTINES
+
+#include <coroutine>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "pfw/Filter.h"
+
+namespace pfw {
+
+/**
+ * Delivers the events of a watcher to a coroutine. The consumer awaits the
+ * next batch with `co_await stream.next()` and is resumed by the delivery of
+ * the watcher itself, on the thread of the collector or on the executor
+ * passed to the constructor. No thread or queue sits in between: the events
+ * which arrive while the consumer is busy are merged into the batch it
+ * receives next.
+ *
+ * Only available if the consumer is compiled with C++20 coroutines. A
+ * stream has a single consumer.
+ *
+ * \code
+ * EventStream       stream;
+ * FileSystemWatcher watcher(path, 100ms, stream.callback());
+ * for (;;) {
+ *     auto batch = co_await stream.next();
+ *     if (batch.empty()) {
+ *         break;
+ *     }
+ *     ...
+ * }
+ * \endcode
+ */
+class EventStream
+{
+  public:
+    // schedules the resumption of the consumer, e.g. on a thread pool
+    using Executor = std::function<void(std::coroutine_handle<>)>;
+
+    /**
+     * \param executor resumes the consumer; by default it is resumed inline,
+     *        in the same context as a callback would be invoked
+     */
+    explicit EventStream(Executor executor = Executor())
+        : mState(std::make_shared<State>())
+    {
+        mState->executor = std::move(executor);
+    }
+
+    ~EventStream() { close(); }
+
+    EventStream(const EventStream &) = delete;
+    EventStream &operator=(const EventStream &) = delete;
+
+    /**
+     * \return the callback to construct the watcher with; it may outlive
+     *         the stream
+     */
+    CallBackSignatur callback()
+    {
+        return [state = mState](std::vector<EventPtr> &&events) {
+            state->push(std::move(events));
+        };
+    }
+
+    /**
+     * \return an awaitable which yields the next batch, or an empty batch
+     *         once the stream has been closed
+     */
+    auto next()
+    {
+        struct Awaiter {
+            std::shared_ptr<State> state;
+
+            bool await_ready() { return false; }
+
+            bool await_suspend(std::coroutine_handle<> handle)
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (!state->events.empty() || state->isClosed) {
+                    return false;
+                }
+                state->waiter = handle;
+                return true;
+            }
+
+            std::vector<EventPtr> await_resume()
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                std::vector<EventPtr>       result;
+                std::swap(result, state->events);
+                return result;
+            }
+        };
+        return Awaiter{mState};
+    }
+
+    /**
+     * Ends the stream, a waiting consumer is resumed with an empty batch.
+     */
+    void close() { mState->push({}, true); }
+
+  private:
+    struct State {
+        void push(std::vector<EventPtr> &&batch, bool close = false)
+        {
+            std::coroutine_handle<> handle;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (isClosed) {
+                    return;
+                }
+                isClosed = close;
+                if (events.empty()) {
+                    std::swap(events, batch);
+                } else {
+                    events.insert(events.end(),
+                                  std::make_move_iterator(batch.begin()),
+                                  std::make_move_iterator(batch.end()));
+                }
+                if (events.empty() && !isClosed) {
+                    return;
+                }
+                std::swap(handle, waiter);
+            }
+
+            if (!handle) {
+                return;
+            }
+            if (executor) {
+                executor(handle);
+            } else {
+                handle.resume();
+            }
+        }
+
+        std::mutex              mutex;
+        std::vector<EventPtr>   events;
+        std::coroutine_handle<> waiter;
+        bool                    isClosed = false;
+        Executor                executor;
+    };
+
+    std::shared_ptr<State> mState;
+};
+
+}  // namespace pfw
+
+#endif /* PFW_COROUTINES */
+
+#endif /* PFW_EVENT_STREAM_H */
@@ -0,0 +1,116 @@
+#ifndef PFW_FILE_INDEX_H
+#define PFW_FILE_INDEX_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "pfw/Event.h"
+#include "pfw/FileStatus.h"
+#include "pfw/PollingScanner.h"
+
+namespace pfw {
+
+/**
+ * An in-memory index of every file and directory below the watched roots,
+ * which is crawled once and kept current from the delivered events. It
+ * answers subtree listings, glob patterns and extension queries without
+ * touching the file system.
+ *
+ * Every event re-stats its path, unless its status has been attached by the
+ * collector already: a path which is gone is removed together
+ * with its subtree, a directory which appeared is crawled. A `SUBTREE` event
+ * crawls its directory again, a buffer overflow its root.
+ */
+class FileIndex
+{
+  public:
+    struct Entry {
+        // relative to the root
+        fs::path relativePath;
+        uint64_t inode;
+        uint64_t size;
+        // nanoseconds since the epoch
+        int64_t mtime;
+        bool    isDirectory;
+    };
+
+    explicit FileIndex(PollingScanner::WatchedPredicate isWatched =
+                           PollingScanner::WatchedPredicate());
+
+    /**
+     * Crawls the root, replacing what is known about it.
+     */
+    void addRoot(const fs::path &root);
+    void removeRoot(const fs::path &root);
+
+    void update(const std::vector<EventPtr> &events);
+
+    /**
+     * \return the number of indexed entries of all roots
+     */
+    size_t size();
+
+    bool find(const fs::path &root, const fs::path &relativePath, Entry &out);
+
+    /**
+     * Lists the entries below `subtree`, the whole root by default.
+     */
+    std::vector<Entry> list(const fs::path &root,
+                            const fs::path &subtree   = fs::path(),
+                            bool            recursive = true);
+
+    /**
+     * Matches the relative paths against a pattern in generic format. `*`
+     * and `?` do not match a separator, `**` does.
+     */
+    std::vector<Entry> glob(const fs::path &root, const std::string &pattern);
+
+    /**
+     * \param extension including the dot, e.g. ".cpp"
+     */
+    std::vector<Entry> withExtension(const fs::path &   root,
+                                     const std::string &extension);
+
+    static bool matches(const std::string &pattern, const std::string &path);
+
+  private:
+    using Status = FileStatus;
+
+    struct Tree {
+        std::map<fs::path, Status> entries;
+        // the files by their extension, including the dot
+        std::unordered_map<std::string, std::set<fs::path>> byExtension;
+    };
+
+    // the result of stating the path of an event again
+    struct Update {
+        fs::path                                 root;
+        fs::path                                 relativePath;
+        bool                                     exists;
+        Status                                   status;
+        std::vector<std::pair<fs::path, Status>> subtree;
+    };
+
+    void crawl(const fs::path &                          root,
+               const fs::path &                          relativePath,
+               std::vector<std::pair<fs::path, Status>> &out);
+
+    static void  insert(Tree &          tree,
+                        const fs::path &relativePath,
+                        const Status &  status);
+    static void  erase(Tree &tree, const fs::path &relativePath);
+    static Entry entry(const std::pair<const fs::path, Status> &indexed);
+
+    PollingScanner::WatchedPredicate mIsWatched;
+    std::mutex                       mMutex;
+    std::map<fs::path, Tree>         mTrees;
+};
+
+}  // namespace pfw
+
+#endif /* PFW_FILE_INDEX_H */
@@ -0,0 +1,44 @@
+#ifndef PFW_FILE_STATUS_H
+#define PFW_FILE_STATUS_H
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace pfw {
+
+struct Event;
+
+/**
+ * The metadata of a path at the time its event has been collected. Symbolic
+ * links are not followed.
+ */
+struct FileStatus {
+    enum Type : uint8_t { REGULAR, DIRECTORY, SYMLINK, OTHER };
+
+    Type     type;
+    uint64_t size;
+    uint64_t inode;
+    uint64_t device;
+    // nanoseconds since the epoch
+    int64_t mtime;
+
+    /**
+     * Reads the status with a single `statx()` where it is available.
+     *
+     * \return false if the path does not exist
+     */
+    static bool read(const std::filesystem::path &path, FileStatus &out);
+
+    /**
+     * Attaches the status of its path to every event whose path still
+     * exists. Large batches are distributed to up to `concurrency` threads.
+     */
+    static void enrich(std::vector<std::unique_ptr<Event>> &events,
+                       size_t                               concurrency);
+};
+
+}  // namespace pfw
+
+#endif /* PFW_FILE_STATUS_H */
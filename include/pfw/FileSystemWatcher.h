@@ -8,17 +8,33 @@
 #include <thread>
 #include <utility>
 
-#include "pfw/Filter.h"
-#include "pfw/NativeInterface.h"
+#include "pfw/BasicFileSystemWatcher.h"
 
 namespace pfw {
 
-class FileSystemWatcher : public NativeInterface
+extern template class BasicFileSystemWatcher<>;
+
+/**
+ * The watcher with the default stages, which hands the callback to the
+ * Filter as it is.
+ */
+class FileSystemWatcher : public BasicFileSystemWatcher<>
 {
   public:
-    FileSystemWatcher(const fs::path &path,
+    FileSystemWatcher(const fs::path &          path,
+                      std::chrono::milliseconds sleepDuration,
+                      CallBackSignatur          callback,
+                      WatcherOptions            options = {});
+    FileSystemWatcher(const std::vector<fs::path> &paths,
+                      std::chrono::milliseconds    sleepDuration,
+                      CallBackSignatur             callback,
+                      WatcherOptions               options = {});
+    FileSystemWatcher(const fs::path &          path,
+                      std::chrono::milliseconds sleepDuration,
+                      WatcherOptions            options = {});
+    FileSystemWatcher(const std::vector<fs::path> &paths,
                       std::chrono::milliseconds    sleepDuration,
-                      CallBackSignatur             callback);
+                      WatcherOptions               options = {});
     ~FileSystemWatcher();
 };
 
@@ -1,34 +1,248 @@
 #ifndef PFW_FILTER_H
 #define PFW_FILTER_H
 
+#include <atomic>
+#include <memory_resource>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
 
+#include "pfw/ChangeIndex.h"
+#include "pfw/DigestCache.h"
+#include "pfw/Dispatcher.h"
 #include "pfw/Event.h"
+#include "pfw/EventJournal.h"
+#include "pfw/FileIndex.h"
 #include "pfw/Listener.h"
+#include "pfw/SubscriptionRouter.h"
 
 namespace pfw {
 
 using CallBackSignatur =
     std::function<void(std::vector<std::unique_ptr<Event>> &&)>;
 
+/**
+ * Describes which subtrees of the watched directory are of interest. All
+ * paths are relative to the watched root. An empty include list selects the
+ * whole tree, and an exclude always wins over an include.
+ */
+struct FilterOptions {
+    std::vector<fs::path> includePaths;
+    std::vector<fs::path> excludePaths;
+    // stops the crawl at mount points below the watched root
+    bool oneFileSystem = false;
+};
+
 class Filter : public Listener<CallBackSignatur>
 {
   public:
-    Filter(CallBackSignatur callBack);
+    Filter(CallBackSignatur callBack, FilterOptions options = FilterOptions());
     ~Filter();
 
-    void sendError(const std::string &errorMsg);
+    void sendError(const std::string &errorMsg, const fs::path &root = {});
+
+    /**
+     * Delivers a batch of a backend. Before, it coalesces saves, combines
+     * renames, merges the events of the same path, summarizes storms, drops
+     * the rejected paths, and attaches the status and digest of the paths,
+     * as far as each of them is enabled.
+     */
     void filterAndNotify(std::vector<EventPtr> &&events);
 
+    /**
+     * Keeps the batches of the backend back until `release()`, so that the
+     * changes of a restored snapshot are delivered ahead of them.
+     */
+    void holdBack();
+
+    /**
+     * Delivers `events` ahead of the batches which have been held back, and
+     * every later batch directly.
+     */
+    void release(std::vector<EventPtr> &&events);
+
+    /**
+     * Replaces the current filter configuration and returns the previous one,
+     * so that the native service is able to compute the difference.
+     */
+    FilterOptions setOptions(FilterOptions options);
+    FilterOptions options();
+
+    /**
+     * \return true if events for the given relative path should be delivered
+     */
+    bool accepts(const fs::path &relativePath);
+
+    /**
+     * \return true if the directory at the given relative path has to be
+     *         observed, either because it is accepted or because it leads to
+     *         an included subtree
+     */
+    bool isWatched(const fs::path &relativePath);
+
+    bool isOneFileSystem();
+
+    /**
+     * Appends every delivered event to the journal before the callback is
+     * invoked, so that the sequence numbers follow the delivery order.
+     */
+    void setJournal(std::shared_ptr<EventJournal> journal);
+
+    /**
+     * Records the delivered events in the index before the callback is
+     * invoked.
+     */
+    void setChangeIndex(std::shared_ptr<ChangeIndex> changeIndex);
+    void setFileIndex(std::shared_ptr<FileIndex> fileIndex);
+
+    /**
+     * Invokes the callback for the shards of each batch in parallel, see
+     * Dispatcher. Without a dispatcher the whole batch is handed over at
+     * once.
+     */
+    void setDispatcher(std::shared_ptr<Dispatcher> dispatcher);
+
+    /**
+     * Hands larger batches to the callback and the subscriptions as a
+     * sequence of chunks with at most `maxBatchSize` events, 0 disables it.
+     * A chunk ends before a rename pair rather than splitting it; only a
+     * pair which does not fit at all exceeds a `maxBatchSize` of 1. The
+     * journal and the indexes still receive the whole batch.
+     */
+    void setMaxBatchSize(size_t maxBatchSize);
+
+    /**
+     * The upstream of the pool the containers of `filterAndNotify()` are
+     * allocated from, the default resource unless it is set before the
+     * backend is created.
+     */
+    void setMemoryResource(std::pmr::memory_resource *resource);
+    std::pmr::memory_resource *memoryResource();
+
+    /**
+     * Attaches the FileStatus of their path to the events, see
+     * `Event::status`.
+     */
+    void setStatEvents(bool statEvents);
+    bool statEvents();
+
+    /**
+     * Reports a rename as a single `RENAMED` event carrying both paths, see
+     * `combineRenames()`.
+     */
+    void setCombineRenames(bool combineRenames);
+    bool combinesRenames();
+
+    /**
+     * Reports an atomic save as a single `MODIFIED` event of its target, see
+     * `coalesceSaves()`.
+     */
+    void setCoalesceSaves(bool coalesceSaves);
+    bool coalescesSaves();
+
+    /**
+     * Drops the modifications which did not change the content of a file.
+     */
+    void setDigestCache(std::shared_ptr<DigestCache> digestCache);
+    std::shared_ptr<DigestCache> digestCache();
+
+    /**
+     * Summarizes the subtrees with more than `threshold` events in a batch,
+     * see StormSummarizer. 0 disables it.
+     */
+    void   setStormThreshold(size_t threshold);
+    size_t stormThreshold();
+
+    /**
+     * Publishes every delivered batch to the subscription as well, limited
+     * to its root and subtree. The subscribers share a copy of the events
+     * which are handed to the callback.
+     */
+    void subscribe(std::shared_ptr<Subscription> subscription);
+    void unsubscribe(const std::shared_ptr<Subscription> &subscription);
+
+    /**
+     * Computes the subtrees which might be observed with `after`, but have
+     * not been observed with `before`.
+     */
+    static std::vector<fs::path> newlyIncluded(const FilterOptions &before,
+                                               const FilterOptions &after);
+
+    /**
+     * \return true if `child` equals `parent` or is located below it
+     */
+    static bool isSubPath(const fs::path &parent, const fs::path &child);
+
+    /**
+     * Replaces each `DELETED | RENAMED` event which is directly followed by
+     * a `CREATED | RENAMED` event of the same root by a single `RENAMED`
+     * event at the position of the latter, with the old path in
+     * `Event::previousPath`.
+     */
+    static void combineRenames(std::vector<EventPtr> &events);
+
+    /**
+     * Replaces each rename of a temporary file over its target, as editors
+     * save a file, by a single `MODIFIED` event of the target at the
+     * position of the rename. The writes to the temporary file are dropped.
+     * Has to be applied before `combineRenames()`.
+     */
+    static void coalesceSaves(std::vector<EventPtr> &events);
+
+    /**
+     * \return true if the file name matches one of the names editors and
+     *         tools use for the temporary file of an atomic save
+     */
+    static bool isTemporary(const fs::path &relativePath);
+
   private:
-    Listener::CallbackHandle mCallbackHandle;
+    using OptionsPtr = std::shared_ptr<const FilterOptions>;
+    using RouterPtr  = std::shared_ptr<const SubscriptionRouter>;
+
+    static bool      accepts(const FilterOptions &options,
+                             const fs::path &     relativePath);
+    static bool      isWatched(const FilterOptions &options,
+                               const fs::path &     relativePath);
+    static bool      acceptsRename(const FilterOptions &options, Event &event);
+    // whether the adjacent events are the halves of a rename
+    static bool      isRenamePair(const Event &source,
+                                  const Event &destination);
+    static OptionsPtr normalize(FilterOptions options);
+    OptionsPtr        currentOptions();
+    void              prepareAndDeliver(std::vector<EventPtr> &&events);
+    void              mergeDuplicates(std::vector<EventPtr> &events);
+    void              deliver(std::vector<EventPtr> &&events);
+    // invokes the callback and publishes to the subscriptions
+    void              handOver(std::vector<EventPtr> &&events);
+    void              publish(const std::vector<EventPtr> &events);
+
+    Listener::CallbackHandle      mCallbackHandle;
+    std::mutex                    mOptionsMutex;
+    OptionsPtr                    mOptions;
+    std::mutex                    mDeliveryMutex;
+    std::shared_ptr<EventJournal> mJournal;
+    std::shared_ptr<ChangeIndex>  mChangeIndex;
+    std::shared_ptr<FileIndex>    mFileIndex;
+    std::shared_ptr<Dispatcher>   mDispatcher;
+    std::atomic<bool>             mStatEvents;
+    std::atomic<bool>             mCombineRenames;
+    std::atomic<bool>             mCoalesceSaves;
+    std::atomic<size_t>           mStormThreshold;
+    std::atomic<size_t>           mMaxBatchSize;
+    std::shared_ptr<DigestCache>  mDigestCache;
+    std::mutex                    mSubscriptionsMutex;
+    std::atomic<std::pmr::memory_resource *> mMemoryResource;
+    std::shared_ptr<std::pmr::memory_resource> mPool;
+    std::atomic<bool>                          mHeld;
+    std::mutex                                 mHeldMutex;
+    std::vector<std::vector<EventPtr>>         mHeldBatches;
+    // replaced on every change, so that a delivery does not block it
+    RouterPtr mSubscriptions;
 };
 
 using FilterPtr = std::shared_ptr<Filter>;
 
 }  // namespace pfw
 
-#endif /* PFW_FILTER_H */
\ No newline at end of file
+#endif /* PFW_FILTER_H */
@@ -5,6 +5,7 @@
 #include <functional>
 #include <map>
 #include <mutex>
+#include <shared_mutex>
 #include <utility>
 
 namespace pfw {
@@ -28,21 +29,22 @@ class Listener
 
   private:
     std::map<CallbackHandle, CallbackType> mListeners;
-    std::mutex                             mListenersMutex;
+    // shared by concurrent notifications, see Dispatcher
+    std::shared_mutex                      mListenersMutex;
     int                                    mHandleCount{0};
 
   public:
     CallbackHandle registerCallback(const CallbackType callback)
     {
-        std::lock_guard<std::mutex> lock(mListenersMutex);
+        std::unique_lock<std::shared_mutex> lock(mListenersMutex);
         mListeners[++mHandleCount] = callback;
         return mHandleCount;
     }
 
     void deregisterCallback(const CallbackHandle &id)
     {
-        std::lock_guard<std::mutex> lock(mListenersMutex);
-        auto                        it = mListeners.find(id);
+        std::unique_lock<std::shared_mutex> lock(mListenersMutex);
+        auto                                it = mListeners.find(id);
 
         if (it != mListeners.end()) {
             mListeners.erase(it);
@@ -53,7 +55,7 @@ class Listener
     template <typename... Args>
     void notify(Args &&... args)
     {
-        std::lock_guard<std::mutex> lock(mListenersMutex);
+        std::shared_lock<std::shared_mutex> lock(mListenersMutex);
         for (const auto &func : mListeners) {
             func.second(std::move(std::forward<Args>(args))...);
         }
@@ -0,0 +1,84 @@
+#ifndef PFW_MOUNT_TABLE_H
+#define PFW_MOUNT_TABLE_H
+
+#include <filesystem>
+#include <istream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace pfw {
+
+/**
+ * The mount points of the process together with the kind of their file
+ * system. It allows a crawl to recognize mount boundaries and to choose a
+ * strategy per subtree: local file systems are watched, remote ones are
+ * polled, as their changes made by other machines are never notified, and
+ * pseudo file systems like `/proc` are skipped.
+ */
+class MountTable
+{
+  public:
+    enum Kind { LOCAL, REMOTE, PSEUDO };
+
+    struct Mount {
+        std::string type;
+        Kind        kind;
+    };
+
+    /**
+     * \return the mount table of the process; it is empty on platforms
+     *         without `/proc/self/mountinfo`
+     */
+    static MountTable current();
+
+    /**
+     * Reads a mount table in the format of `/proc/self/mountinfo`.
+     */
+    static MountTable parse(std::istream &mountInfo);
+
+    /**
+     * Adds a mount point, it covers an earlier mount at the same path.
+     */
+    void add(const std::filesystem::path &mountPoint, const std::string &type);
+
+    bool isMountPoint(const std::filesystem::path &path) const;
+
+    /**
+     * \return the mount points located strictly below the path
+     */
+    std::vector<std::filesystem::path>
+    mountPointsBelow(const std::filesystem::path &path) const;
+
+    /**
+     * \return the kind of the file system mounted at the path, or `LOCAL` if
+     *         the path is not a mount point
+     */
+    Kind kindAt(const std::filesystem::path &path) const;
+
+    /**
+     * \return true if a mount between the root and the path, including the
+     *         path itself, is not crawled: pseudo file systems never are,
+     *         other ones only if the crawl stays on the file system of the
+     *         root; an automount point only skips itself, not the file
+     *         systems mounted below it
+     */
+    bool isSkipped(const std::filesystem::path &root,
+                   const std::filesystem::path &path,
+                   bool                         oneFileSystem) const;
+
+    static Kind kindOfType(const std::string &type);
+
+    /**
+     * Determines the kind of the file system of an arbitrary path by its
+     * magic number; paths which can not be probed are considered local.
+     */
+    static Kind kindOfPath(const std::filesystem::path &path);
+
+  private:
+    std::map<std::filesystem::path, Mount> mMounts;
+};
+
+}  // namespace pfw
+
+#endif /* PFW_MOUNT_TABLE_H */
@@ -1,20 +1,16 @@
 #ifndef PFW_NATIVE_INTERFACE_H
 #define PFW_NATIVE_INTERFACE_H
 
-#include "pfw/internal/definitions.h"
-
-#ifdef PFW_WINDOWS
-#include "pfw/win32/Controller.h"
-using NativeImplementation = pfw::Controller;
-#elif PFW_APPLE
-#include "pfw/osx/FSEventsService.h"
-using NativeImplementation = pfw::FSEventsService;
-#elif PFW_LINUX
-#include "pfw/linux/InotifyService.h"
-using NativeImplementation = pfw::InotifyService;
-#endif
-
+#include "pfw/Backend.h"
+#include "pfw/ChangeIndex.h"
+#include "pfw/EventJournal.h"
+#include "pfw/EventQueue.h"
+#include "pfw/FileIndex.h"
 #include "pfw/Filter.h"
+#include "pfw/TreeSnapshot.h"
+#include "pfw/WatcherOptions.h"
+#include <memory>
+#include <thread>
 #include <vector>
 
 namespace pfw {
@@ -25,14 +21,112 @@ class NativeInterface
   public:
     NativeInterface(const fs::path &                path,
                     const std::chrono::milliseconds latency,
-                    CallBackSignatur                callback);
+                    CallBackSignatur                callback,
+                    WatcherOptions                  options = {});
+    NativeInterface(const std::vector<fs::path> &   paths,
+                    const std::chrono::milliseconds latency,
+                    CallBackSignatur                callback,
+                    WatcherOptions                  options = {});
+    /**
+     * Queues the events instead of invoking a callback, see `eventQueue()`.
+     */
+    NativeInterface(const fs::path &                path,
+                    const std::chrono::milliseconds latency,
+                    WatcherOptions                  options = {});
+    NativeInterface(const std::vector<fs::path> &   paths,
+                    const std::chrono::milliseconds latency,
+                    WatcherOptions                  options = {});
     ~NativeInterface();
 
     bool isWatching();
 
+    /**
+     * Adds or removes a watched root at runtime without disturbing the
+     * other roots. The root of every event is reported in `Event::root`.
+     */
+    bool                  addRoot(const fs::path &path);
+    bool                  removeRoot(const fs::path &path);
+    std::vector<fs::path> roots();
+
+    /**
+     * Swaps the filter configuration of a running watcher. Only the
+     * difference to the previous configuration is applied to the native
+     * service, no full re-crawl takes place.
+     */
+    void          setFilterOptions(const FilterOptions &filterOptions);
+    FilterOptions filterOptions();
+
+    /**
+     * \return the backend which has been chosen for the watcher
+     */
+    Backend *backend();
+
+    /**
+     * \return the journal configured in `WatcherOptions::journalPath`, or
+     *         nullptr
+     */
+    EventJournal *journal();
+
+    /**
+     * Queries the index configured with `WatcherOptions::changeIndexSize`.
+     * Without an index every answer is a fresh instance.
+     */
+    ChangeToken changeToken();
+    Changes     changesSince(const ChangeToken &token);
+
+    /**
+     * \return the index enabled with `WatcherOptions::fileIndex`, or nullptr
+     */
+    FileIndex *fileIndex();
+
+    /**
+     * \return the queue of a watcher which has been constructed without a
+     *         callback, or nullptr
+     */
+    EventQueue *eventQueue();
+
+    /**
+     * Subscribes to the delivered batches in addition to the callback. The
+     * subscription receives them on its own executor, see Subscription.
+     */
+    std::shared_ptr<Subscription>
+         subscribe(BatchCallback       callback,
+                   SubscriptionOptions options = SubscriptionOptions());
+    void unsubscribe(const std::shared_ptr<Subscription> &subscription);
+
+    /**
+     * Writes the snapshot configured in `WatcherOptions::snapshotPath`. It is
+     * written on destruction as well.
+     *
+     * \return false if no snapshot is configured or it could not be written
+     */
+    bool saveSnapshot();
+
   private:
-    std::shared_ptr<Filter>               _filter;
-    std::unique_ptr<NativeImplementation> _nativeInterface;
+    NativeInterface(const std::vector<fs::path> &   paths,
+                    const std::chrono::milliseconds latency,
+                    std::shared_ptr<EventQueue>     queue,
+                    WatcherOptions                  options);
+
+    void createBackend(const std::string &             name,
+                       const fs::path &                path,
+                       const std::chrono::milliseconds latency);
+    void restoreSnapshot(const fs::path &file);
+    // sets up the stages between the backend and the callback
+    void configureDelivery(const WatcherOptions &options);
+    void openJournal(const WatcherOptions &options);
+    void openChangeIndex(const WatcherOptions &options);
+    void openFileIndex(const WatcherOptions &options);
+
+    std::shared_ptr<EventQueue>   _queue;
+    std::shared_ptr<Filter>       _filter;
+    std::shared_ptr<EventJournal> _journal;
+    std::shared_ptr<ChangeIndex>  _changeIndex;
+    std::shared_ptr<FileIndex>    _fileIndex;
+    std::unique_ptr<Backend>      _nativeInterface;
+    std::unique_ptr<TreeSnapshot> _snapshot;
+    // delivers the changes of the restored snapshot
+    std::thread _restorer;
 };
 }  // namespace pfw
 
@@ -0,0 +1,190 @@
+#ifndef PFW_POLLING_SCANNER_H
+#define PFW_POLLING_SCANNER_H
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "pfw/Event.h"
+
+namespace pfw {
+
+/**
+ * Detects changes below a directory by comparing snapshots of the
+ * (inode, size, mtime) of every entry. It is used where no change
+ * notifications of the operating system are available.
+ *
+ * Directories whose mtime did not change since the previous scan are not
+ * listed again, only their known entries are stat'ed. An mtime which is too
+ * close to the time of the scan is not trusted, as a later change might not
+ * advance it on file systems with a coarse timestamp resolution.
+ */
+class PollingScanner
+{
+  public:
+    // the state of an entry which is compared between the scans
+    struct Entry {
+        uint64_t inode;
+        uint64_t device;
+        uint64_t size;
+        int64_t  mtime;
+        // the creation time, 0 where the file system does not report it
+        int64_t birth;
+        bool    isDirectory;
+    };
+
+    struct Change {
+        Change(EventType       type,
+               const fs::path &relativePath,
+               const Entry &   entry = Entry())
+            : type(type)
+            , relativePath(relativePath)
+            , entry(entry)
+        {
+        }
+
+        EventType type;
+        // relative to the scanned directory
+        fs::path relativePath;
+        // the state of a created or deleted entry, which allows to pair
+        // renames
+        Entry entry;
+    };
+
+    // decides by the relative path whether a directory is scanned at all
+    using WatchedPredicate = std::function<bool(const fs::path &)>;
+
+    /**
+     * \param concurrency the number of threads the subdirectories of the
+     *                    scanned directory are distributed to
+     */
+    PollingScanner(const fs::path & root,
+                   size_t           concurrency = 1,
+                   WatchedPredicate isWatched   = WatchedPredicate());
+    ~PollingScanner();
+
+    const fs::path &root() const;
+
+    /**
+     * Takes a new snapshot without reporting any changes.
+     */
+    void reset();
+
+    /**
+     * Updates the snapshot and reports the differences to the previous one.
+     * The entries of a deleted directory are reported before the directory.
+     * Renames are reported as an adjacent pair of `DELETED | RENAMED` and
+     * `CREATED | RENAMED`, if the entry is recognized by its inode and
+     * device, and by its birth time or else its size and mtime, as a freed
+     * inode is reused right away.
+     */
+    std::vector<Change> scan();
+
+    /**
+     * \return the number of directories of the last snapshot, including the
+     *         scanned directory itself
+     */
+    size_t directoryCount() const;
+
+    /**
+     * Appends the snapshot to `out` as a flat array of fixed-size records
+     * followed by the names, so that it can be read directly from a mapped
+     * file.
+     */
+    void serialize(std::string &out) const;
+
+    /**
+     * Replaces the snapshot by a serialized one. The next scan reports the
+     * changes since the serialized snapshot has been taken, listing only the
+     * directories whose mtime changed.
+     *
+     * \return false if the data is malformed, the snapshot is empty then
+     */
+    bool deserialize(const char *data, size_t size);
+
+  private:
+    struct Directory;
+    using DirectoryPtr = std::unique_ptr<Directory>;
+
+    struct Directory {
+        Entry self;
+        // the mtime can not be relied on to detect the next change
+        bool                                               racy;
+        std::vector<std::pair<fs::path::string_type, Entry>> files;
+        std::vector<std::pair<fs::path::string_type, DirectoryPtr>>
+            directories;
+    };
+
+    // a subdirectory whose update is deferred to a worker thread
+    struct Task {
+        Directory *directory;
+        fs::path   path;
+        fs::path   relativePath;
+        Entry      self;
+        bool       list;
+    };
+
+    struct Context {
+        bool                 report;
+        int64_t              scanStart;
+        std::atomic<size_t> *directoryCount;
+    };
+
+    void update(Directory &          directory,
+                const fs::path &     path,
+                const fs::path &     relativePath,
+                const Entry &        self,
+                bool                 list,
+                const Context &      context,
+                std::vector<Change> &changes,
+                std::vector<Task> *  deferred);
+    void updateEntries(Directory &          directory,
+                       const fs::path &     path,
+                       const fs::path &     relativePath,
+                       const Context &      context,
+                       std::vector<Change> &changes,
+                       std::vector<Task> *  deferred);
+    void listEntries(Directory &          directory,
+                     const fs::path &     path,
+                     const fs::path &     relativePath,
+                     const Context &      context,
+                     std::vector<Change> &changes,
+                     std::vector<Task> *  deferred);
+    void scanRoot(bool report, std::vector<Change> &changes);
+
+    static void pairRenames(std::vector<Change> &changes);
+    static bool isSameEntry(const Entry &lhs, const Entry &rhs);
+
+    struct Record;
+    struct Reader;
+
+    static void serializeEntry(const fs::path::string_type &name,
+                               const Entry &                entry,
+                               const Directory *            directory,
+                               std::string &                records,
+                               std::string &                names);
+    static void serializeEntries(const Directory &directory,
+                                 std::string &    records,
+                                 std::string &    names);
+    static DirectoryPtr deserializeDirectory(const Record &self, Reader &reader);
+
+    static bool statEntry(const fs::path &path, Entry &out);
+    static void reportDeleted(const Directory &    directory,
+                              const fs::path &     relativePath,
+                              std::vector<Change> &changes);
+
+    fs::path         mRoot;
+    size_t           mConcurrency;
+    WatchedPredicate mIsWatched;
+    DirectoryPtr     mRootDirectory;
+    size_t           mDirectoryCount;
+};
+
+}  // namespace pfw
+
+#endif /* PFW_POLLING_SCANNER_H */
@@ -0,0 +1,50 @@
+#ifndef PFW_STORM_SUMMARIZER_H
+#define PFW_STORM_SUMMARIZER_H
+
+#include <map>
+#include <vector>
+
+#include "pfw/Event.h"
+
+namespace pfw {
+
+/**
+ * Replaces the events of a subtree which changed in bulk, e.g. by a
+ * `git checkout` or a `rm -rf`, by a single `SUBTREE` event for their lowest
+ * common directory. The consumer scans that directory again instead of
+ * handling every event on its own.
+ */
+class StormSummarizer
+{
+  public:
+    /**
+     * Summarizes every directory with more than `threshold` events below it,
+     * unless all but `threshold` of them are located in a single
+     * subdirectory, which is summarized instead. The summary is
+     * `SUBTREE | MODIFIED` if the directory still exists, else
+     * `SUBTREE | DELETED`, and takes the position of the first event it
+     * replaces.
+     *
+     * Failures, overflows and combined renames are never summarized.
+     */
+    static void summarize(std::vector<EventPtr> &events, size_t threshold);
+
+  private:
+    struct Node {
+        // the number of events at or below the path of the node
+        size_t                   count = 0;
+        std::vector<size_t>      events;
+        std::map<fs::path, Node> children;
+    };
+
+    static void summarize(std::vector<EventPtr> &events,
+                          const fs::path &       root,
+                          const fs::path &       relativePath,
+                          const Node &           node,
+                          size_t                 threshold);
+    static void collect(const Node &node, std::vector<size_t> &out);
+};
+
+}  // namespace pfw
+
+#endif /* PFW_STORM_SUMMARIZER_H */
@@ -0,0 +1,99 @@
+#ifndef PFW_SUBSCRIPTION_H
+#define PFW_SUBSCRIPTION_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "pfw/Event.h"
+
+namespace pfw {
+
+/**
+ * A delivered batch. The events are immutable and shared by the batches of
+ * every subscriber.
+ */
+using SharedEvent   = std::shared_ptr<const Event>;
+using EventBatch    = std::shared_ptr<const std::vector<SharedEvent>>;
+using BatchCallback = std::function<void(const EventBatch &)>;
+
+struct SubscriptionOptions {
+    // runs a task which invokes the callback; a subscription without an
+    // executor runs its callback on a thread of its own
+    std::function<void(std::function<void()>)> executor;
+    // the number of batches the subscriber may fall behind
+    size_t capacity = 1024;
+    // limits the events to a watched root, every root by default
+    fs::path root;
+    // limits the events to a subtree of the root, see SubscriptionRouter
+    fs::path subtree;
+};
+
+/**
+ * A subscriber of the delivered batches with a queue of its own, so that a
+ * slow subscriber neither delays the delivery nor the other subscribers.
+ * Once it falls `capacity` batches behind, its queued batches are replaced
+ * by a batch with a `BUFFER_OVERFLOW` event for each of their roots.
+ */
+class Subscription
+{
+  public:
+    Subscription(BatchCallback callback, SubscriptionOptions options = {});
+    ~Subscription();
+
+    Subscription(const Subscription &) = delete;
+    Subscription &operator=(const Subscription &) = delete;
+
+    /**
+     * Queues the batch without waiting for the subscriber.
+     */
+    void publish(const EventBatch &batch);
+
+    /**
+     * Drops the queued batches and waits for a running callback, unless it
+     * is called from within the callback. No callback is invoked afterwards.
+     */
+    void close();
+
+    /**
+     * \return the number of batches which have been dropped
+     */
+    size_t dropped();
+
+    const fs::path &root() const;
+    const fs::path &subtree() const;
+
+  private:
+    struct State {
+        std::mutex              mutex;
+        std::condition_variable condition;
+        std::deque<EventBatch>  queue;
+        // the overflow events at the front of the queue, if it overflowed
+        std::shared_ptr<std::vector<SharedEvent>> overflow;
+        BatchCallback           callback;
+        size_t                  capacity;
+        size_t                  dropped     = 0;
+        bool                    isScheduled = false;
+        bool                    isClosed    = false;
+        // the thread which runs the callback at the moment
+        std::thread::id running;
+    };
+
+    // invokes the callback until the queue is empty
+    static void drain(State &state, std::unique_lock<std::mutex> &lock);
+    static void run(std::shared_ptr<State> state);
+
+    std::shared_ptr<State>                     mState;
+    std::function<void(std::function<void()>)> mExecutor;
+    fs::path                                   mRoot;
+    fs::path                                   mSubtree;
+    std::thread                                mThread;
+};
+
+}  // namespace pfw
+
+#endif /* PFW_SUBSCRIPTION_H */
@@ -0,0 +1,58 @@
+#ifndef PFW_SUBSCRIPTION_ROUTER_H
+#define PFW_SUBSCRIPTION_ROUTER_H
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "pfw/Subscription.h"
+
+namespace pfw {
+
+/**
+ * Routes the events of a batch to the subscriptions whose root and subtree
+ * they belong to, see `SubscriptionOptions`. The subscriptions are kept in a
+ * trie of path components, so every event is looked up once and each
+ * subscriber receives only its part of the batch.
+ *
+ * A subscriber receives the events of its subtree, and the events of the
+ * directories above it which affect the subtree as a whole: anything but a
+ * plain modification. Overflows and failures reach every subscriber of
+ * their root, or of every root if they have none.
+ */
+class SubscriptionRouter
+{
+  public:
+    void add(std::shared_ptr<Subscription> subscription);
+    void remove(const std::shared_ptr<Subscription> &subscription);
+    bool empty() const;
+
+    /**
+     * Publishes the part of the batch each subscription is interested in.
+     */
+    void publish(const std::vector<EventPtr> &events) const;
+
+  private:
+    struct Node {
+        std::vector<std::shared_ptr<Subscription>> subscriptions;
+        std::map<fs::path, Node>                   children;
+    };
+    using Parts = std::map<Subscription *, std::vector<SharedEvent>>;
+
+    void route(const SharedEvent &event,
+               const fs::path &   relativePath,
+               Parts &            parts) const;
+    void broadcast(const SharedEvent &event, Parts &parts) const;
+    static void add(const Node &node, const SharedEvent &event, Parts &parts);
+    static void collect(const Node &       node,
+                        const SharedEvent &event,
+                        Parts &            parts);
+
+    // the subscriptions of every root are the children of the empty path
+    std::map<fs::path, Node> mRoots;
+    size_t                   mSize = 0;
+};
+
+}  // namespace pfw
+
+#endif /* PFW_SUBSCRIPTION_ROUTER_H */
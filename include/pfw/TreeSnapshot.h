@@ -0,0 +1,54 @@
+#ifndef PFW_TREE_SNAPSHOT_H
+#define PFW_TREE_SNAPSHOT_H
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "pfw/Event.h"
+#include "pfw/PollingScanner.h"
+
+namespace pfw {
+
+/**
+ * Keeps a snapshot of the watched trees in a file, so that the changes made
+ * while no watcher was running are reported after a restart. The file holds
+ * the serialized PollingScanner of every root and is read through a memory
+ * mapping; only directories whose mtime changed are listed again.
+ */
+class TreeSnapshot
+{
+  public:
+    TreeSnapshot(const fs::path &                 file,
+                 PollingScanner::WatchedPredicate isWatched =
+                     PollingScanner::WatchedPredicate());
+
+    /**
+     * Loads the snapshot of the roots and reports every change since it has
+     * been saved. Roots which are not part of the file are snapshotted
+     * without reporting anything.
+     */
+    std::vector<EventPtr> restore(const std::vector<fs::path> &roots);
+
+    void addRoot(const fs::path &root);
+    void removeRoot(const fs::path &root);
+
+    /**
+     * Updates the snapshot of every root and replaces the file atomically.
+     */
+    bool save();
+
+  private:
+    std::unique_ptr<PollingScanner> createScanner(const fs::path &root);
+
+    fs::path                                            mFile;
+    PollingScanner::WatchedPredicate                    mIsWatched;
+    std::mutex                                          mMutex;
+    std::map<fs::path, std::unique_ptr<PollingScanner>> mScanners;
+};
+
+}  // namespace pfw
+
+#endif /* PFW_TREE_SNAPSHOT_H */
@@ -0,0 +1,77 @@
+#ifndef PFW_WATCHER_OPTIONS_H
+#define PFW_WATCHER_OPTIONS_H
+
+#include <memory_resource>
+#include <string>
+
+#include "pfw/BackendRegistry.h"
+#include "pfw/EventJournal.h"
+#include "pfw/Filter.h"
+
+namespace pfw {
+
+/**
+ * The configuration of a watcher. It is implicitly constructible from the
+ * FilterOptions, which used to be the only configuration.
+ */
+struct WatcherOptions {
+    WatcherOptions(FilterOptions filter  = FilterOptions(),
+                   std::string   backend = BackendRegistry::AUTO)
+        : filter(std::move(filter))
+        , backend(std::move(backend))
+    {
+    }
+
+    FilterOptions filter;
+    // the name of a registered backend, see BackendRegistry
+    std::string backend;
+    // the file keeping a snapshot of the watched trees across restarts; the
+    // changes made while no watcher was running are reported on startup
+    fs::path snapshotPath;
+    // the directory of an EventJournal recording every delivered event, so
+    // that a consumer is able to resume after a crash
+    fs::path       journalPath;
+    JournalOptions journal;
+    // the number of recently changed paths which are remembered for
+    // `NativeInterface::changesSince()`, 0 disables the index
+    size_t changeIndexSize = 0;
+    // keeps an index of every file below the roots, see FileIndex
+    bool fileIndex = false;
+    // attaches the status of their path to the events, so that consumers do
+    // not need to stat them again
+    bool statEvents = false;
+    // drops the modifications which did not change the content of a file and
+    // attaches the digest of the content to the events, see DigestCache
+    bool digestContents = false;
+    // reports a rename as a single `RENAMED` event with the old path in
+    // `Event::previousPath`, instead of a `DELETED | RENAMED` and
+    // `CREATED | RENAMED` pair
+    bool combineRenames = false;
+    // reports writing a temporary file and renaming it over its target, as
+    // editors save a file, as a single `MODIFIED` event of the target
+    bool coalesceSaves = false;
+    // the number of threads which invoke the callback in parallel, each
+    // with a shard of the batch, see Dispatcher; the events of a path are
+    // always handed to the same shard
+    size_t                dispatchConcurrency = 1;
+    Dispatcher::Partition dispatchPartition   = Dispatcher::BY_PATH;
+    // the maximum number of events handed to the callback at once; larger
+    // batches are delivered in order as several chunks, 0 does not limit
+    // them
+    size_t maxBatchSize = 0;
+    // the number of events the EventQueue of a watcher without a callback
+    // holds until they are replaced by `BUFFER_OVERFLOW` events
+    size_t queueCapacity = 1 << 20;
+    // the upstream of the containers the filter needs for each batch, and
+    // of the batches of a BasicFileSystemWatcher with a polymorphic
+    // allocator; the default resource if it is nullptr
+    std::pmr::memory_resource *memoryResource = nullptr;
+    // replaces the events of a subtree by a single `SUBTREE` event once it
+    // produced more than this number of events within one batch, see
+    // StormSummarizer; 0 reports every event
+    size_t stormThreshold = 0;
+};
+
+}  // namespace pfw
+
+#endif /* PFW_WATCHER_OPTIONS_H */
@@ -51,4 +51,14 @@
 #error "unknown or unsupported compiler"
 #endif
 
+/**
+ * PFW_COROUTINES is defined if the translation unit is compiled with C++20
+ * coroutines, see EventStream.h. The library itself does not depend on them.
+ */
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define PFW_COROUTINES 1
+#endif
+#endif
+
 #endif /* PFW_DEFINITIONS_H */
@@ -22,9 +22,12 @@ class Collector
     static void  finish(void *args);
     static void *work(void *args);
 
-    void sendError(const std::string &errorMsg);
+    void sendError(const std::string &          errorMsg,
+                   const std::filesystem::path &root = {});
     void insert(std::vector<EventPtr> &&events);
-    void push_back(EventType type, const std::filesystem::path &relativePath);
+    void push_back(EventType                    type,
+                   const std::filesystem::path &relativePath,
+                   const std::filesystem::path &root = {});
 
   private:
     void sendEvents();
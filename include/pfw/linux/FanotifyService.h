@@ -0,0 +1,107 @@
+#ifndef PFW_FANOTIFY_SERVICE_H
+#define PFW_FANOTIFY_SERVICE_H
+
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "pfw/Backend.h"
+#include "pfw/Filter.h"
+#include "pfw/linux/Collector.h"
+
+namespace pfw {
+
+/**
+ * Watches whole file systems with a single fanotify mark each, instead of
+ * one inotify watch per directory, so adding a root does not crawl it at
+ * all. The kernel reports the handle of the parent directory together with
+ * the name of the entry (`FAN_REPORT_DFID_NAME`); handles are resolved to
+ * paths through a cache.
+ *
+ * Marking a file system and resolving handles requires `CAP_SYS_ADMIN` and
+ * `CAP_DAC_READ_SEARCH`. Without them `isValid()` is false, and the
+ * BackendRegistry falls back to inotify. Local mounts below a root are
+ * marked as well, network and pseudo file systems are not reported. Events
+ * in a directory which has been removed before they are read can only be
+ * resolved if the directory is cached already.
+ */
+class FanotifyService : public Backend
+{
+  public:
+    FanotifyService(std::shared_ptr<Filter>         filter,
+                    const std::filesystem::path &   path,
+                    const std::chrono::milliseconds latency);
+    ~FanotifyService();
+
+    /**
+     * \return false if fanotify is not available to the process
+     */
+    bool isValid();
+
+    bool isWatching() override;
+    void applyFilterOptions(const FilterOptions &previous) override;
+    bool addRoot(const std::filesystem::path &path) override;
+    bool removeRoot(const std::filesystem::path &path) override;
+    std::vector<std::filesystem::path> roots() override;
+
+  private:
+    struct MarkedFileSystem {
+        // a descriptor on the file system which handles are opened against
+        int                   mountFd;
+        std::filesystem::path path;
+    };
+
+    // the source of a rename, until its destination arrives
+    struct PendingMove {
+        std::filesystem::path path;
+        bool                  isDirectory;
+        bool                  isGood;
+    };
+
+    // bounds the memory of the handle cache
+    static constexpr size_t MAX_CACHED_DIRECTORIES = 65536;
+
+    bool canResolveHandles(const std::filesystem::path &path);
+    void updateMarks();
+    void work();
+    void read(PendingMove &pendingMove);
+    bool resolve(const std::string &    fileSystemKey,
+                 const void *           handle,
+                 std::filesystem::path &out);
+    // caches a new directory, so that its events are resolved even if it
+    // is removed before they are read
+    void remember(const std::filesystem::path &directory);
+    void forget(const std::filesystem::path &directory);
+    void lost(const std::filesystem::path &directory);
+
+    void created(const std::filesystem::path &path, bool isDirectory);
+    void modified(const std::filesystem::path &path);
+    void deleted(const std::filesystem::path &path, bool isDirectory);
+    void moved(const PendingMove &from, const std::filesystem::path &to);
+    void overflowed();
+    void push(EventType type, const std::filesystem::path &path);
+
+    std::shared_ptr<Filter>    mFilter;
+    std::shared_ptr<Collector> mCollector;
+    int                        mFanotifyInstance;
+    int                        mWakeup;
+    bool                       mIsValid;
+    std::atomic<bool>          mStopped;
+    std::thread                mThread;
+
+    std::mutex                              mMutex;
+    std::set<std::filesystem::path>         mRoots;
+    std::map<std::string, MarkedFileSystem> mMarks;
+    std::unordered_map<std::string, std::filesystem::path> mDirectories;
+};
+
+}  // namespace pfw
+
+#endif /* PFW_FANOTIFY_SERVICE_H */
@@ -1,6 +1,7 @@
 #ifndef PFW_INOTIFY_EVENT_LOOP_H
 #define PFW_INOTIFY_EVENT_LOOP_H
 
+#include <atomic>
 #include <mutex>
 #include <pthread.h>
 #include <stdlib.h>
@@ -11,11 +12,11 @@
 #include <unistd.h>
 
 #include "pfw/SingleshotSemaphore.h"
-#include "pfw/linux/InotifyService.h"
+#include "pfw/linux/InotifyWatchRegistry.h"
 
 namespace pfw {
 
-class InotifyService;
+class InotifyWatchRegistry;
 class Lock;
 
 class InotifyEventLoop
@@ -38,7 +39,7 @@ class InotifyEventLoop
     };
 
   public:
-    InotifyEventLoop(int inotifyInstance, InotifyService *inotifyService);
+    InotifyEventLoop(int inotifyInstance, InotifyWatchRegistry *registry);
 
     bool isLooping();
 
@@ -60,9 +61,9 @@ class InotifyEventLoop
                  bool                isDirectoryEvent,
                  InotifyRenameEvent &renameEvent);
 
-    InotifyService *  mInotifyService;
-    const int         mInotifyInstance;
-    std::atomic<bool> mStopped;
+    InotifyWatchRegistry *mRegistry;
+    const int             mInotifyInstance;
+    std::atomic<bool>     mStopped;
 
     pthread_t           mEventLoop;
     SingleshotSemaphore mThreadStartedSemaphore;
@@ -7,27 +7,44 @@
 #include <stdlib.h>
 #include <sys/inotify.h>
 #include <sys/stat.h>
+#include <chrono>
 #include <filesystem>
 #include <map>
+#include <vector>
 
 namespace pfw {
 
+class InotifyNode;
 class InotifyTree;
 
+struct IdleSubtree {
+    InotifyNode *                         node;
+    size_t                                watchCount;
+    std::chrono::steady_clock::time_point lastActivity;
+};
+
+/**
+ * A watched directory. A node only knows its own name, its absolute path is
+ * derived from its parents. The name of a node without a parent (a root of
+ * the tree) is the absolute path of the directory, which allows to re-parent
+ * whole subtrees without touching their children.
+ */
 class InotifyNode
 {
   public:
     InotifyNode(InotifyTree *                tree,
                 int                          inotifyInstance,
                 InotifyNode *                parent,
-                const std::filesystem::path &rootFileWatcherPath,
-                const std::filesystem::path &relativePath,
+                const std::filesystem::path &name,
                 bool                         bSendInitEvent);
 
-    void initRecursively(bool bSendInitEvent);
-    void addChild(const std::filesystem::path &name, bool sendInitEvents);
-    void fixPaths();
-    std::filesystem::path getRelPath();
+    void         initRecursively(bool bSendInitEvent);
+    InotifyNode *addChild(const std::filesystem::path &name,
+                          bool                         sendInitEvents);
+    InotifyNode *getChild(const std::filesystem::path &name);
+    void         applyFilter();
+    void         rescan();
+    std::filesystem::path getPath();
     std::filesystem::path getName();
     InotifyNode *         getParent();
     bool                  isAlive();
@@ -36,28 +53,44 @@ class InotifyNode
     void                  insertChild(InotifyNode *childNode);
     void                  setNewParent(const std::filesystem::path &filename,
                                        InotifyNode *                parentNode);
+    void                  makeRoot(const std::filesystem::path &path);
+
+    /**
+     * Marks the node and all of its parents as active.
+     */
+    void touch();
+
+    /**
+     * Collects every subtree below this node, which has not been active
+     * since `idleSince`.
+     *
+     * \return the number of watches of the subtree of this node
+     */
+    size_t collectIdle(std::vector<IdleSubtree> &            idle,
+                       std::chrono::steady_clock::time_point idleSince);
 
     ~InotifyNode();
 
   private:
-    static std::filesystem::path
-                     createFullPath(const std::filesystem::path &root,
-                                    const std::filesystem::path &relPath);
+    InotifyNode *createChild(const std::filesystem::path &name,
+                             bool                         sendInitEvents);
+    int          watchAttributes();
+
     static const int ATTRIBUTES = IN_ATTRIB | IN_CREATE | IN_DELETE |
                                   IN_MODIFY | IN_MOVED_FROM | IN_MOVED_TO |
                                   IN_DELETE_SELF;
 
     bool                                            mAlive;
     std::map<std::filesystem::path, InotifyNode *> *mChildren;
-    const std::filesystem::path                     mFileWatcherRoot;
-    std::filesystem::path                           mRelPath;
+    std::filesystem::path                           mName;
     const int                                       mInotifyInstance;
     InotifyNode *                                   mParent;
     InotifyTree *                                   mTree;
     int                                             mWatchDescriptor;
     bool                                            mWatchDescriptorInitialized;
+    std::chrono::steady_clock::time_point           mLastActivity;
 };
 
 }  // namespace pfw
 
-#endif /* PFW_INOTIFY_NODE_H */
\ No newline at end of file
+#endif /* PFW_INOTIFY_NODE_H */
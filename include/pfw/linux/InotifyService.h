@@ -1,63 +1,56 @@
 #ifndef PFW_INOTIFY_SERVICE_H
 #define PFW_INOTIFY_SERVICE_H
 
-#include <map>
-#include <queue>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
 
+#include "pfw/Backend.h"
 #include "pfw/Filter.h"
 #include "pfw/linux/Collector.h"
-#include "pfw/linux/InotifyEventLoop.h"
-#include "pfw/linux/InotifyTree.h"
+#include "pfw/linux/InotifyWatchRegistry.h"
 
 namespace pfw {
 
-class InotifyEventLoop;
-class InotifyTree;
-
-class InotifyService
+/**
+ * Subscribes the roots of one watcher at the process-wide
+ * InotifyWatchRegistry and collects the events the registry hands over.
+ */
+class InotifyService : public Backend
 {
   public:
     InotifyService(std::shared_ptr<Filter>         filter,
                    const std::filesystem::path &   path,
                    const std::chrono::milliseconds latency);
 
-    bool isWatching();
+    bool isWatching() override;
+    void applyFilterOptions(const FilterOptions &previous) override;
+
+    /**
+     * Adds a further root to the service. Roots may overlap with the roots
+     * of this or any other service, the kernel watches are shared then.
+     */
+    bool addRoot(const std::filesystem::path &path) override;
+    bool removeRoot(const std::filesystem::path &path) override;
+    std::vector<std::filesystem::path> roots() override;
 
     ~InotifyService();
 
   private:
-    void create(int wd, std::filesystem::path name);
-    void
-         createDirectory(int wd, std::filesystem::path name, bool sendInitEvents);
-    void dispatch(EventType action, int wd, std::filesystem::path name);
-    void dispatch(EventType             actionOld,
-                  int                   wdOld,
-                  std::filesystem::path nameOld,
-                  EventType             actionNew,
-                  int                   wdNew,
-                  std::filesystem::path nameNew);
-    void modify(int wd, std::filesystem::path name);
-    void remove(int wd, std::filesystem::path name);
-    void removeDirectory(int wd);
-    void removeDirectory(int wd, const std::filesystem::path &name);
-    void sendError(std::string errorMsg);
-    void move(int                   wdOld,
-              std::filesystem::path oldName,
-              int                   wdNew,
-              std::filesystem::path newName);
-    void moveDirectory(int                   wdOld,
-                       std::filesystem::path oldName,
-                       int                   wdNew,
-                       std::filesystem::path newName);
-
-    InotifyEventLoop *         mEventLoop;
-    std::shared_ptr<Collector> mCollector;
-    InotifyTree *              mTree;
-    int                        mInotifyInstance;
-
-    friend class InotifyEventLoop;
+    void sendError(const std::string &errorMsg, const std::filesystem::path &root);
+    void rootAdded(const std::filesystem::path &root);
+    void rootRemoved(const std::filesystem::path &root);
+
+    std::shared_ptr<InotifyWatchRegistry> mRegistry;
+    std::shared_ptr<Filter>               mFilter;
+    std::shared_ptr<Collector>            mCollector;
+    std::set<std::filesystem::path>       mRoots;
+    std::mutex                            mRootsMutex;
+
+    friend class InotifyWatchRegistry;
 };
 
 }  // namespace pfw
 
-#endif /* PFW_INOTIFY_SERVICE_H */
\ No newline at end of file
+#endif /* PFW_INOTIFY_SERVICE_H */
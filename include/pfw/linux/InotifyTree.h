@@ -12,49 +12,100 @@
 #include <sys/stat.h>
 #include <vector>
 
-#include "pfw/linux/Collector.h"
+#include "pfw/Filter.h"
 #include "pfw/linux/InotifyNode.h"
 
 namespace pfw {
 
+class InotifyWatchRegistry;
+
+/**
+ * The forest of watched directories of one inotify instance. Every root of
+ * the tree is addressed by its absolute path. The tree itself is not
+ * synchronized, the owning InotifyWatchRegistry serializes all access.
+ */
 class InotifyTree
 {
   public:
-    InotifyTree(int                          inotifyInstance,
-                const std::filesystem::path &path,
-                std::shared_ptr<Collector>   collector);
-
-    void addDirectory(int                          wd,
-                      const std::filesystem::path &name,
-                      bool                         sendInitEvents);
-    bool getRelPath(std::filesystem::path &out, int wd);
-    bool isRootAlive();
-    bool nodeExists(int wd);
-    void removeDirectory(int wd);
-    void removeDirectory(int wd, const std::filesystem::path &name);
-    void moveDirectory(int                          wdOld,
-                       const std::filesystem::path &oldName,
-                       int                          wdNew,
-                       const std::filesystem::path &newName);
-    void sendInitEvent(const std::filesystem::path relPath);
+    InotifyTree(int inotifyInstance, InotifyWatchRegistry *registry);
+
+    /**
+     * Crawls the given directory as an additional root of the tree. Roots
+     * which are located below the new root are adopted by it.
+     */
+    InotifyNode *addRoot(const std::filesystem::path &path);
+    void         removeRoot(const std::filesystem::path &path);
+    InotifyNode *adoptRoot(const std::filesystem::path &path,
+                           InotifyNode *                parent);
+    InotifyNode *detachNode(const std::filesystem::path &path);
+    bool         isRoot(const std::filesystem::path &path);
+    std::vector<std::filesystem::path> roots();
+
+    /**
+     * \return the root containing the given absolute path or NULL
+     */
+    InotifyNode *findRootOf(const std::filesystem::path &path);
+
+    /**
+     * \return the node of the given absolute path or NULL if it is not
+     *         observed by the tree
+     */
+    InotifyNode *findNode(const std::filesystem::path &path);
+
+    /**
+     * Like `findNode()`, but missing directories below an existing root are
+     * added to the tree on the way.
+     */
+    InotifyNode *ensureNode(const std::filesystem::path &path);
+
+    void   addDirectory(int                          wd,
+                        const std::filesystem::path &name,
+                        bool                         sendInitEvents);
+    bool   getPath(std::filesystem::path &out, int wd);
+    bool   isRoot(int wd);
+    bool   isRootAlive();
+    bool   nodeExists(int wd);
+    void   removeDirectory(int wd);
+    void   removeDirectory(int wd, const std::filesystem::path &name);
+    void   moveDirectory(int                          wdOld,
+                         const std::filesystem::path &oldName,
+                         int                          wdNew,
+                         const std::filesystem::path &newName);
+    void   sendInitEvent(const std::filesystem::path &path);
+    bool   isWatched(const std::filesystem::path &path);
+    size_t watchCount();
+    void   touch(int wd);
+    void   collectIdle(std::vector<IdleSubtree> &            idle,
+                       std::chrono::steady_clock::time_point idleSince);
+
+    /**
+     * Removes every directory which is not watched anymore and crawls the
+     * given subtree of `node`, which might have been skipped so far.
+     */
+    void applyFilter();
+    void applyNewlyIncluded(InotifyNode *                node,
+                            const std::filesystem::path &relPath);
 
     ~InotifyTree();
 
   private:
-    void         sendError(const std::string &error);
+    void         sendError(const std::string &          error,
+                           const std::filesystem::path &path);
+    bool         reserveWatch(const std::filesystem::path &path);
+    void         watchLimitReached(const std::filesystem::path &path);
     void         addNodeReferenceByWD(int watchDescriptor, InotifyNode *node);
     void         removeNodeReferenceByWD(int watchDescriptor);
     InotifyNode *getInotifyTreeByWatchDescriptor(int watchDescriptor);
 
-    std::mutex                   mapBlock;
-    std::shared_ptr<Collector>   mCollector;
-    const int                    mInotifyInstance;
-    std::map<int, InotifyNode *> mInotifyNodeByWatchDescriptor;
-    InotifyNode *                mRoot;
+    std::mutex                                     mapBlock;
+    InotifyWatchRegistry *                         mRegistry;
+    const int                                      mInotifyInstance;
+    std::map<int, InotifyNode *>                   mInotifyNodeByWatchDescriptor;
+    std::map<std::filesystem::path, InotifyNode *> mRoots;
 
     friend class InotifyNode;
 };
 
 }  // namespace pfw
 
-#endif /* PFW_INOTIFY_TREE_H */
\ No newline at end of file
+#endif /* PFW_INOTIFY_TREE_H */
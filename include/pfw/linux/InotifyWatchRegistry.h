@@ -0,0 +1,194 @@
+#ifndef PFW_INOTIFY_WATCH_REGISTRY_H
+#define PFW_INOTIFY_WATCH_REGISTRY_H
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "pfw/Filter.h"
+#include "pfw/MountTable.h"
+#include "pfw/PollingScanner.h"
+
+namespace pfw {
+
+class InotifyEventLoop;
+class InotifyService;
+class InotifyTree;
+
+/**
+ * Process-wide owner of the inotify instance, its event loop and the tree of
+ * watched directories. Every InotifyService subscribes its roots here, so
+ * watchers with overlapping roots share their kernel watches and crawl
+ * results. Each event is fanned out to every subscriber whose root contains
+ * it, relative to that root.
+ *
+ * The number of kernel watches is limited by a watch budget, which defaults
+ * to three quarters of `max_user_watches`. Directories beyond the budget are
+ * polled at a low frequency instead. Subtrees which become busy while being
+ * polled are promoted back to inotify, the least recently active watched
+ * subtrees are demoted to polling in exchange. The snapshot a polled subtree
+ * starts from is taken without holding the registry lock, so that the event
+ * loop is not blocked by it; a demoted subtree keeps its watches until then.
+ *
+ * Mount points below a root are handled by the kind of their file system:
+ * network and FUSE mounts are always polled, pseudo file systems like `/proc`
+ * are skipped, as is every mount if the filter stays on one file system.
+ */
+class InotifyWatchRegistry
+{
+  public:
+    /**
+     * \return the registry of the process; it is created on demand and
+     *         destroyed together with its last subscriber
+     */
+    static std::shared_ptr<InotifyWatchRegistry> instance();
+
+    ~InotifyWatchRegistry();
+
+    bool isValid();
+    bool isLooping();
+
+    bool subscribe(InotifyService *service, const std::filesystem::path &root);
+    void unsubscribe(InotifyService *              service,
+                     const std::filesystem::path &root);
+    void applyFilterOptions(InotifyService *     service,
+                            const FilterOptions &previous);
+
+    /**
+     * \return the number of kernel watches currently held by the registry
+     */
+    size_t watchCount();
+
+    size_t watchBudget();
+
+    /**
+     * Changes the maximum number of kernel watches of the registry. Watched
+     * subtrees are demoted to polling until the new budget is met.
+     */
+    void setWatchBudget(size_t budget);
+    void setPollingInterval(std::chrono::milliseconds interval);
+
+    /**
+     * \return the directories whose subtrees are polled instead of watched
+     */
+    std::vector<std::filesystem::path> polledPaths();
+
+    static std::filesystem::path normalize(const std::filesystem::path &path);
+
+  private:
+    using ServiceEvents = std::map<InotifyService *, std::vector<EventPtr>>;
+
+    struct PolledSubtree {
+        enum State {
+            // the snapshot has not been taken yet
+            PENDING,
+            // the snapshot is being taken without the lock held
+            STARTING,
+            POLLING
+        };
+
+        std::shared_ptr<PollingScanner> scanner;
+        // the number of consecutive scans which detected changes
+        unsigned busyScans;
+        // the file system does not notify changes, so it is never promoted
+        bool  remote;
+        State state;
+        // the watches of the subtree are removed once it is polled
+        bool demoted;
+    };
+
+    // consecutive busy scans after which a polled subtree is promoted
+    static constexpr unsigned PROMOTION_SCANS = 2;
+    // polling intervals a watched subtree has to be idle to be demoted
+    static constexpr unsigned DEMOTION_IDLE_SCANS = 10;
+
+    InotifyWatchRegistry();
+
+    bool addSubscription(InotifyService *             service,
+                         const std::filesystem::path &root);
+    void applyFilter(InotifyService *service, const FilterOptions &previous);
+
+    void create(int wd, std::filesystem::path name);
+    void
+         createDirectory(int wd, std::filesystem::path name, bool sendInitEvents);
+    void dispatch(EventType action, int wd, std::filesystem::path name);
+    void dispatch(EventType             actionOld,
+                  int                   wdOld,
+                  std::filesystem::path nameOld,
+                  EventType             actionNew,
+                  int                   wdNew,
+                  std::filesystem::path nameNew);
+    void modify(int wd, std::filesystem::path name);
+    void remove(int wd, std::filesystem::path name);
+    void removeDirectory(int wd);
+    void removeDirectory(int wd, const std::filesystem::path &name);
+    void sendError(std::string errorMsg);
+    void move(int                   wdOld,
+              std::filesystem::path oldName,
+              int                   wdNew,
+              std::filesystem::path newName);
+    void moveDirectory(int                   wdOld,
+                       std::filesystem::path oldName,
+                       int                   wdNew,
+                       std::filesystem::path newName);
+
+    bool isWatched(const std::filesystem::path &path);
+    void sendInitEvent(const std::filesystem::path &path);
+    void sendError(const std::string &errorMsg, const std::filesystem::path &path);
+
+    void collect(ServiceEvents &              events,
+                 EventType                    action,
+                 const std::filesystem::path &path);
+    void deliver(ServiceEvents &events);
+    void dropSubscriptions(const std::filesystem::path &path);
+    bool isCompletelyCrawled(InotifyService *              service,
+                             const std::filesystem::path &root);
+    bool isNeededBySubscription(const std::filesystem::path &path);
+
+    bool   reserveWatch(const std::filesystem::path &path);
+    void   watchLimitReached(const std::filesystem::path &path);
+    size_t countDirectories(const std::filesystem::path &path, size_t limit);
+    void   demoteIdle(size_t                                count,
+                      const std::filesystem::path &         exclude,
+                      std::chrono::steady_clock::time_point idleSince);
+    void   demote(const std::filesystem::path &path);
+    void   makeRoomFor(const std::filesystem::path &path);
+    void   promote(const std::filesystem::path &path);
+    void   startPolling(const std::filesystem::path &path);
+    // takes the pending snapshots, requires the lock not to be held
+    void   startPendingPolling();
+    bool   hasPolling(PolledSubtree::State state);
+    void   stopPolling(const std::filesystem::path &path);
+    void   prunePolling();
+    void   pollingLoop();
+    std::chrono::steady_clock::time_point idleSince();
+
+    static size_t defaultWatchBudget();
+
+    std::recursive_mutex mMutex;
+    int                  mInotifyInstance;
+    InotifyTree *        mTree;
+    InotifyEventLoop *   mEventLoop;
+    std::map<std::filesystem::path, std::vector<InotifyService *>>
+               mSubscriptions;
+    MountTable mMounts;
+
+    size_t                                         mWatchBudget;
+    std::chrono::milliseconds                      mPollingInterval;
+    std::map<std::filesystem::path, PolledSubtree> mPolled;
+    std::thread                                    mPollingThread;
+    std::condition_variable_any                    mPollingCondition;
+    bool                                           mStopPolling;
+
+    friend class InotifyEventLoop;
+    friend class InotifyTree;
+};
+
+}  // namespace pfw
+
+#endif /* PFW_INOTIFY_WATCH_REGISTRY_H */
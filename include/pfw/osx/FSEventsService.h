@@ -9,6 +9,7 @@
 #include <time.h>
 #include <vector>
 
+#include "pfw/Backend.h"
 #include "pfw/Filter.h"
 #include "pfw/osx/OSXHeader.h"
 
@@ -16,7 +17,7 @@ namespace pfw {
 
 class RunLoop;
 
-class FSEventsService
+class FSEventsService : public Backend
 {
   public:
     FSEventsService(std::shared_ptr<Filter>          filter,
@@ -32,7 +33,11 @@ class FSEventsService
                             const FSEventStreamEventId    eventIds[]);
 
     void                         sendError(const std::string &errorMsg);
-    bool                         isWatching();
+    bool isWatching() override;
+    void applyFilterOptions(const FilterOptions &previous) override;
+    bool addRoot(const std::filesystem::path &path) override;
+    bool removeRoot(const std::filesystem::path &path) override;
+    std::vector<std::filesystem::path> roots() override;
     const std::filesystem::path &rootPath();
 
     ~FSEventsService();
@@ -0,0 +1,56 @@
+#ifndef PFW_POLLING_SERVICE_H
+#define PFW_POLLING_SERVICE_H
+
+#include <condition_variable>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "pfw/Backend.h"
+#include "pfw/Filter.h"
+#include "pfw/PollingScanner.h"
+
+namespace pfw {
+
+/**
+ * A portable backend which detects changes by periodically scanning the
+ * watched roots, for file systems like NFS or FUSE mounts which do not
+ * deliver change notifications. The latency of the watcher is used as the
+ * polling interval.
+ */
+class PollingService : public Backend
+{
+  public:
+    PollingService(std::shared_ptr<Filter>         filter,
+                   const std::filesystem::path &   path,
+                   const std::chrono::milliseconds latency);
+
+    bool isWatching() override;
+    void applyFilterOptions(const FilterOptions &previous) override;
+    bool addRoot(const std::filesystem::path &path) override;
+    bool removeRoot(const std::filesystem::path &path) override;
+    std::vector<std::filesystem::path> roots() override;
+
+    ~PollingService();
+
+  private:
+    void work();
+
+    std::shared_ptr<Filter>   mFilter;
+    std::chrono::milliseconds mInterval;
+    std::map<std::filesystem::path, std::shared_ptr<PollingScanner>>
+                            mScanners;
+    std::mutex              mMutex;
+    // serializes the scans of the polling thread with resets
+    std::mutex              mScanMutex;
+    std::condition_variable mCondition;
+    bool                    mStopped;
+    std::thread             mThread;
+};
+
+}  // namespace pfw
+
+#endif /* PFW_POLLING_SERVICE_H */
@@ -0,0 +1,47 @@
+#ifndef PFW_REPLAY_BACKEND_H
+#define PFW_REPLAY_BACKEND_H
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "pfw/Backend.h"
+#include "pfw/Filter.h"
+
+namespace pfw {
+
+/**
+ * A backend which does not observe the file system at all, it only delivers
+ * the events handed to `replay()`. This allows to test consumers of the
+ * watcher deterministically.
+ */
+class ReplayBackend : public Backend
+{
+  public:
+    ReplayBackend(std::shared_ptr<Filter>         filter,
+                  const std::filesystem::path &   path,
+                  const std::chrono::milliseconds latency);
+
+    bool isWatching() override;
+    void applyFilterOptions(const FilterOptions &previous) override;
+    bool addRoot(const std::filesystem::path &path) override;
+    bool removeRoot(const std::filesystem::path &path) override;
+    std::vector<std::filesystem::path> roots() override;
+
+    /**
+     * Delivers the events as one batch. Events without a root are assigned
+     * to the first root.
+     */
+    void replay(std::vector<EventPtr> &&events);
+    void sendError(const std::string &errorMsg, const std::filesystem::path &root);
+
+  private:
+    std::shared_ptr<Filter>            mFilter;
+    std::mutex                         mMutex;
+    std::vector<std::filesystem::path> mRoots;
+};
+
+}  // namespace pfw
+
+#endif /* PFW_REPLAY_BACKEND_H */
@@ -5,13 +5,14 @@
 #include <memory>
 #include <string>
 
+#include "pfw/Backend.h"
 #include "pfw/win32/Collector.h"
 #include "pfw/win32/Watcher.h"
 #include "pfw/win32/WindowsHeader.h"
 
 namespace pfw {
 
-class Controller
+class Controller : public Backend
 {
   public:
     Controller(FilterPtr                       filter,
@@ -19,7 +20,12 @@ class Controller
                const std::chrono::milliseconds latency);
     ~Controller();
 
-    bool isWatching();
+    bool isWatching() override;
+    void applyFilterOptions(const FilterOptions &previous) override;
+
+    bool addRoot(const std::filesystem::path &path) override;
+    bool removeRoot(const std::filesystem::path &path) override;
+    std::vector<std::filesystem::path> roots() override;
 
   private:
     std::unique_ptr<Watcher>   mWatcher;
@@ -27,6 +33,8 @@ class Controller
 
     HANDLE openDirectory(const std::filesystem::path &path);
     HANDLE mDirectoryHandle;
+
+    std::filesystem::path mPath;
 };
 
 }  // namespace pfw
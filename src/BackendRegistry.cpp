@@ -0,0 +1,134 @@
+#include "pfw/BackendRegistry.h"
+
+#include "pfw/MountTable.h"
+#include "pfw/internal/definitions.h"
+#include "pfw/polling/PollingService.h"
+#include "pfw/replay/ReplayBackend.h"
+
+#ifdef PFW_WINDOWS
+#include "pfw/win32/Controller.h"
+#elif PFW_APPLE
+#include "pfw/osx/FSEventsService.h"
+#elif PFW_LINUX
+#include "pfw/linux/FanotifyService.h"
+#include "pfw/linux/InotifyService.h"
+#endif
+
+using namespace pfw;
+
+namespace {
+
+template <typename T> BackendRegistry::Factory factoryOf()
+{
+    return [](std::shared_ptr<Filter>         filter,
+              const std::filesystem::path &   path,
+              const std::chrono::milliseconds latency) {
+        return std::unique_ptr<Backend>(new T(filter, path, latency));
+    };
+}
+
+}  // namespace
+
+BackendRegistry &BackendRegistry::instance()
+{
+    static BackendRegistry registry;
+    return registry;
+}
+
+BackendRegistry::BackendRegistry()
+{
+#ifdef PFW_WINDOWS
+    mFactories[WINDOWS] = factoryOf<Controller>();
+#elif PFW_APPLE
+    mFactories[FSEVENTS] = factoryOf<FSEventsService>();
+#elif PFW_LINUX
+    mFactories[INOTIFY]  = factoryOf<InotifyService>();
+    mFactories[FANOTIFY] = [](std::shared_ptr<Filter>         filter,
+                              const std::filesystem::path &   path,
+                              const std::chrono::milliseconds latency) {
+        std::unique_ptr<FanotifyService> service(
+            new FanotifyService(filter, path, latency));
+        if (service->isValid()) {
+            return std::unique_ptr<Backend>(std::move(service));
+        }
+        return std::unique_ptr<Backend>(
+            new InotifyService(filter, path, latency));
+    };
+#endif
+    mFactories[POLLING] = factoryOf<PollingService>();
+    mFactories[REPLAY]  = factoryOf<ReplayBackend>();
+}
+
+std::string BackendRegistry::nativeName()
+{
+#ifdef PFW_USE_POLLING
+    return POLLING;
+#elif PFW_WINDOWS
+    return WINDOWS;
+#elif PFW_APPLE
+    return FSEVENTS;
+#elif PFW_LINUX
+    return INOTIFY;
+#else
+    return POLLING;
+#endif
+}
+
+void BackendRegistry::registerBackend(const std::string &name, Factory factory)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFactories[name] = std::move(factory);
+}
+
+bool BackendRegistry::contains(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mFactories.find(name) != mFactories.end();
+}
+
+std::vector<std::string> BackendRegistry::names()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    std::vector<std::string> result;
+    for (const auto &factory : mFactories) {
+        result.push_back(factory.first);
+    }
+    return result;
+}
+
+std::string BackendRegistry::resolve(const std::string &          name,
+                                     const std::filesystem::path &root)
+{
+    if (name == NATIVE) {
+        return nativeName();
+    }
+    if (name != AUTO) {
+        return name;
+    }
+
+    // changes made by other machines are not notified on network and FUSE
+    // file systems
+    if (MountTable::kindOfPath(root) == MountTable::REMOTE) {
+        return POLLING;
+    }
+    return nativeName();
+}
+
+std::unique_ptr<Backend>
+BackendRegistry::create(const std::string &             name,
+                        std::shared_ptr<Filter>         filter,
+                        const std::filesystem::path &   path,
+                        const std::chrono::milliseconds latency)
+{
+    Factory factory;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto                        itr = mFactories.find(resolve(name, path));
+        if (itr == mFactories.end()) {
+            return nullptr;
+        }
+        factory = itr->second;
+    }
+    return factory(filter, path, latency);
+}
@@ -0,0 +1,109 @@
+#include "pfw/ChangeIndex.h"
+
+#include <atomic>
+#include <chrono>
+
+using namespace pfw;
+
+namespace {
+
+uint64_t nextInstance()
+{
+    // distinct across watchers of the process as well as across restarts
+    static std::atomic<uint64_t> counter(0);
+    const uint64_t               now =
+        std::chrono::system_clock::now().time_since_epoch().count();
+    return (now << 16) + (++counter & 0xffff);
+}
+
+}  // namespace
+
+ChangeIndex::ChangeIndex(size_t maxPaths)
+    : mMaxPaths(maxPaths)
+    , mInstance(nextInstance())
+    , mClock(0)
+    , mOldestClock(0)
+{
+}
+
+void ChangeIndex::add(const std::vector<EventPtr> &events)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (const auto &event : events) {
+        if (failed(event->type)) {
+            continue;
+        }
+
+        ++mClock;
+        if (buffer_overflow(event->type)) {
+            // the changes before the overflow are incomplete
+            mPaths.clear();
+            mByClock.clear();
+            mOldestClock = mClock;
+            continue;
+        }
+
+        // both paths of a combined rename changed
+        if (!event->previousPath.empty()) {
+            record(event->root, event->previousPath, DELETED | RENAMED);
+            ++mClock;
+        }
+        record(event->root, event->relativePath, event->type);
+    }
+}
+
+void ChangeIndex::record(const fs::path &root,
+                         const fs::path &relativePath,
+                         EventType       type)
+{
+    auto inserted = mPaths.emplace(Key(root, relativePath), Entry());
+    auto &entry   = inserted.first->second;
+    if (!inserted.second) {
+        mByClock.erase(entry.clock);
+    }
+    entry.clock = mClock;
+    for (size_t bit = 0; bit < entry.typeClocks.size(); ++bit) {
+        if (type & (1u << bit)) {
+            entry.typeClocks[bit] = mClock;
+        }
+    }
+    mByClock.emplace(mClock, inserted.first);
+
+    if (mPaths.size() > mMaxPaths) {
+        const auto oldest = mByClock.begin();
+        mOldestClock      = oldest->first;
+        mPaths.erase(oldest->second);
+        mByClock.erase(oldest);
+    }
+}
+
+ChangeToken ChangeIndex::token()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return {mInstance, mClock};
+}
+
+Changes ChangeIndex::changesSince(const ChangeToken &token)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    Changes changes;
+    changes.token           = {mInstance, mClock};
+    changes.isFreshInstance = token.instance != mInstance ||
+                              token.clock < mOldestClock ||
+                              token.clock > mClock;
+
+    const auto since = changes.isFreshInstance ? 0 : token.clock;
+    for (auto it = mByClock.upper_bound(since); it != mByClock.end(); ++it) {
+        const auto &path = *it->second;
+        EventType   type = NOOP;
+        for (size_t bit = 0; bit < path.second.typeClocks.size(); ++bit) {
+            if (path.second.typeClocks[bit] > since) {
+                type = type | static_cast<EventType>(1u << bit);
+            }
+        }
+        changes.events.emplace_back(std::make_unique<Event>(
+            type, path.first.second, path.first.first));
+    }
+    return changes;
+}
@@ -0,0 +1,349 @@
+#include "pfw/DigestCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+using namespace pfw;
+
+namespace {
+
+const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+const size_t STRIPE_SIZE = 32;
+const size_t CHUNK_SIZE  = 64 * 1024;
+
+// a digest computed within this window of the mtime is not trusted, as a
+// later write might not advance a coarse mtime
+const int64_t RACY_WINDOW_NS = 2000000000LL;
+
+uint64_t rotl(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t read64(const char *data)
+{
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+uint32_t read32(const char *data)
+{
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+uint64_t accumulate(uint64_t accumulator, uint64_t input)
+{
+    accumulator += input * PRIME64_2;
+    return rotl(accumulator, 31) * PRIME64_1;
+}
+
+uint64_t mergeRound(uint64_t accumulator, uint64_t value)
+{
+    accumulator ^= accumulate(0, value);
+    return accumulator * PRIME64_1 + PRIME64_4;
+}
+
+// XXH64 over data which arrives in chunks; the four independent lanes are
+// what allows the compiler to vectorize the stripe loop
+class Hasher
+{
+  public:
+    Hasher()
+        : mLanes{PRIME64_1 + PRIME64_2, PRIME64_2, 0, 0 - PRIME64_1}
+        , mTotalSize(0)
+        , mBufferSize(0)
+    {
+    }
+
+    void update(const char *data, size_t size)
+    {
+        mTotalSize += size;
+
+        if (mBufferSize > 0) {
+            const size_t missing = std::min(size, STRIPE_SIZE - mBufferSize);
+            std::memcpy(mBuffer + mBufferSize, data, missing);
+            mBufferSize += missing;
+            data += missing;
+            size -= missing;
+            if (mBufferSize < STRIPE_SIZE) {
+                return;
+            }
+            stripe(mBuffer);
+            mBufferSize = 0;
+        }
+
+        for (; size >= STRIPE_SIZE; data += STRIPE_SIZE, size -= STRIPE_SIZE) {
+            stripe(data);
+        }
+        std::memcpy(mBuffer, data, size);
+        mBufferSize = size;
+    }
+
+    uint64_t digest() const
+    {
+        uint64_t hash;
+        if (mTotalSize >= STRIPE_SIZE) {
+            hash = rotl(mLanes[0], 1) + rotl(mLanes[1], 7) +
+                   rotl(mLanes[2], 12) + rotl(mLanes[3], 18);
+            for (const auto lane : mLanes) {
+                hash = mergeRound(hash, lane);
+            }
+        } else {
+            hash = PRIME64_5;
+        }
+        hash += mTotalSize;
+
+        const char *data = mBuffer;
+        size_t      size = mBufferSize;
+        for (; size >= 8; data += 8, size -= 8) {
+            hash ^= accumulate(0, read64(data));
+            hash = rotl(hash, 27) * PRIME64_1 + PRIME64_4;
+        }
+        if (size >= 4) {
+            hash ^= read32(data) * PRIME64_1;
+            hash = rotl(hash, 23) * PRIME64_2 + PRIME64_3;
+            data += 4;
+            size -= 4;
+        }
+        for (; size > 0; ++data, --size) {
+            hash ^= static_cast<uint8_t>(*data) * PRIME64_5;
+            hash = rotl(hash, 11) * PRIME64_1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= PRIME64_2;
+        hash ^= hash >> 29;
+        hash *= PRIME64_3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+  private:
+    void stripe(const char *data)
+    {
+        for (size_t i = 0; i < 4; ++i) {
+            mLanes[i] = accumulate(mLanes[i], read64(data + 8 * i));
+        }
+    }
+
+    uint64_t mLanes[4];
+    uint64_t mTotalSize;
+    char     mBuffer[STRIPE_SIZE];
+    size_t   mBufferSize;
+};
+
+int64_t currentTime()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+}  // namespace
+
+DigestCache::DigestCache(size_t   concurrency,
+                         size_t   maxFiles,
+                         uint64_t hashBudget)
+    : mMaxFiles(maxFiles)
+    , mHashBudget(hashBudget)
+    , mBatch(nullptr)
+    , mNextFile(0)
+    , mRunningFiles(0)
+    , mIsStopping(false)
+{
+    for (size_t i = 1; i < concurrency; ++i) {
+        mWorkers.emplace_back(&DigestCache::run, this);
+    }
+}
+
+DigestCache::~DigestCache()
+{
+    {
+        std::lock_guard<std::mutex> lock(mWorkMutex);
+        mIsStopping = true;
+    }
+    mWorkAvailable.notify_all();
+    for (auto &worker : mWorkers) {
+        worker.join();
+    }
+}
+
+void DigestCache::apply(std::vector<EventPtr> &events)
+{
+    std::vector<Pending> pending;
+    std::vector<Key>     removed;
+    for (auto &event : events) {
+        if (failed(event->type) || buffer_overflow(event->type)) {
+            continue;
+        }
+
+        if (!event->previousPath.empty()) {
+            removed.push_back((event->root / event->previousPath).native());
+        }
+
+        const auto path = event->root / event->relativePath;
+        FileStatus status;
+        if (event->status) {
+            status = *event->status;
+        } else if (!FileStatus::read(path, status)) {
+            removed.push_back(path.native());
+            continue;
+        }
+
+        if (status.type == FileStatus::REGULAR) {
+            pending.push_back({event.get(), path.native(), status});
+        }
+    }
+
+    const auto now = currentTime();
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (const auto &key : removed) {
+            mFiles.erase(key);
+        }
+
+        for (auto &file : pending) {
+            auto entry = mFiles.find(file.key);
+            file.known = entry != mFiles.end();
+            if (file.known) {
+                file.previous = entry->second;
+            }
+            file.needsHash = !file.known ||
+                             file.previous.inode != file.status.inode ||
+                             file.previous.size != file.status.size ||
+                             file.previous.mtime != file.status.mtime ||
+                             file.previous.hashed - file.previous.mtime <
+                                 RACY_WINDOW_NS;
+            file.isReadable = true;
+            file.digest     = file.known ? file.previous.digest : 0;
+        }
+    }
+
+    // only the files whose key changed are read, as long as they fit into
+    // the budget; the others are forgotten, so their next event is delivered
+    uint64_t budget = mHashBudget;
+    for (auto &file : pending) {
+        if (!file.needsHash) {
+            continue;
+        }
+        if (file.status.size > budget) {
+            file.needsHash  = false;
+            file.isReadable = false;
+            continue;
+        }
+        budget -= file.status.size;
+    }
+
+    {
+        std::lock_guard<std::mutex>  batchLock(mBatchMutex);
+        std::unique_lock<std::mutex> lock(mWorkMutex);
+        mBatch        = &pending;
+        mNextFile     = 0;
+        mRunningFiles = 0;
+        mWorkAvailable.notify_all();
+
+        work(lock);
+        mBatchDone.wait(lock, [this]() {
+            return mNextFile == mBatch->size() && mRunningFiles == 0;
+        });
+        mBatch = nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto &file : pending) {
+        if (!file.isReadable) {
+            mFiles.erase(file.key);
+            continue;
+        }
+
+        if (mFiles.size() >= mMaxFiles &&
+            mFiles.find(file.key) == mFiles.end()) {
+            mFiles.erase(mFiles.begin());
+        }
+        mFiles[file.key] = {file.status.inode, file.status.size,
+                            file.status.mtime,
+                            file.needsHash ? now : file.previous.hashed,
+                            file.digest};
+
+        file.event->digest = file.digest;
+        if (file.event->type == MODIFIED && file.known &&
+            file.digest == file.previous.digest) {
+            file.event->type = NOOP;
+        }
+    }
+
+    events.erase(std::remove_if(events.begin(), events.end(),
+                                [](const EventPtr &event) {
+                                    return noop(event->type);
+                                }),
+                 events.end());
+}
+
+void DigestCache::work(std::unique_lock<std::mutex> &lock)
+{
+    while (mNextFile < mBatch->size()) {
+        auto &file = (*mBatch)[mNextFile++];
+        if (!file.needsHash) {
+            continue;
+        }
+
+        ++mRunningFiles;
+        lock.unlock();
+        file.isReadable = hashFile(file.key, file.digest);
+        lock.lock();
+        --mRunningFiles;
+    }
+    mBatchDone.notify_all();
+}
+
+void DigestCache::run()
+{
+    std::unique_lock<std::mutex> lock(mWorkMutex);
+    while (!mIsStopping) {
+        mWorkAvailable.wait(lock, [this]() {
+            return mIsStopping ||
+                   (mBatch != nullptr && mNextFile < mBatch->size());
+        });
+        if (mBatch != nullptr) {
+            work(lock);
+        }
+    }
+}
+
+uint64_t DigestCache::hash(const char *data, size_t size)
+{
+    Hasher hasher;
+    hasher.update(data, size);
+    return hasher.digest();
+}
+
+bool DigestCache::hashFile(const std::filesystem::path &path, uint64_t &digest)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    Hasher            hasher;
+    std::vector<char> chunk(CHUNK_SIZE);
+    while (file) {
+        file.read(chunk.data(), chunk.size());
+        hasher.update(chunk.data(), file.gcount());
+    }
+    if (file.bad()) {
+        return false;
+    }
+
+    digest = hasher.digest();
+    return true;
+}
@@ -0,0 +1,146 @@
+#include "pfw/Dispatcher.h"
+
+#include <algorithm>
+#include <map>
+
+using namespace pfw;
+
+Dispatcher::Dispatcher(size_t concurrency, Partition partition)
+    : mPartition(partition)
+    , mShards(std::max<size_t>(concurrency, 1))
+    , mNextShard(mShards.size())
+    , mRunningShards(0)
+    , mCallback(nullptr)
+    , mIsStopping(false)
+{
+    for (size_t i = 1; i < mShards.size(); ++i) {
+        mWorkers.emplace_back(&Dispatcher::run, this);
+    }
+}
+
+Dispatcher::~Dispatcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mIsStopping = true;
+    }
+    mWorkAvailable.notify_all();
+    for (auto &worker : mWorkers) {
+        worker.join();
+    }
+}
+
+void Dispatcher::dispatch(std::vector<EventPtr> &&events,
+                          const Callback &        callback)
+{
+    if (mWorkers.empty() || events.size() < 2) {
+        callback(std::move(events));
+        return;
+    }
+
+    // the paths linked by a rename keep their order relative to each other,
+    // they share the shard of the first one
+    using Key = std::pair<fs::path, fs::path>;
+    std::map<Key, Key> links;
+    auto               find = [&links](Key key) {
+        auto link = links.find(key);
+        while (link != links.end()) {
+            key  = link->second;
+            link = links.find(key);
+        }
+        return key;
+    };
+    auto link = [&](const Key &first, const Key &second) {
+        const auto from = find(second);
+        const auto to   = find(first);
+        if (from != to) {
+            links[from] = to;
+        }
+    };
+    for (size_t i = 0; i < events.size(); ++i) {
+        const auto &event = *events[i];
+        const Key   key{event.root, keyOf(event.relativePath, mPartition)};
+        if (!event.previousPath.empty()) {
+            link({event.root, keyOf(event.previousPath, mPartition)}, key);
+        }
+
+        // the halves of a rename are adjacent
+        const auto &previous = i > 0 ? *events[i - 1] : event;
+        if (i > 0 && renamed(event.type) && created(event.type) &&
+            renamed(previous.type) && deleted(previous.type) &&
+            previous.root == event.root) {
+            link({previous.root, keyOf(previous.relativePath, mPartition)},
+                 key);
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (auto &event : events) {
+        const auto key =
+            find({event->root, keyOf(event->relativePath, mPartition)});
+        mShards[shard(key.first, key.second, mShards.size())].emplace_back(
+            std::move(event));
+    }
+    events.clear();
+
+    mCallback      = &callback;
+    mNextShard     = 0;
+    mRunningShards = 0;
+    mWorkAvailable.notify_all();
+
+    work(lock);
+    mBatchDone.wait(lock, [this]() {
+        return mNextShard == mShards.size() && mRunningShards == 0;
+    });
+    mCallback = nullptr;
+}
+
+size_t Dispatcher::shard(const Event &event, Partition partition, size_t shards)
+{
+    return shard(event.root, keyOf(event.relativePath, partition), shards);
+}
+
+fs::path Dispatcher::keyOf(const fs::path &relativePath, Partition partition)
+{
+    if (partition == BY_TOP_LEVEL_DIRECTORY) {
+        return relativePath.empty() ? fs::path() : *relativePath.begin();
+    }
+    return relativePath;
+}
+
+size_t
+Dispatcher::shard(const fs::path &root, const fs::path &key, size_t shards)
+{
+    size_t hash = fs::hash_value(root);
+    hash ^= fs::hash_value(key) + 0x9E3779B9 + (hash << 6) + (hash >> 2);
+    return hash % shards;
+}
+
+void Dispatcher::work(std::unique_lock<std::mutex> &lock)
+{
+    while (mNextShard < mShards.size()) {
+        std::vector<EventPtr> events;
+        std::swap(events, mShards[mNextShard++]);
+        if (events.empty()) {
+            continue;
+        }
+
+        ++mRunningShards;
+        lock.unlock();
+        (*mCallback)(std::move(events));
+        lock.lock();
+        --mRunningShards;
+    }
+    mBatchDone.notify_all();
+}
+
+void Dispatcher::run()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (!mIsStopping) {
+        mWorkAvailable.wait(lock, [this]() {
+            return mIsStopping || mNextShard < mShards.size();
+        });
+        work(lock);
+    }
+}
@@ -0,0 +1,558 @@
+#include "pfw/EventJournal.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "pfw/internal/definitions.h"
+
+#ifdef PFW_POSIX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace pfw;
+
+namespace {
+
+const char   SEGMENT_EXTENSION[] = ".log";
+const size_t SEGMENT_NAME_SIZE   = 20;
+// holds the sequence number below which all handed out ones lie
+const char SEQUENCE_FILE[] = "sequence";
+// the sequence numbers reserved at once, a crash skips what is left of them
+const uint64_t SEQUENCE_RESERVATION = uint64_t(1) << 32;
+// payload size and checksum
+const size_t FRAME_HEADER_SIZE = 2 * sizeof(uint32_t);
+
+uint32_t checksum(const char *data, size_t size)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ static_cast<uint8_t>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+void writeVarint(std::string &out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+void writeString(std::string &out, const std::string &value)
+{
+    writeVarint(out, value.size());
+    out += value;
+}
+
+uint64_t zigzag(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^
+           static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// a bounds checked cursor over a frame payload
+struct Reader {
+    const char *position;
+    const char *end;
+
+    bool varint(uint64_t &value)
+    {
+        value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (position == end) {
+                return false;
+            }
+            const auto byte = static_cast<uint8_t>(*position++);
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool bytes(uint64_t size, std::string &out)
+    {
+        if (size > static_cast<uint64_t>(end - position)) {
+            return false;
+        }
+        out.append(position, size);
+        position += size;
+        return true;
+    }
+};
+
+std::string segmentName(uint64_t firstSequence)
+{
+    auto name = std::to_string(firstSequence);
+    name.insert(0, SEGMENT_NAME_SIZE - name.size(), '0');
+    return name + SEGMENT_EXTENSION;
+}
+
+}  // namespace
+
+EventJournal::EventJournal(const fs::path &directory, JournalOptions options)
+    : mDirectory(directory)
+    , mOptions(options)
+    , mStopped(false)
+    , mIsValid(false)
+    , mDirty(false)
+    , mNextSequence(1)
+    , mReservedSequence(0)
+    , mFile(nullptr)
+{
+    std::error_code ec;
+    fs::create_directories(mDirectory, ec);
+    if (!fs::is_directory(mDirectory, ec)) {
+        return;
+    }
+
+    for (const auto &entry : fs::directory_iterator(mDirectory, ec)) {
+        const auto name = entry.path().filename().string();
+        if (entry.path().extension() != SEGMENT_EXTENSION ||
+            name.size() != SEGMENT_NAME_SIZE + sizeof(SEGMENT_EXTENSION) - 1 ||
+            !std::all_of(name.begin(), name.begin() + SEGMENT_NAME_SIZE,
+                         [](char c) { return c >= '0' && c <= '9'; })) {
+            continue;
+        }
+        mSegments.push_back(
+            {std::stoull(name.substr(0, SEGMENT_NAME_SIZE)), entry.path(), 0});
+    }
+    std::sort(mSegments.begin(), mSegments.end(),
+              [](const Segment &lhs, const Segment &rhs) {
+                  return lhs.firstSequence < rhs.firstSequence;
+              });
+
+    for (auto &segment : mSegments) {
+        uint64_t lastSequence = segment.firstSequence - 1;
+        readSegment(segment.path, UINT64_MAX, nullptr, lastSequence,
+                    segment.size);
+        mNextSequence = std::max(mNextSequence, lastSequence + 1);
+    }
+
+    // the sequence numbers handed out before a crash might not have been
+    // synced, they are not reused
+    uint64_t      reserved = 0;
+    std::ifstream sequenceFile(mDirectory / SEQUENCE_FILE, std::ios::binary);
+    if (sequenceFile.read(reinterpret_cast<char *>(&reserved),
+                          sizeof(reserved))) {
+        mNextSequence = std::max(mNextSequence, reserved);
+    }
+    if (!reserveSequences(mNextSequence + SEQUENCE_RESERVATION)) {
+        return;
+    }
+
+    if (mSegments.empty()) {
+        mIsValid = openSegment(mNextSequence);
+    } else {
+        // a frame which has not been written completely is dropped
+        auto &active = mSegments.back();
+        fs::resize_file(active.path, active.size, ec);
+        mFile    = std::fopen(active.path.string().c_str(), "ab");
+        mIsValid = mFile != nullptr;
+    }
+
+    if (mIsValid) {
+        prune();
+        mSyncThread = std::thread([this]() { syncLoop(); });
+    }
+}
+
+EventJournal::~EventJournal()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopped = true;
+    }
+    mCondition.notify_all();
+    if (mSyncThread.joinable()) {
+        mSyncThread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(mFileMutex);
+    if (sync()) {
+        // all sequence numbers are durable, a restart continues right after
+        // them
+        std::lock_guard<std::mutex> sequenceLock(mMutex);
+        reserveSequences(mNextSequence);
+    }
+    if (mFile != nullptr) {
+        std::fclose(mFile);
+    }
+}
+
+bool EventJournal::isValid() { return mIsValid; }
+
+void EventJournal::append(std::vector<EventPtr> &events)
+{
+    if (events.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mIsValid && mNextSequence + events.size() > mReservedSequence) {
+        // this happens only once per SEQUENCE_RESERVATION events
+        mIsValid = reserveSequences(mNextSequence + events.size() +
+                                    SEQUENCE_RESERVATION);
+    }
+
+    const auto firstSequence = mNextSequence;
+    for (auto &event : events) {
+        event->sequence = mNextSequence++;
+    }
+
+    if (mIsValid) {
+        encode(events, firstSequence, mBuffer);
+        mDirty = true;
+    }
+}
+
+bool EventJournal::readSince(uint64_t sequence, std::vector<EventPtr> &out)
+{
+    std::lock_guard<std::mutex> lock(mFileMutex);
+    writeBuffer();
+
+    for (size_t i = 0; i < mSegments.size(); ++i) {
+        // the whole segment has been consumed already
+        if (i + 1 < mSegments.size() &&
+            mSegments[i + 1].firstSequence <= sequence + 1) {
+            continue;
+        }
+
+        uint64_t lastSequence = 0;
+        size_t   validSize    = 0;
+        readSegment(mSegments[i].path, sequence, &out, lastSequence,
+                    validSize);
+    }
+
+    const auto first = mSegments.empty() ? lastSequence() + 1
+                                         : mSegments.front().firstSequence;
+    return sequence + 1 >= first;
+}
+
+uint64_t EventJournal::firstSequence()
+{
+    std::lock_guard<std::mutex> lock(mFileMutex);
+    return mSegments.empty() ? lastSequence() + 1
+                             : mSegments.front().firstSequence;
+}
+
+uint64_t EventJournal::lastSequence()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mNextSequence - 1;
+}
+
+bool EventJournal::flush()
+{
+    std::lock_guard<std::mutex> lock(mFileMutex);
+    return sync();
+}
+
+bool EventJournal::writeBuffer()
+{
+    // the appended frames are taken over, so that appending continues while
+    // they are written
+    uint64_t nextSequence;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::swap(mBuffer, mWriteBuffer);
+        nextSequence = mNextSequence;
+        mDirty       = false;
+    }
+
+    if (mWriteBuffer.empty()) {
+        return true;
+    }
+    if (mFile == nullptr) {
+        mWriteBuffer.clear();
+        return false;
+    }
+
+    const bool written =
+        std::fwrite(mWriteBuffer.data(), 1, mWriteBuffer.size(), mFile) ==
+            mWriteBuffer.size() &&
+        std::fflush(mFile) == 0;
+    mSegments.back().size += mWriteBuffer.size();
+    mWriteBuffer.clear();
+
+    if (mSegments.back().size >= mOptions.segmentSize) {
+        // the finished segment has to be durable before it is pruned
+        fsyncFile(mFile);
+        std::fclose(mFile);
+        mFile = nullptr;
+        openSegment(nextSequence);
+        prune();
+    }
+    return written;
+}
+
+bool EventJournal::sync()
+{
+    if (!writeBuffer() || mFile == nullptr) {
+        return false;
+    }
+    return fsyncFile(mFile);
+}
+
+bool EventJournal::fsyncFile(std::FILE *file)
+{
+#ifdef PFW_POSIX
+    return fsync(fileno(file)) == 0;
+#else
+    return true;
+#endif
+}
+
+bool EventJournal::reserveSequences(uint64_t limit)
+{
+    // the reservation is replaced atomically, a crash leaves the previous one
+    const auto path      = mDirectory / SEQUENCE_FILE;
+    auto       temporary = path;
+    temporary += ".tmp";
+
+    std::FILE *file = std::fopen(temporary.string().c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    const bool written = std::fwrite(&limit, sizeof(limit), 1, file) == 1 &&
+                         std::fflush(file) == 0 && fsyncFile(file);
+    std::fclose(file);
+
+    std::error_code ec;
+    if (!written || (fs::rename(temporary, path, ec), ec)) {
+        return false;
+    }
+
+#ifdef PFW_POSIX
+    // the rename is only durable once the directory is synced
+    const int directory = open(mDirectory.c_str(), O_RDONLY);
+    if (directory < 0) {
+        return false;
+    }
+    const bool synced = fsync(directory) == 0;
+    close(directory);
+    if (!synced) {
+        return false;
+    }
+#endif
+
+    mReservedSequence = limit;
+    return true;
+}
+
+bool EventJournal::openSegment(uint64_t firstSequence)
+{
+    const auto path = mDirectory / segmentName(firstSequence);
+    mFile           = std::fopen(path.string().c_str(), "ab");
+    if (mFile == nullptr) {
+        return false;
+    }
+    mSegments.push_back({firstSequence, path, 0});
+    return true;
+}
+
+void EventJournal::prune()
+{
+    size_t totalSize = 0;
+    for (const auto &segment : mSegments) {
+        totalSize += segment.size;
+    }
+
+    const auto now = fs::file_time_type::clock::now();
+    // the active segment is never pruned
+    while (mSegments.size() > 1) {
+        const auto &    oldest = mSegments.front();
+        std::error_code ec;
+        const auto      modified = fs::last_write_time(oldest.path, ec);
+        const bool      expired  = !ec && now - modified > mOptions.maxAge;
+        if (totalSize <= mOptions.maxSize && !expired) {
+            break;
+        }
+
+        totalSize -= oldest.size;
+        fs::remove(oldest.path, ec);
+        mSegments.erase(mSegments.begin());
+    }
+}
+
+void EventJournal::syncLoop()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (!mStopped) {
+        mCondition.wait_for(lock, mOptions.syncInterval);
+        if (!mDirty || mStopped) {
+            continue;
+        }
+
+        // appending only waits for the buffer to be taken over, not for the
+        // file to be written and synced
+        lock.unlock();
+        {
+            std::lock_guard<std::mutex> fileLock(mFileMutex);
+            sync();
+        }
+        lock.lock();
+    }
+}
+
+bool EventJournal::readSegment(const fs::path &       path,
+                               uint64_t               after,
+                               std::vector<EventPtr> *out,
+                               uint64_t &             lastSequence,
+                               size_t &               validSize)
+{
+    std::ifstream     file(path, std::ios::binary);
+    const std::string data((std::istreambuf_iterator<char>(file)),
+                           std::istreambuf_iterator<char>());
+
+    validSize = 0;
+    while (data.size() - validSize >= FRAME_HEADER_SIZE) {
+        uint32_t header[2];
+        std::memcpy(header, data.data() + validSize, sizeof(header));
+
+        const size_t payload = validSize + FRAME_HEADER_SIZE;
+        if (header[0] > data.size() - payload ||
+            checksum(data.data() + payload, header[0]) != header[1] ||
+            !decode(data.data() + payload, header[0], after, out,
+                    lastSequence)) {
+            return false;
+        }
+        validSize = payload + header[0];
+    }
+    return validSize == data.size();
+}
+
+void EventJournal::encode(const std::vector<EventPtr> &events,
+                          uint64_t                     firstSequence,
+                          std::string &                out)
+{
+    std::string payload;
+    writeVarint(payload, firstSequence);
+    writeVarint(payload, events.size());
+
+    // most batches belong to a single root, it is stored once per frame
+    std::vector<fs::path> roots;
+    for (const auto &event : events) {
+        if (std::find(roots.begin(), roots.end(), event->root) == roots.end()) {
+            roots.push_back(event->root);
+        }
+    }
+    writeVarint(payload, roots.size());
+    for (const auto &root : roots) {
+        writeString(payload, root.u8string());
+    }
+
+    std::string lastPath;
+    int64_t     lastTime = 0;
+    for (const auto &event : events) {
+        payload += static_cast<char>(event->type);
+        writeVarint(payload,
+                    std::find(roots.begin(), roots.end(), event->root) -
+                        roots.begin());
+
+        const int64_t time =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                event->timePoint.time_since_epoch())
+                .count();
+        writeVarint(payload, zigzag(time - lastTime));
+        lastTime = time;
+
+        // siblings share most of their path with their predecessor
+        const auto path   = event->relativePath.u8string();
+        const auto common = std::mismatch(path.begin(), path.end(),
+                                          lastPath.begin(), lastPath.end())
+                                .first -
+                            path.begin();
+        writeVarint(payload, common);
+        writeString(payload, path.substr(common));
+        lastPath = path;
+
+        // empty unless the event is a combined rename
+        writeString(payload, event->previousPath.u8string());
+    }
+
+    const uint32_t header[2] = {static_cast<uint32_t>(payload.size()),
+                                checksum(payload.data(), payload.size())};
+    out.append(reinterpret_cast<const char *>(header), sizeof(header));
+    out += payload;
+}
+
+bool EventJournal::decode(const char *           data,
+                          size_t                 size,
+                          uint64_t               after,
+                          std::vector<EventPtr> *out,
+                          uint64_t &             lastSequence)
+{
+    Reader   reader{data, data + size};
+    uint64_t sequence  = 0;
+    uint64_t count     = 0;
+    uint64_t rootCount = 0;
+    if (!reader.varint(sequence) || !reader.varint(count) ||
+        !reader.varint(rootCount) || rootCount > size) {
+        return false;
+    }
+
+    std::vector<fs::path> roots;
+    for (uint64_t i = 0; i < rootCount; ++i) {
+        uint64_t    rootSize = 0;
+        std::string root;
+        if (!reader.varint(rootSize) || !reader.bytes(rootSize, root)) {
+            return false;
+        }
+        roots.push_back(fs::u8path(root));
+    }
+
+    std::string path;
+    int64_t     time = 0;
+    for (uint64_t i = 0; i < count; ++i, ++sequence) {
+        if (reader.position == reader.end) {
+            return false;
+        }
+        const auto type = static_cast<EventType>(*reader.position++);
+
+        uint64_t rootIndex = 0;
+        uint64_t timeDelta = 0;
+        uint64_t common    = 0;
+        uint64_t suffix    = 0;
+        if (!reader.varint(rootIndex) || rootIndex >= roots.size() ||
+            !reader.varint(timeDelta) || !reader.varint(common) ||
+            common > path.size() || !reader.varint(suffix)) {
+            return false;
+        }
+        path.resize(common);
+
+        uint64_t    previousSize = 0;
+        std::string previousPath;
+        if (!reader.bytes(suffix, path) || !reader.varint(previousSize) ||
+            !reader.bytes(previousSize, previousPath)) {
+            return false;
+        }
+        time += unzigzag(timeDelta);
+
+        if (out != nullptr && sequence > after) {
+            auto event = std::make_unique<Event>(type, fs::u8path(path),
+                                                 roots[rootIndex]);
+            event->timePoint = std::chrono::high_resolution_clock::time_point(
+                std::chrono::duration_cast<
+                    std::chrono::high_resolution_clock::duration>(
+                    std::chrono::nanoseconds(time)));
+            event->sequence     = sequence;
+            event->previousPath = fs::u8path(previousPath);
+            out->emplace_back(std::move(event));
+        }
+    }
+
+    lastSequence = sequence - 1;
+    return reader.position == reader.end;
+}
@@ -0,0 +1,133 @@
+#include "pfw/EventQueue.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <iterator>
+#include <set>
+
+#include "pfw/internal/definitions.h"
+
+#ifdef PFW_LINUX
+#include <sys/eventfd.h>
+#endif
+#ifdef PFW_POSIX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace pfw;
+
+EventQueue::EventQueue(size_t capacity)
+    : mCapacity(std::max<size_t>(capacity, 1))
+    , mReadFd(-1)
+    , mWriteFd(-1)
+{
+#if defined(PFW_LINUX)
+    mReadFd  = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    mWriteFd = mReadFd;
+#elif defined(PFW_POSIX)
+    int fds[2];
+    if (pipe(fds) == 0) {
+        for (const auto fd : fds) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+        mReadFd  = fds[0];
+        mWriteFd = fds[1];
+    }
+#endif
+}
+
+EventQueue::~EventQueue()
+{
+#ifdef PFW_POSIX
+    if (mReadFd != -1) {
+        close(mReadFd);
+    }
+    if (mWriteFd != -1 && mWriteFd != mReadFd) {
+        close(mWriteFd);
+    }
+#endif
+}
+
+void EventQueue::push(std::vector<EventPtr> &&events)
+{
+    if (events.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    const bool                  wasEmpty = mEvents.empty();
+    if (wasEmpty) {
+        std::swap(mEvents, events);
+    } else {
+        mEvents.insert(mEvents.end(), std::make_move_iterator(events.begin()),
+                       std::make_move_iterator(events.end()));
+    }
+
+    if (mEvents.size() > mCapacity) {
+        // the consumer has to scan the roots of the lost events again
+        std::set<fs::path> roots;
+        for (const auto &event : mEvents) {
+            roots.insert(event->root);
+        }
+
+        mEvents.clear();
+        for (const auto &root : roots) {
+            mEvents.emplace_back(
+                std::make_unique<Event>(BUFFER_OVERFLOW, fs::path(), root));
+        }
+    }
+
+    // the descriptor is signaled once until the queue is drained
+    if (wasEmpty) {
+        signal();
+    }
+}
+
+bool EventQueue::poll(std::vector<EventPtr> &batch)
+{
+    batch.clear();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mEvents.empty()) {
+        return false;
+    }
+    std::swap(mEvents, batch);
+    drain();
+    return true;
+}
+
+int EventQueue::fd() const { return mReadFd; }
+
+void EventQueue::signal()
+{
+#ifdef PFW_POSIX
+    if (mWriteFd == -1) {
+        return;
+    }
+#ifdef PFW_LINUX
+    const uint64_t value = 1;
+#else
+    const char value = 0;
+#endif
+    while (write(mWriteFd, &value, sizeof(value)) == -1 && errno == EINTR) {
+    }
+#endif
+}
+
+void EventQueue::drain()
+{
+#ifdef PFW_POSIX
+    if (mReadFd == -1) {
+        return;
+    }
+#ifdef PFW_LINUX
+    uint64_t value;
+#else
+    char value;
+#endif
+    while (read(mReadFd, &value, sizeof(value)) == -1 && errno == EINTR) {
+    }
+#endif
+}
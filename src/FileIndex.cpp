@@ -0,0 +1,352 @@
+#include "pfw/FileIndex.h"
+
+#include <algorithm>
+
+using namespace pfw;
+
+namespace {
+
+const char WILDCARDS[] = "*?";
+
+bool isBelow(const fs::path &parent, const fs::path &child)
+{
+    auto parentItr = parent.begin();
+    auto childItr  = child.begin();
+    for (; parentItr != parent.end(); ++parentItr, ++childItr) {
+        if (childItr == child.end() || *parentItr != *childItr) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool matchFrom(const std::string &pattern,
+               size_t             p,
+               const std::string &path,
+               size_t             s)
+{
+    while (p < pattern.size()) {
+        if (pattern[p] == '*') {
+            if (p + 1 < pattern.size() && pattern[p + 1] == '*') {
+                p += 2;
+                // `**/` matches no directory at all as well
+                if (p < pattern.size() && pattern[p] == '/' &&
+                    matchFrom(pattern, p + 1, path, s)) {
+                    return true;
+                }
+                for (size_t k = s; k <= path.size(); ++k) {
+                    if (matchFrom(pattern, p, path, k)) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            for (size_t k = s; k <= path.size(); ++k) {
+                if (matchFrom(pattern, p + 1, path, k)) {
+                    return true;
+                }
+                if (k < path.size() && path[k] == '/') {
+                    break;
+                }
+            }
+            return false;
+        }
+
+        if (s == path.size() ||
+            (pattern[p] == '?' ? path[s] == '/' : pattern[p] != path[s])) {
+            return false;
+        }
+        ++p;
+        ++s;
+    }
+    return s == path.size();
+}
+
+}  // namespace
+
+FileIndex::FileIndex(PollingScanner::WatchedPredicate isWatched)
+    : mIsWatched(std::move(isWatched))
+{
+}
+
+void FileIndex::addRoot(const fs::path &root)
+{
+    std::vector<std::pair<fs::path, Status>> entries;
+    crawl(root, fs::path(), entries);
+
+    Tree tree;
+    for (const auto &entry : entries) {
+        insert(tree, entry.first, entry.second);
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mTrees[root] = std::move(tree);
+}
+
+void FileIndex::removeRoot(const fs::path &root)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mTrees.erase(root);
+}
+
+void FileIndex::update(const std::vector<EventPtr> &events)
+{
+    std::set<fs::path> roots;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (const auto &tree : mTrees) {
+            roots.insert(tree.first);
+        }
+    }
+
+    // the file system is only accessed without holding the lock
+    std::vector<Update> updates;
+    std::set<fs::path>  overflowed;
+    for (const auto &event : events) {
+        if (failed(event->type) || roots.count(event->root) == 0) {
+            continue;
+        }
+        if (buffer_overflow(event->type) ||
+            (subtree(event->type) && event->relativePath.empty())) {
+            overflowed.insert(event->root);
+            continue;
+        }
+
+        // the old path of a combined rename is gone, a summarized subtree is
+        // replaced as a whole
+        if (!event->previousPath.empty() || subtree(event->type)) {
+            Update removed;
+            removed.root         = event->root;
+            removed.relativePath = subtree(event->type) ? event->relativePath
+                                                        : event->previousPath;
+            removed.exists       = false;
+            updates.emplace_back(std::move(removed));
+        }
+
+        Update update;
+        update.root         = event->root;
+        update.relativePath = event->relativePath;
+        if (event->status) {
+            update.exists = true;
+            update.status = *event->status;
+        } else {
+            update.exists = FileStatus::read(event->root / event->relativePath,
+                                             update.status);
+        }
+        if (update.exists && update.status.type == FileStatus::DIRECTORY &&
+            (created(event->type) || subtree(event->type) ||
+             !event->previousPath.empty())) {
+            crawl(event->root, event->relativePath, update.subtree);
+        }
+        updates.emplace_back(std::move(update));
+    }
+
+    for (const auto &root : overflowed) {
+        addRoot(root);
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (const auto &update : updates) {
+        auto tree = mTrees.find(update.root);
+        if (tree == mTrees.end() || overflowed.count(update.root) != 0) {
+            continue;
+        }
+
+        if (!update.exists) {
+            erase(tree->second, update.relativePath);
+            continue;
+        }
+        if (update.relativePath.empty()) {
+            continue;
+        }
+
+        insert(tree->second, update.relativePath, update.status);
+        for (const auto &entry : update.subtree) {
+            insert(tree->second, entry.first, entry.second);
+        }
+    }
+}
+
+size_t FileIndex::size()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    size_t result = 0;
+    for (const auto &tree : mTrees) {
+        result += tree.second.entries.size();
+    }
+    return result;
+}
+
+bool FileIndex::find(const fs::path &root,
+                     const fs::path &relativePath,
+                     Entry &         out)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto tree = mTrees.find(root);
+    if (tree == mTrees.end()) {
+        return false;
+    }
+    auto indexed = tree->second.entries.find(relativePath);
+    if (indexed == tree->second.entries.end()) {
+        return false;
+    }
+    out = entry(*indexed);
+    return true;
+}
+
+std::vector<FileIndex::Entry>
+FileIndex::list(const fs::path &root, const fs::path &subtree, bool recursive)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    std::vector<Entry> result;
+    auto               tree = mTrees.find(root);
+    if (tree == mTrees.end()) {
+        return result;
+    }
+
+    // paths compare by component, so a subtree is a contiguous range
+    const auto &entries = tree->second.entries;
+    for (auto it = entries.upper_bound(subtree);
+         it != entries.end() && isBelow(subtree, it->first); ++it) {
+        if (recursive || it->first.parent_path() == subtree) {
+            result.push_back(entry(*it));
+        }
+    }
+    return result;
+}
+
+std::vector<FileIndex::Entry> FileIndex::glob(const fs::path &   root,
+                                              const std::string &pattern)
+{
+    // the directory before the first wildcard limits the candidates
+    const auto wildcard = pattern.find_first_of(WILDCARDS);
+    const auto lastSeparator =
+        pattern.rfind('/', wildcard == std::string::npos ? pattern.size()
+                                                         : wildcard);
+    const fs::path prefix = lastSeparator == std::string::npos
+                                ? fs::path()
+                                : fs::u8path(pattern.substr(0, lastSeparator));
+
+    // a pattern like `**/*.cpp` is served from the extension index
+    const auto nameStart = pattern.rfind('/') + 1;
+    const bool byExtension =
+        pattern.size() > nameStart + 2 && pattern[nameStart] == '*' &&
+        pattern[nameStart + 1] == '.' &&
+        pattern.find_first_of(WILDCARDS, nameStart + 1) == std::string::npos &&
+        pattern.find('.', nameStart + 2) == std::string::npos;
+
+    std::vector<Entry> candidates =
+        byExtension ? withExtension(root, pattern.substr(nameStart + 1))
+                    : list(root, prefix);
+
+    std::vector<Entry> result;
+    for (auto &candidate : candidates) {
+        if (matches(pattern, candidate.relativePath.generic_u8string())) {
+            result.emplace_back(std::move(candidate));
+        }
+    }
+    return result;
+}
+
+std::vector<FileIndex::Entry>
+FileIndex::withExtension(const fs::path &root, const std::string &extension)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    std::vector<Entry> result;
+    auto               tree = mTrees.find(root);
+    if (tree == mTrees.end()) {
+        return result;
+    }
+
+    auto paths = tree->second.byExtension.find(extension);
+    if (paths == tree->second.byExtension.end()) {
+        return result;
+    }
+    for (const auto &path : paths->second) {
+        result.push_back(entry(*tree->second.entries.find(path)));
+    }
+    return result;
+}
+
+bool FileIndex::matches(const std::string &pattern, const std::string &path)
+{
+    return matchFrom(pattern, 0, path, 0);
+}
+
+void FileIndex::crawl(const fs::path &                          root,
+                      const fs::path &                          relativePath,
+                      std::vector<std::pair<fs::path, Status>> &out)
+{
+    std::error_code ec;
+    auto            dirItr = fs::recursive_directory_iterator(
+        root / relativePath, fs::directory_options::skip_permission_denied,
+        ec);
+    for (; !ec && dirItr != fs::recursive_directory_iterator();
+         dirItr.increment(ec)) {
+        Status status;
+        if (!FileStatus::read(dirItr->path(), status)) {
+            continue;
+        }
+
+        auto path = dirItr->path().lexically_relative(root);
+        if (status.type == FileStatus::DIRECTORY && mIsWatched &&
+            !mIsWatched(path)) {
+            dirItr.disable_recursion_pending();
+        }
+        out.emplace_back(std::move(path), status);
+    }
+}
+
+void FileIndex::insert(Tree &          tree,
+                       const fs::path &relativePath,
+                       const Status &  status)
+{
+    auto indexed = tree.entries.find(relativePath);
+    if (indexed != tree.entries.end()) {
+        if (indexed->second.type == status.type) {
+            indexed->second = status;
+            return;
+        }
+        // a directory has been replaced by a file or vice versa
+        erase(tree, relativePath);
+    }
+
+    tree.entries.emplace(relativePath, status);
+
+    if (status.type != FileStatus::DIRECTORY && relativePath.has_extension()) {
+        tree.byExtension[relativePath.extension().u8string()].insert(
+            relativePath);
+    }
+}
+
+void FileIndex::erase(Tree &tree, const fs::path &relativePath)
+{
+    auto begin = tree.entries.lower_bound(relativePath);
+    auto end   = begin;
+    for (; end != tree.entries.end() && isBelow(relativePath, end->first);
+         ++end) {
+        if (end->second.type != FileStatus::DIRECTORY &&
+            end->first.has_extension()) {
+            const auto extension = end->first.extension().u8string();
+            auto       paths     = tree.byExtension.find(extension);
+            paths->second.erase(end->first);
+            if (paths->second.empty()) {
+                tree.byExtension.erase(paths);
+            }
+        }
+    }
+    tree.entries.erase(begin, end);
+}
+
+FileIndex::Entry
+FileIndex::entry(const std::pair<const fs::path, Status> &indexed)
+{
+    return {indexed.first, indexed.second.inode, indexed.second.size,
+            indexed.second.mtime,
+            indexed.second.type == FileStatus::DIRECTORY};
+}
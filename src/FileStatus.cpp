@@ -0,0 +1,129 @@
+#include "pfw/FileStatus.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "pfw/Event.h"
+#include "pfw/internal/definitions.h"
+
+#ifdef PFW_POSIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef PFW_LINUX
+#include <sys/sysmacros.h>
+#endif
+#endif
+
+using namespace pfw;
+
+namespace {
+
+// a thread is only worth starting for this many paths
+const size_t EVENTS_PER_THREAD = 256;
+
+#ifdef PFW_POSIX
+FileStatus::Type typeOf(unsigned mode)
+{
+    if (S_ISREG(mode)) {
+        return FileStatus::REGULAR;
+    }
+    if (S_ISDIR(mode)) {
+        return FileStatus::DIRECTORY;
+    }
+    if (S_ISLNK(mode)) {
+        return FileStatus::SYMLINK;
+    }
+    return FileStatus::OTHER;
+}
+#endif
+
+}  // namespace
+
+bool FileStatus::read(const std::filesystem::path &path, FileStatus &out)
+{
+#if defined(PFW_LINUX) && defined(STATX_BASIC_STATS)
+    // only the requested fields are fetched from the file system
+    struct statx result;
+    if (statx(AT_FDCWD, path.c_str(), AT_SYMLINK_NOFOLLOW,
+              STATX_TYPE | STATX_SIZE | STATX_INO | STATX_MTIME,
+              &result) != 0) {
+        return false;
+    }
+
+    out.type   = typeOf(result.stx_mode);
+    out.size   = result.stx_size;
+    out.inode  = result.stx_ino;
+    out.device = makedev(result.stx_dev_major, result.stx_dev_minor);
+    out.mtime  = result.stx_mtime.tv_sec * 1000000000LL +
+                result.stx_mtime.tv_nsec;
+#elif defined(PFW_POSIX)
+    struct stat result;
+    if (lstat(path.c_str(), &result) != 0) {
+        return false;
+    }
+
+    out.type   = typeOf(result.st_mode);
+    out.size   = result.st_size;
+    out.inode  = result.st_ino;
+    out.device = result.st_dev;
+#ifdef PFW_APPLE
+    out.mtime = result.st_mtimespec.tv_sec * 1000000000LL +
+                result.st_mtimespec.tv_nsec;
+#else
+    out.mtime = result.st_mtim.tv_sec * 1000000000LL + result.st_mtim.tv_nsec;
+#endif
+#else
+    namespace fs = std::filesystem;
+
+    std::error_code ec;
+    auto            status = fs::symlink_status(path, ec);
+    if (ec || !fs::exists(status)) {
+        return false;
+    }
+
+    out.type   = fs::is_regular_file(status)
+                   ? REGULAR
+                   : fs::is_directory(status)
+                         ? DIRECTORY
+                         : fs::is_symlink(status) ? SYMLINK : OTHER;
+    out.size   = out.type == REGULAR ? fs::file_size(path, ec) : 0;
+    out.inode  = 0;
+    out.device = 0;
+    out.mtime  = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    fs::last_write_time(path, ec).time_since_epoch())
+                    .count();
+#endif
+    return true;
+}
+
+void FileStatus::enrich(std::vector<std::unique_ptr<Event>> &events,
+                        size_t                               concurrency)
+{
+    std::atomic<size_t> next(0);
+    auto                work = [&]() {
+        for (size_t i = next++; i < events.size(); i = next++) {
+            Event &event = *events[i];
+            if (failed(event.type) || buffer_overflow(event.type)) {
+                continue;
+            }
+
+            FileStatus status;
+            if (read(event.root / event.relativePath, status)) {
+                event.status = status;
+            }
+        }
+    };
+
+    const size_t threads =
+        std::min(concurrency, events.size() / EVENTS_PER_THREAD);
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
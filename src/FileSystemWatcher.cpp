@@ -1,12 +1,45 @@
 #include "pfw/FileSystemWatcher.h"
 
-using namespace pfw;
+namespace pfw {
+
+template class BasicFileSystemWatcher<>;
 
 FileSystemWatcher::FileSystemWatcher(const fs::path &          path,
                                      std::chrono::milliseconds sleepDuration,
-                                     CallBackSignatur          callback)
-    : NativeInterface(path, sleepDuration, callback)
+                                     CallBackSignatur          callback,
+                                     WatcherOptions            options)
+    : BasicFileSystemWatcher(path,
+                             sleepDuration,
+                             std::move(callback),
+                             std::move(options))
+{
+}
+
+FileSystemWatcher::FileSystemWatcher(const std::vector<fs::path> &paths,
+                                     std::chrono::milliseconds    sleepDuration,
+                                     CallBackSignatur             callback,
+                                     WatcherOptions               options)
+    : BasicFileSystemWatcher(paths,
+                             sleepDuration,
+                             std::move(callback),
+                             std::move(options))
+{
+}
+
+FileSystemWatcher::FileSystemWatcher(const fs::path &          path,
+                                     std::chrono::milliseconds sleepDuration,
+                                     WatcherOptions            options)
+    : BasicFileSystemWatcher(path, sleepDuration, std::move(options))
+{
+}
+
+FileSystemWatcher::FileSystemWatcher(const std::vector<fs::path> &paths,
+                                     std::chrono::milliseconds    sleepDuration,
+                                     WatcherOptions               options)
+    : BasicFileSystemWatcher(paths, sleepDuration, std::move(options))
 {
 }
 
 FileSystemWatcher::~FileSystemWatcher() {}
+
+}  // namespace pfw
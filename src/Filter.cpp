@@ -1,28 +1,574 @@
 #include "pfw/Filter.h"
+#include <algorithm>
 #include <iostream>
+#include <iterator>
+#include <map>
+#include <thread>
+
+#include "pfw/FileStatus.h"
+#include "pfw/StormSummarizer.h"
 
 #pragma unmanaged
 
 using namespace pfw;
 
-Filter::Filter(CallBackSignatur callBack)
+Filter::Filter(CallBackSignatur callBack, FilterOptions options)
+    : mOptions(normalize(std::move(options)))
+    , mStatEvents(false)
+    , mCombineRenames(false)
+    , mCoalesceSaves(false)
+    , mStormThreshold(0)
+    , mMaxBatchSize(0)
+    , mMemoryResource(std::pmr::get_default_resource())
+    , mPool(std::make_shared<std::pmr::synchronized_pool_resource>(
+          mMemoryResource.load()))
+    , mHeld(false)
+    , mSubscriptions(std::make_shared<SubscriptionRouter>())
 {
     mCallbackHandle = registerCallback(callBack);
 }
 
 Filter::~Filter() { deregisterCallback(mCallbackHandle); }
 
-void Filter::sendError(const std::string &errorMsg)
+void Filter::sendError(const std::string &errorMsg, const fs::path &root)
 {
     std::vector<EventPtr> events;
-    events.emplace_back(std::make_unique<Event>(EventType::FAILED, errorMsg));
-    notify(std::move(events));
+    events.emplace_back(
+        std::make_unique<Event>(EventType::FAILED, errorMsg, root));
+    deliver(std::move(events));
 }
 
 void Filter::filterAndNotify(std::vector<EventPtr> &&events)
 {
+    if (mHeld) {
+        std::lock_guard<std::mutex> lock(mHeldMutex);
+        if (mHeld) {
+            mHeldBatches.emplace_back(std::move(events));
+            return;
+        }
+    }
+    prepareAndDeliver(std::move(events));
+}
+
+void Filter::holdBack() { mHeld = true; }
+
+void Filter::release(std::vector<EventPtr> &&events)
+{
+    prepareAndDeliver(std::move(events));
+
+    // the backend keeps holding back its batches until none is left
+    for (;;) {
+        std::vector<std::vector<EventPtr>> held;
+        {
+            std::lock_guard<std::mutex> lock(mHeldMutex);
+            if (mHeldBatches.empty()) {
+                mHeld = false;
+                return;
+            }
+            std::swap(held, mHeldBatches);
+        }
+        for (auto &batch : held) {
+            prepareAndDeliver(std::move(batch));
+        }
+    }
+}
+
+void Filter::prepareAndDeliver(std::vector<EventPtr> &&events)
+{
+    // a rename is paired before its halves are merged with other events
+    if (mCoalesceSaves) {
+        coalesceSaves(events);
+    }
+    if (mCombineRenames) {
+        combineRenames(events);
+    }
+    mergeDuplicates(events);
+    StormSummarizer::summarize(events, mStormThreshold);
+
+    const auto options = currentOptions();
+    if (!options->includePaths.empty() || !options->excludePaths.empty()) {
+        events.erase(std::remove_if(events.begin(), events.end(),
+                                    [&](const EventPtr &event) {
+                                        if (failed(event->type) ||
+                                            buffer_overflow(event->type)) {
+                                            return false;
+                                        }
+                                        if (!event->previousPath.empty()) {
+                                            return !acceptsRename(*options,
+                                                                  *event);
+                                        }
+                                        return !accepts(*options,
+                                                        event->relativePath);
+                                    }),
+                     events.end());
+    }
+
+    // every path is unique by now, so it is stat'ed once per batch
+    if (mStatEvents) {
+        FileStatus::enrich(events, std::thread::hardware_concurrency());
+    }
+    if (auto digestCache = this->digestCache()) {
+        digestCache->apply(events);
+    }
+
     if (events.empty()) {
         return;
     }
-    notify(std::move(events));
+    deliver(std::move(events));
+}
+
+void Filter::subscribe(std::shared_ptr<Subscription> subscription)
+{
+    std::lock_guard<std::mutex> lock(mSubscriptionsMutex);
+    auto router = std::make_shared<SubscriptionRouter>(*mSubscriptions);
+    router->add(std::move(subscription));
+    mSubscriptions = std::move(router);
+}
+
+void Filter::unsubscribe(const std::shared_ptr<Subscription> &subscription)
+{
+    std::lock_guard<std::mutex> lock(mSubscriptionsMutex);
+    auto router = std::make_shared<SubscriptionRouter>(*mSubscriptions);
+    router->remove(subscription);
+    mSubscriptions = std::move(router);
+}
+
+FilterOptions Filter::setOptions(FilterOptions options)
+{
+    auto normalized = normalize(std::move(options));
+
+    std::lock_guard<std::mutex> lock(mOptionsMutex);
+    std::swap(mOptions, normalized);
+    return *normalized;
+}
+
+FilterOptions Filter::options() { return *currentOptions(); }
+
+bool Filter::accepts(const fs::path &relativePath)
+{
+    return accepts(*currentOptions(), relativePath);
+}
+
+bool Filter::isWatched(const fs::path &relativePath)
+{
+    return isWatched(*currentOptions(), relativePath);
+}
+
+bool Filter::isOneFileSystem() { return currentOptions()->oneFileSystem; }
+
+void Filter::setJournal(std::shared_ptr<EventJournal> journal)
+{
+    std::lock_guard<std::mutex> lock(mDeliveryMutex);
+    mJournal = std::move(journal);
+}
+
+void Filter::setChangeIndex(std::shared_ptr<ChangeIndex> changeIndex)
+{
+    std::lock_guard<std::mutex> lock(mDeliveryMutex);
+    mChangeIndex = std::move(changeIndex);
+}
+
+void Filter::setFileIndex(std::shared_ptr<FileIndex> fileIndex)
+{
+    std::lock_guard<std::mutex> lock(mDeliveryMutex);
+    mFileIndex = std::move(fileIndex);
+}
+
+void Filter::setDispatcher(std::shared_ptr<Dispatcher> dispatcher)
+{
+    std::lock_guard<std::mutex> lock(mDeliveryMutex);
+    mDispatcher = std::move(dispatcher);
+}
+
+void Filter::setMaxBatchSize(size_t maxBatchSize)
+{
+    mMaxBatchSize = maxBatchSize;
+}
+
+void Filter::setMemoryResource(std::pmr::memory_resource *resource)
+{
+    if (resource == nullptr) {
+        resource = std::pmr::get_default_resource();
+    }
+    mMemoryResource = resource;
+
+    std::shared_ptr<std::pmr::memory_resource> pool =
+        std::make_shared<std::pmr::synchronized_pool_resource>(resource);
+    std::lock_guard<std::mutex> lock(mOptionsMutex);
+    std::swap(mPool, pool);
+}
+
+std::pmr::memory_resource *Filter::memoryResource() { return mMemoryResource; }
+
+void Filter::setStatEvents(bool statEvents) { mStatEvents = statEvents; }
+
+bool Filter::statEvents() { return mStatEvents; }
+
+void Filter::setCombineRenames(bool combineRenames)
+{
+    mCombineRenames = combineRenames;
+}
+
+bool Filter::combinesRenames() { return mCombineRenames; }
+
+void Filter::setCoalesceSaves(bool coalesceSaves)
+{
+    mCoalesceSaves = coalesceSaves;
+}
+
+bool Filter::coalescesSaves() { return mCoalesceSaves; }
+
+void Filter::setStormThreshold(size_t threshold)
+{
+    mStormThreshold = threshold;
+}
+
+size_t Filter::stormThreshold() { return mStormThreshold; }
+
+void Filter::setDigestCache(std::shared_ptr<DigestCache> digestCache)
+{
+    std::lock_guard<std::mutex> lock(mOptionsMutex);
+    mDigestCache = std::move(digestCache);
+}
+
+std::shared_ptr<DigestCache> Filter::digestCache()
+{
+    std::lock_guard<std::mutex> lock(mOptionsMutex);
+    return mDigestCache;
+}
+
+std::vector<fs::path> Filter::newlyIncluded(const FilterOptions &before,
+                                            const FilterOptions &after)
+{
+    std::vector<fs::path> result;
+
+    // the whole tree is selected again, every partially crawled directory
+    // needs to be completed
+    if (!before.includePaths.empty() && after.includePaths.empty()) {
+        result.emplace_back();
+        return result;
+    }
+
+    for (const auto &include : after.includePaths) {
+        if (!accepts(before, include)) {
+            result.push_back(include);
+        }
+    }
+
+    for (const auto &exclude : before.excludePaths) {
+        if (isWatched(after, exclude)) {
+            result.push_back(exclude);
+        }
+    }
+
+    return result;
+}
+
+bool Filter::isSubPath(const fs::path &parent, const fs::path &child)
+{
+    auto parentItr = parent.begin();
+    auto childItr  = child.begin();
+    for (; parentItr != parent.end(); ++parentItr, ++childItr) {
+        if (childItr == child.end() || *parentItr != *childItr) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Filter::combineRenames(std::vector<EventPtr> &events)
+{
+    // only adjacent halves belong to the same rename, the backends insert
+    // them next to each other
+    for (size_t i = 0; i + 1 < events.size(); ++i) {
+        auto &source      = events[i];
+        auto &destination = events[i + 1];
+        if (!source || source->type != (DELETED | RENAMED) ||
+            destination->type != (CREATED | RENAMED) ||
+            destination->root != source->root) {
+            continue;
+        }
+
+        destination->type         = RENAMED;
+        destination->previousPath = std::move(source->relativePath);
+        source.reset();
+        ++i;
+    }
+
+    events.erase(std::remove_if(events.begin(), events.end(),
+                                [](const EventPtr &event) { return !event; }),
+                 events.end());
+}
+
+void Filter::coalesceSaves(std::vector<EventPtr> &events)
+{
+    // the events of the temporary files since their last save, by root and
+    // relative path
+    std::map<std::pair<fs::path, fs::path>, std::vector<size_t>> writes;
+    for (size_t i = 0; i < events.size(); ++i) {
+        auto &source = events[i];
+        if (failed(source->type) || !isTemporary(source->relativePath)) {
+            continue;
+        }
+
+        auto &written = writes[{source->root, source->relativePath}];
+
+        // a save is a rename of a temporary file over its target, whose
+        // halves are adjacent
+        if (source->type != (DELETED | RENAMED) || i + 1 == events.size() ||
+            events[i + 1]->type != (CREATED | RENAMED) ||
+            events[i + 1]->root != source->root ||
+            isTemporary(events[i + 1]->relativePath)) {
+            written.push_back(i);
+            continue;
+        }
+
+        // only the writes before the save belong to it, a temporary file
+        // created afterwards is left on disk
+        for (const auto j : written) {
+            events[j].reset();
+        }
+        written.clear();
+        source.reset();
+        events[i + 1]->type = MODIFIED;
+        ++i;
+    }
+
+    events.erase(std::remove_if(events.begin(), events.end(),
+                                [](const EventPtr &event) { return !event; }),
+                 events.end());
+}
+
+bool Filter::isTemporary(const fs::path &relativePath)
+{
+    static const char *PATTERNS[] = {
+        "*~",     "*.tmp",         "*.tmp.*",      ".*.sw?",
+        "*.temp", "*___jb_tmp___", "*.crdownload", ".goutputstream-*"};
+
+    const auto name = relativePath.filename().u8string();
+    for (const auto *pattern : PATTERNS) {
+        if (FileIndex::matches(pattern, name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Filter::acceptsRename(const FilterOptions &options, Event &event)
+{
+    const bool acceptsSource      = accepts(options, event.previousPath);
+    const bool acceptsDestination = accepts(options, event.relativePath);
+
+    // a rename across the boundary of the filter is a deletion or creation
+    if (acceptsSource && !acceptsDestination) {
+        event.type         = DELETED | RENAMED;
+        event.relativePath = std::move(event.previousPath);
+        event.previousPath.clear();
+    } else if (!acceptsSource && acceptsDestination) {
+        event.type = CREATED | RENAMED;
+        event.previousPath.clear();
+    }
+    return acceptsSource || acceptsDestination;
+}
+
+bool Filter::accepts(const FilterOptions &options, const fs::path &relativePath)
+{
+    for (const auto &exclude : options.excludePaths) {
+        if (isSubPath(exclude, relativePath)) {
+            return false;
+        }
+    }
+
+    if (options.includePaths.empty()) {
+        return true;
+    }
+
+    for (const auto &include : options.includePaths) {
+        if (isSubPath(include, relativePath)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Filter::isWatched(const FilterOptions &options,
+                       const fs::path &     relativePath)
+{
+    if (accepts(options, relativePath)) {
+        return true;
+    }
+
+    for (const auto &exclude : options.excludePaths) {
+        if (isSubPath(exclude, relativePath)) {
+            return false;
+        }
+    }
+
+    // parents of an included subtree have to be observed as well, otherwise
+    // the included subtree would not be reachable
+    for (const auto &include : options.includePaths) {
+        if (isSubPath(relativePath, include)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Filter::OptionsPtr Filter::normalize(FilterOptions options)
+{
+    auto normalizePaths = [](std::vector<fs::path> &paths) {
+        for (auto &path : paths) {
+            path = path.lexically_normal();
+            if (!path.empty() && !path.has_filename()) {
+                path = path.parent_path();
+            }
+            if (path == ".") {
+                path.clear();
+            }
+        }
+    };
+    normalizePaths(options.includePaths);
+    normalizePaths(options.excludePaths);
+
+    return std::make_shared<const FilterOptions>(std::move(options));
+}
+
+void Filter::mergeDuplicates(std::vector<EventPtr> &events)
+{
+    std::shared_ptr<std::pmr::memory_resource> pool;
+    {
+        std::lock_guard<std::mutex> lock(mOptionsMutex);
+        pool = mPool;
+    }
+
+    // the keys point into the kept events, so no path is copied, and the
+    // nodes are recycled by the pool
+    using Key = std::pair<const fs::path *, const fs::path *>;
+    auto less = [](const Key &lhs, const Key &rhs) {
+        return *lhs.first != *rhs.first ? *lhs.first < *rhs.first
+                                        : *lhs.second < *rhs.second;
+    };
+    std::pmr::map<Key, std::vector<EventPtr>::reverse_iterator,
+                  decltype(less)>
+        values(less, pool.get());
+
+    // the merged event usually takes the place of the last occurrence, but
+    // one of the halves of a rename keeps its place next to the other
+    auto isHalf = [&events](size_t i) {
+        return (i > 0 && events[i - 1] &&
+                isRenamePair(*events[i - 1], *events[i])) ||
+               (i + 1 < events.size() && events[i + 1] &&
+                isRenamePair(*events[i], *events[i + 1]));
+    };
+    for (auto itr = events.rbegin(); itr != events.rend(); ++itr) {
+        auto result =
+            values.emplace(Key(&(*itr)->root, &(*itr)->relativePath), itr);
+
+        if (result.second) {
+            continue;
+        }
+
+        EventPtr &event           = *itr;
+        EventPtr &conflictedEvent = *result.first->second;
+        if (isHalf(events.rend() - itr - 1) &&
+            !isHalf(events.rend() - result.first->second - 1)) {
+            event->type = event->type | conflictedEvent->type;
+            if (!conflictedEvent->previousPath.empty()) {
+                event->previousPath = std::move(conflictedEvent->previousPath);
+            }
+
+            // the key points into the dropped event
+            values.erase(result.first);
+            conflictedEvent.reset(nullptr);
+            values.emplace(Key(&event->root, &event->relativePath), itr);
+            continue;
+        }
+
+        conflictedEvent->type = conflictedEvent->type | event->type;
+        if (conflictedEvent->previousPath.empty()) {
+            conflictedEvent->previousPath = std::move(event->previousPath);
+        }
+
+        event.reset(nullptr);
+    }
+
+    events.erase(std::remove_if(events.begin(), events.end(),
+                                [](const EventPtr &event) { return !event; }),
+                 events.end());
+}
+
+bool Filter::isRenamePair(const Event &source, const Event &destination)
+{
+    // other changes of the paths may have been merged into the halves
+    return renamed(source.type) && deleted(source.type) &&
+           renamed(destination.type) && created(destination.type) &&
+           source.root == destination.root;
+}
+
+Filter::OptionsPtr Filter::currentOptions()
+{
+    std::lock_guard<std::mutex> lock(mOptionsMutex);
+    return mOptions;
+}
+
+void Filter::deliver(std::vector<EventPtr> &&events)
+{
+    // held across the callback, otherwise a concurrent batch could be
+    // delivered ahead of smaller sequence numbers
+    std::lock_guard<std::mutex> lock(mDeliveryMutex);
+    if (mJournal) {
+        mJournal->append(events);
+    }
+    if (mChangeIndex) {
+        mChangeIndex->add(events);
+    }
+    if (mFileIndex) {
+        mFileIndex->update(events);
+    }
+
+    const size_t maxBatchSize = mMaxBatchSize;
+    if (maxBatchSize == 0 || events.size() <= maxBatchSize) {
+        handOver(std::move(events));
+        return;
+    }
+
+    // the chunks reuse a single buffer, unless the callback keeps it
+    std::vector<EventPtr> chunk;
+    for (auto begin = events.begin(); begin != events.end();) {
+        auto end = begin + std::min<size_t>(maxBatchSize, events.end() - begin);
+        // the halves of a rename stay together, in the next chunk unless
+        // the pair would not fit into any
+        if (end != events.end() && isRenamePair(**(end - 1), **end)) {
+            end += end - 1 == begin ? 1 : -1;
+        }
+        chunk.reserve(maxBatchSize + 1);
+        chunk.insert(chunk.end(), std::make_move_iterator(begin),
+                     std::make_move_iterator(end));
+        handOver(std::move(chunk));
+        chunk.clear();
+        begin = end;
+    }
+}
+
+void Filter::handOver(std::vector<EventPtr> &&events)
+{
+    publish(events);
+    if (!mDispatcher) {
+        notify(std::move(events));
+        return;
+    }
+    mDispatcher->dispatch(std::move(events),
+                          [this](std::vector<EventPtr> &&shard) {
+                              notify(std::move(shard));
+                          });
+}
+
+void Filter::publish(const std::vector<EventPtr> &events)
+{
+    RouterPtr router;
+    {
+        std::lock_guard<std::mutex> lock(mSubscriptionsMutex);
+        router = mSubscriptions;
+    }
+    router->publish(events);
 }
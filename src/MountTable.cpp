@@ -0,0 +1,197 @@
+#include "pfw/MountTable.h"
+
+#include <cstdint>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <vector>
+
+#include "pfw/Filter.h"
+#include "pfw/internal/definitions.h"
+
+#ifdef PFW_LINUX
+#include <sys/vfs.h>
+#endif
+
+using namespace pfw;
+
+namespace {
+
+bool isOctal(char c) { return c >= '0' && c <= '7'; }
+
+// decodes the octal escapes of blanks and backslashes in the mount table
+std::string unescape(const std::string &field)
+{
+    std::string result;
+    for (size_t i = 0; i < field.size(); ++i) {
+        if (field[i] == '\\' && i + 3 < field.size() && isOctal(field[i + 1]) &&
+            isOctal(field[i + 2]) && isOctal(field[i + 3])) {
+            result += static_cast<char>(std::stoi(field.substr(i + 1, 3),
+                                                  nullptr, 8));
+            i += 3;
+        } else {
+            result += field[i];
+        }
+    }
+    return result;
+}
+
+}  // namespace
+
+MountTable MountTable::current()
+{
+    std::ifstream mountInfo("/proc/self/mountinfo");
+    if (!mountInfo) {
+        return MountTable();
+    }
+    return parse(mountInfo);
+}
+
+MountTable MountTable::parse(std::istream &mountInfo)
+{
+    MountTable result;
+
+    std::string line;
+    while (std::getline(mountInfo, line)) {
+        // mount ID, parent ID, major:minor, root, mount point, options,
+        // optional fields terminated by "-", type, source, super options
+        std::istringstream       fields(line);
+        std::vector<std::string> values;
+        for (std::string value; fields >> value;) {
+            values.push_back(value);
+        }
+
+        size_t separator = 6;
+        while (separator < values.size() && values[separator] != "-") {
+            ++separator;
+        }
+        if (separator + 1 >= values.size()) {
+            continue;
+        }
+
+        result.add(unescape(values[4]), values[separator + 1]);
+    }
+    return result;
+}
+
+void MountTable::add(const std::filesystem::path &mountPoint,
+                     const std::string &          type)
+{
+    mMounts[mountPoint.lexically_normal()] = {type, kindOfType(type)};
+}
+
+bool MountTable::isMountPoint(const std::filesystem::path &path) const
+{
+    return mMounts.find(path) != mMounts.end();
+}
+
+std::vector<std::filesystem::path>
+MountTable::mountPointsBelow(const std::filesystem::path &path) const
+{
+    std::vector<std::filesystem::path> result;
+    for (auto mount = mMounts.upper_bound(path); mount != mMounts.end();
+         ++mount) {
+        if (!Filter::isSubPath(path, mount->first)) {
+            break;
+        }
+        result.push_back(mount->first);
+    }
+    return result;
+}
+
+MountTable::Kind MountTable::kindAt(const std::filesystem::path &path) const
+{
+    auto mount = mMounts.find(path);
+    return mount != mMounts.end() ? mount->second.kind : LOCAL;
+}
+
+bool MountTable::isSkipped(const std::filesystem::path &root,
+                           const std::filesystem::path &path,
+                           bool                         oneFileSystem) const
+{
+    if (mMounts.empty()) {
+        return false;
+    }
+
+    for (auto current = path; current != root && current.has_relative_path();
+         current = current.parent_path()) {
+        auto mount = mMounts.find(current);
+        if (mount == mMounts.end()) {
+            continue;
+        }
+        if (oneFileSystem) {
+            return true;
+        }
+        // an automount point is a pseudo file system of its own, but the
+        // file systems mounted below it by an indirect map are not
+        if (mount->second.kind == PSEUDO &&
+            (mount->second.type != "autofs" || current == path)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+MountTable::Kind MountTable::kindOfType(const std::string &type)
+{
+    static const std::set<std::string> remote = {
+        "9p",    "afs",      "ceph",      "cifs",   "coda",
+        "fuse",  "gfs2",     "glusterfs", "lustre", "ncpfs",
+        "nfs",   "nfs4",     "ocfs2",     "smb3",   "smbfs",
+        "sshfs", "virtiofs"};
+    static const std::set<std::string> pseudo = {
+        "autofs",     "binfmt_misc", "bpf",        "cgroup",    "cgroup2",
+        "configfs",   "debugfs",     "devpts",     "efivarfs",  "fusectl",
+        "fuse.lxcfs", "hugetlbfs",   "mqueue",     "nsfs",      "proc",
+        "pstore",     "rpc_pipefs",  "securityfs", "selinuxfs", "sysfs",
+        "tracefs"};
+
+    if (pseudo.find(type) != pseudo.end()) {
+        return PSEUDO;
+    }
+    // FUSE file systems are usually backed by a remote service; `fuseblk`
+    // is backed by a local block device
+    if (remote.find(type) != remote.end() || type.compare(0, 5, "fuse.") == 0) {
+        return REMOTE;
+    }
+    return LOCAL;
+}
+
+MountTable::Kind MountTable::kindOfPath(const std::filesystem::path &path)
+{
+#ifdef PFW_LINUX
+    struct statfs result;
+    if (path.empty() || statfs(path.c_str(), &result) != 0) {
+        return LOCAL;
+    }
+
+    switch (static_cast<uint32_t>(result.f_type)) {
+        case 0x6969:     // NFS
+        case 0x517B:     // SMB
+        case 0xFF534D42: // CIFS
+        case 0xFE534D42: // SMB2
+        case 0x65735546: // FUSE
+        case 0x01021997: // 9P
+        case 0x00C36400: // Ceph
+        case 0x5346414F: // AFS
+        case 0x73757245: // Coda
+            return REMOTE;
+        case 0x9FA0:     // proc
+        case 0x62656572: // sysfs
+        case 0x1CD1:     // devpts
+        case 0x0027E0EB: // cgroup
+        case 0x63677270: // cgroup2
+        case 0x64626720: // debugfs
+        case 0x74726163: // tracefs
+        case 0x73636673: // securityfs
+        case 0x6165676C: // pstore
+        case 0xCAFE4A11: // bpf
+            return PSEUDO;
+        default:
+            return LOCAL;
+    }
+#else
+    (void)path;
+    return LOCAL;
+#endif
+}
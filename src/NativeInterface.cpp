@@ -1,15 +1,291 @@
 #include "pfw/NativeInterface.h"
 
+#include <algorithm>
+
 using namespace pfw;
 
 NativeInterface::NativeInterface(const fs::path &   path,
                                  const std::chrono::milliseconds latency,
-                                 CallBackSignatur                callback)
-    : _filter(std::make_shared<Filter>(callback))
+                                 CallBackSignatur                callback,
+                                 WatcherOptions                  options)
+    : _filter(std::make_shared<Filter>(callback, std::move(options.filter)))
+{
+    configureDelivery(options);
+    createBackend(options.backend, path, latency);
+    restoreSnapshot(options.snapshotPath);
+    openFileIndex(options);
+}
+
+NativeInterface::NativeInterface(const std::vector<fs::path> &   paths,
+                                 const std::chrono::milliseconds latency,
+                                 CallBackSignatur                callback,
+                                 WatcherOptions                  options)
+    : _filter(std::make_shared<Filter>(callback, std::move(options.filter)))
+{
+    configureDelivery(options);
+    createBackend(options.backend, paths.empty() ? fs::path() : paths.front(),
+                  latency);
+
+    for (size_t i = 1; i < paths.size(); ++i) {
+        _nativeInterface->addRoot(paths[i]);
+    }
+    restoreSnapshot(options.snapshotPath);
+    openFileIndex(options);
+}
+
+NativeInterface::NativeInterface(const fs::path &   path,
+                                 const std::chrono::milliseconds latency,
+                                 WatcherOptions                  options)
+    : NativeInterface(std::vector<fs::path>{path}, latency,
+                      std::make_shared<EventQueue>(options.queueCapacity),
+                      std::move(options))
 {
-    _nativeInterface.reset(new NativeImplementation(_filter, path, latency));
 }
 
-NativeInterface::~NativeInterface() { _nativeInterface.reset(); }
+NativeInterface::NativeInterface(const std::vector<fs::path> &   paths,
+                                 const std::chrono::milliseconds latency,
+                                 WatcherOptions                  options)
+    : NativeInterface(paths, latency,
+                      std::make_shared<EventQueue>(options.queueCapacity),
+                      std::move(options))
+{
+}
+
+NativeInterface::NativeInterface(const std::vector<fs::path> &   paths,
+                                 const std::chrono::milliseconds latency,
+                                 std::shared_ptr<EventQueue>     queue,
+                                 WatcherOptions                  options)
+    : NativeInterface(paths, latency,
+                      [queue](std::vector<EventPtr> &&events) {
+                          queue->push(std::move(events));
+                      },
+                      std::move(options))
+{
+    _queue = std::move(queue);
+}
+
+NativeInterface::~NativeInterface()
+{
+    if (_restorer.joinable()) {
+        _restorer.join();
+    }
+
+    // changes after the backend stopped are part of the next restore
+    _nativeInterface.reset();
+    saveSnapshot();
+}
+
+void NativeInterface::createBackend(const std::string &             name,
+                                    const fs::path &                path,
+                                    const std::chrono::milliseconds latency)
+{
+    auto &registry   = BackendRegistry::instance();
+    _nativeInterface = registry.create(name, _filter, path, latency);
+    if (!_nativeInterface) {
+        _filter->sendError("Unknown backend: " + name, path);
+        _nativeInterface =
+            registry.create(BackendRegistry::NATIVE, _filter, path, latency);
+    }
+}
+
+void NativeInterface::configureDelivery(const WatcherOptions &options)
+{
+    // the backend starts before the snapshot is restored, its batches wait
+    // for the changes made while no watcher was running
+    if (!options.snapshotPath.empty()) {
+        _filter->holdBack();
+    }
+    _filter->setStatEvents(options.statEvents);
+    _filter->setCombineRenames(options.combineRenames);
+    _filter->setCoalesceSaves(options.coalesceSaves);
+    _filter->setMaxBatchSize(options.maxBatchSize);
+    _filter->setMemoryResource(options.memoryResource);
+    if (options.dispatchConcurrency > 1) {
+        _filter->setDispatcher(std::make_shared<Dispatcher>(
+            options.dispatchConcurrency, options.dispatchPartition));
+    }
+    _filter->setStormThreshold(options.stormThreshold);
+    if (options.digestContents) {
+        _filter->setDigestCache(std::make_shared<DigestCache>(
+            std::thread::hardware_concurrency()));
+    }
+    openJournal(options);
+    openChangeIndex(options);
+}
+
+void NativeInterface::openJournal(const WatcherOptions &options)
+{
+    if (options.journalPath.empty()) {
+        return;
+    }
+
+    _journal = std::make_shared<EventJournal>(options.journalPath,
+                                              options.journal);
+    if (!_journal->isValid()) {
+        _filter->sendError("Failed to open the journal.");
+    }
+    // the sequence numbers are assigned even if nothing can be persisted
+    _filter->setJournal(_journal);
+}
+
+void NativeInterface::openChangeIndex(const WatcherOptions &options)
+{
+    if (options.changeIndexSize == 0) {
+        return;
+    }
+
+    _changeIndex = std::make_shared<ChangeIndex>(options.changeIndexSize);
+    _filter->setChangeIndex(_changeIndex);
+}
+
+void NativeInterface::openFileIndex(const WatcherOptions &options)
+{
+    if (!options.fileIndex) {
+        return;
+    }
+
+    auto filter = _filter;
+    _fileIndex  = std::make_shared<FileIndex>(
+        [filter](const fs::path &relativePath) {
+            return filter->isWatched(relativePath);
+        });
+
+    // the events of a root are only applied once it has been crawled
+    _filter->setFileIndex(_fileIndex);
+    for (const auto &root : roots()) {
+        _fileIndex->addRoot(root);
+    }
+}
+
+void NativeInterface::restoreSnapshot(const fs::path &file)
+{
+    if (file.empty()) {
+        return;
+    }
+
+    // the backend is running already, so no change falls in between
+    auto filter = _filter;
+    _snapshot   = std::make_unique<TreeSnapshot>(
+        file, [filter](const fs::path &relativePath) {
+            return filter->isWatched(relativePath);
+        });
+
+    // delivered ahead of the batches the backend reported meanwhile, but not
+    // before the constructor has returned
+    auto events = _snapshot->restore(roots());
+    _restorer   = std::thread(
+        [filter, events = std::move(events)]() mutable {
+            filter->release(std::move(events));
+        });
+}
+
+Backend *NativeInterface::backend() { return _nativeInterface.get(); }
+
+EventJournal *NativeInterface::journal() { return _journal.get(); }
+
+FileIndex *NativeInterface::fileIndex() { return _fileIndex.get(); }
+
+ChangeToken NativeInterface::changeToken()
+{
+    return _changeIndex ? _changeIndex->token() : ChangeToken();
+}
+
+Changes NativeInterface::changesSince(const ChangeToken &token)
+{
+    if (!_changeIndex) {
+        Changes changes;
+        changes.isFreshInstance = true;
+        return changes;
+    }
+    return _changeIndex->changesSince(token);
+}
+
+EventQueue *NativeInterface::eventQueue() { return _queue.get(); }
+
+std::shared_ptr<Subscription>
+NativeInterface::subscribe(BatchCallback callback, SubscriptionOptions options)
+{
+    auto subscription =
+        std::make_shared<Subscription>(std::move(callback), std::move(options));
+    _filter->subscribe(subscription);
+    return subscription;
+}
+
+void NativeInterface::unsubscribe(
+    const std::shared_ptr<Subscription> &subscription)
+{
+    _filter->unsubscribe(subscription);
+    subscription->close();
+}
+
+bool NativeInterface::saveSnapshot()
+{
+    if (!_snapshot) {
+        return false;
+    }
+
+    if (!_snapshot->save()) {
+        _filter->sendError("Failed to save the snapshot.");
+        return false;
+    }
+    return true;
+}
 
 bool NativeInterface::isWatching() { return _nativeInterface->isWatching(); }
+
+void NativeInterface::setFilterOptions(const FilterOptions &filterOptions)
+{
+    const auto previous = _filter->setOptions(filterOptions);
+    _nativeInterface->applyFilterOptions(previous);
+}
+
+FilterOptions NativeInterface::filterOptions() { return _filter->options(); }
+
+bool NativeInterface::addRoot(const fs::path &path)
+{
+    const auto known = roots();
+    if (!_nativeInterface->addRoot(path)) {
+        return false;
+    }
+
+    for (const auto &root : roots()) {
+        if (std::find(known.begin(), known.end(), root) != known.end()) {
+            continue;
+        }
+        if (_snapshot) {
+            _snapshot->addRoot(root);
+        }
+        if (_fileIndex) {
+            _fileIndex->addRoot(root);
+        }
+    }
+    return true;
+}
+
+bool NativeInterface::removeRoot(const fs::path &path)
+{
+    const auto known = roots();
+    if (!_nativeInterface->removeRoot(path)) {
+        return false;
+    }
+
+    const auto remaining = roots();
+    for (const auto &root : known) {
+        if (std::find(remaining.begin(), remaining.end(), root) !=
+            remaining.end()) {
+            continue;
+        }
+        if (_snapshot) {
+            _snapshot->removeRoot(root);
+        }
+        if (_fileIndex) {
+            _fileIndex->removeRoot(root);
+        }
+    }
+    return true;
+}
+
+std::vector<fs::path> NativeInterface::roots()
+{
+    return _nativeInterface->roots();
+}
@@ -0,0 +1,722 @@
+#include "pfw/PollingScanner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <set>
+#include <thread>
+
+#include "pfw/internal/definitions.h"
+
+#ifdef PFW_POSIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef PFW_LINUX
+#include <sys/sysmacros.h>
+#endif
+#endif
+
+using namespace pfw;
+
+namespace {
+
+// an mtime within this window of a scan is not trusted
+constexpr int64_t RACY_WINDOW_NS = 2000000000LL;
+
+// flags of a serialized entry
+constexpr uint32_t RECORD_DIRECTORY = 1;
+constexpr uint32_t RECORD_RACY      = 2;
+
+int64_t currentTime()
+{
+#ifdef PFW_POSIX
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               fs::file_time_type::clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+template <typename T>
+typename std::vector<std::pair<fs::path::string_type, T>>::iterator
+findEntry(std::vector<std::pair<fs::path::string_type, T>> &entries,
+          const fs::path::string_type &                     name)
+{
+    auto entry = std::lower_bound(
+        entries.begin(), entries.end(), name,
+        [](const std::pair<fs::path::string_type, T> &lhs,
+           const fs::path::string_type &              rhs) {
+            return lhs.first < rhs;
+        });
+    return entry != entries.end() && entry->first == name ? entry
+                                                          : entries.end();
+}
+
+}  // namespace
+
+PollingScanner::PollingScanner(const fs::path & root,
+                               size_t           concurrency,
+                               WatchedPredicate isWatched)
+    : mRoot(root)
+    , mConcurrency(std::max<size_t>(concurrency, 1))
+    , mIsWatched(std::move(isWatched))
+    , mDirectoryCount(0)
+{
+}
+
+PollingScanner::~PollingScanner() {}
+
+const fs::path &PollingScanner::root() const { return mRoot; }
+
+size_t PollingScanner::directoryCount() const { return mDirectoryCount; }
+
+void PollingScanner::reset()
+{
+    std::vector<Change> changes;
+    mRootDirectory.reset();
+    scanRoot(false, changes);
+}
+
+std::vector<PollingScanner::Change> PollingScanner::scan()
+{
+    std::vector<Change> changes;
+    scanRoot(true, changes);
+    return changes;
+}
+
+// the serialized form of an entry; a directory record is followed by the
+// records of its files and then by its subdirectories
+struct PollingScanner::Record {
+    uint64_t inode;
+    uint64_t device;
+    uint64_t size;
+    int64_t  mtime;
+    int64_t  birth;
+    uint32_t nameOffset;
+    uint32_t nameSize;
+    uint32_t fileCount;
+    uint32_t directoryCount;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+struct PollingScanner::Reader {
+    const char *records;
+    size_t      recordCount;
+    const char *names;
+    size_t      namesSize;
+    size_t      next;
+    size_t      directoryCount;
+
+    bool read(Record &record, fs::path::string_type &name)
+    {
+        if (next >= recordCount) {
+            return false;
+        }
+        // the records are copied, the mapping does not guarantee alignment
+        std::memcpy(&record, records + next++ * sizeof(Record), sizeof(Record));
+        if (static_cast<size_t>(record.nameOffset) + record.nameSize >
+                namesSize ||
+            record.nameSize % sizeof(fs::path::value_type) != 0) {
+            return false;
+        }
+
+        name.resize(record.nameSize / sizeof(fs::path::value_type));
+        std::memcpy(&name[0], names + record.nameOffset, record.nameSize);
+        return true;
+    }
+};
+
+void PollingScanner::serialize(std::string &out) const
+{
+    static_assert(sizeof(Record) == 64, "the record layout is the format");
+
+    std::string records;
+    std::string names;
+    if (mRootDirectory) {
+        serializeEntry(fs::path::string_type(), mRootDirectory->self,
+                       mRootDirectory.get(), records, names);
+        serializeEntries(*mRootDirectory, records, names);
+    }
+
+    const uint64_t header[2] = {records.size() / sizeof(Record), names.size()};
+    out.append(reinterpret_cast<const char *>(header), sizeof(header));
+    out += records;
+    out += names;
+}
+
+bool PollingScanner::deserialize(const char *data, size_t size)
+{
+    mRootDirectory.reset();
+    mDirectoryCount = 0;
+
+    uint64_t header[2];
+    if (size < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(header, data, sizeof(header));
+
+    const uint64_t recordCount = header[0];
+    const uint64_t namesSize   = header[1];
+    if (recordCount > (size - sizeof(header)) / sizeof(Record) ||
+        namesSize != size - sizeof(header) - recordCount * sizeof(Record)) {
+        return false;
+    }
+
+    Reader reader = {data + sizeof(header),
+                     recordCount,
+                     data + sizeof(header) + recordCount * sizeof(Record),
+                     namesSize,
+                     0,
+                     0};
+
+    Record                self;
+    fs::path::string_type name;
+    if (!reader.read(self, name) || !(self.flags & RECORD_DIRECTORY)) {
+        return false;
+    }
+
+    auto root = deserializeDirectory(self, reader);
+    if (!root || reader.next != recordCount) {
+        return false;
+    }
+
+    mRootDirectory  = std::move(root);
+    mDirectoryCount = reader.directoryCount;
+    return true;
+}
+
+void PollingScanner::serializeEntry(const fs::path::string_type &name,
+                                    const Entry &                entry,
+                                    const Directory *            directory,
+                                    std::string &                records,
+                                    std::string &                names)
+{
+    const size_t nameSize = name.size() * sizeof(fs::path::value_type);
+
+    Record record;
+    record.inode          = entry.inode;
+    record.device         = entry.device;
+    record.size           = entry.size;
+    record.mtime          = entry.mtime;
+    record.birth          = entry.birth;
+    record.nameOffset     = static_cast<uint32_t>(names.size());
+    record.nameSize       = static_cast<uint32_t>(nameSize);
+    record.fileCount      = 0;
+    record.directoryCount = 0;
+    record.flags          = 0;
+    record.reserved       = 0;
+    if (directory != nullptr) {
+        record.fileCount = static_cast<uint32_t>(directory->files.size());
+        record.directoryCount =
+            static_cast<uint32_t>(directory->directories.size());
+        record.flags = RECORD_DIRECTORY | (directory->racy ? RECORD_RACY : 0);
+    }
+
+    records.append(reinterpret_cast<const char *>(&record), sizeof(record));
+    names.append(reinterpret_cast<const char *>(name.data()), nameSize);
+}
+
+void PollingScanner::serializeEntries(const Directory &directory,
+                                      std::string &    records,
+                                      std::string &    names)
+{
+    for (const auto &file : directory.files) {
+        serializeEntry(file.first, file.second, nullptr, records, names);
+    }
+    for (const auto &subdirectory : directory.directories) {
+        serializeEntry(subdirectory.first, subdirectory.second->self,
+                       subdirectory.second.get(), records, names);
+        serializeEntries(*subdirectory.second, records, names);
+    }
+}
+
+PollingScanner::DirectoryPtr
+PollingScanner::deserializeDirectory(const Record &self, Reader &reader)
+{
+    auto entryOf = [](const Record &record) {
+        return Entry{record.inode,
+                     record.device,
+                     record.size,
+                     record.mtime,
+                     record.birth,
+                     (record.flags & RECORD_DIRECTORY) != 0};
+    };
+
+    auto directory  = std::make_unique<Directory>();
+    directory->self = entryOf(self);
+    directory->racy = (self.flags & RECORD_RACY) != 0;
+    ++reader.directoryCount;
+
+    Record                record;
+    fs::path::string_type name;
+
+    directory->files.reserve(self.fileCount);
+    for (uint32_t i = 0; i < self.fileCount; ++i) {
+        if (!reader.read(record, name) || (record.flags & RECORD_DIRECTORY)) {
+            return nullptr;
+        }
+        directory->files.emplace_back(name, entryOf(record));
+    }
+
+    directory->directories.reserve(self.directoryCount);
+    for (uint32_t i = 0; i < self.directoryCount; ++i) {
+        if (!reader.read(record, name) || !(record.flags & RECORD_DIRECTORY)) {
+            return nullptr;
+        }
+        auto child = deserializeDirectory(record, reader);
+        if (!child) {
+            return nullptr;
+        }
+        directory->directories.emplace_back(name, std::move(child));
+    }
+    return directory;
+}
+
+void PollingScanner::scanRoot(bool report, std::vector<Change> &changes)
+{
+    std::atomic<size_t> directoryCount(0);
+    const Context       context = {report, currentTime(), &directoryCount};
+
+    Entry self;
+    if (!statEntry(mRoot, self) || !self.isDirectory) {
+        if (mRootDirectory) {
+            reportDeleted(*mRootDirectory, fs::path(), changes);
+            mRootDirectory.reset();
+        }
+        mDirectoryCount = 0;
+        return;
+    }
+
+    const bool list = !mRootDirectory;
+    if (list) {
+        mRootDirectory = std::make_unique<Directory>();
+    }
+
+    std::vector<Task> tasks;
+    update(*mRootDirectory, mRoot, fs::path(), self, list, context, changes,
+           mConcurrency > 1 ? &tasks : nullptr);
+
+    // the subdirectories of the root are updated in parallel, every task
+    // collects its changes separately to keep them in order
+    std::vector<std::vector<Change>> results(tasks.size());
+    std::atomic<size_t>              next(0);
+    auto                             work = [&]() {
+        for (size_t i = next++; i < tasks.size(); i = next++) {
+            const Task &task = tasks[i];
+            update(*task.directory, task.path, task.relativePath, task.self,
+                   task.list, context, results[i], nullptr);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < std::min(mConcurrency, tasks.size()); ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    for (auto &result : results) {
+        changes.insert(changes.end(), std::make_move_iterator(result.begin()),
+                       std::make_move_iterator(result.end()));
+    }
+    mDirectoryCount = directoryCount;
+
+    if (report) {
+        pairRenames(changes);
+    }
+}
+
+void PollingScanner::pairRenames(std::vector<Change> &changes)
+{
+    // an entry which disappeared and showed up with the same inode somewhere
+    // else has been renamed; as a freed inode is reused right away, the rest
+    // of its state has to match as well
+    std::map<uint64_t, size_t> deleted;
+    for (size_t i = 0; i < changes.size(); ++i) {
+        if (changes[i].type == DELETED && changes[i].entry.inode != 0) {
+            deleted[changes[i].entry.inode] = i;
+        }
+    }
+    if (deleted.empty()) {
+        return;
+    }
+
+    std::map<size_t, size_t>                partners;
+    std::set<std::pair<fs::path, fs::path>> renames;
+    for (size_t i = 0; i < changes.size(); ++i) {
+        if (changes[i].type != CREATED || changes[i].entry.inode == 0) {
+            continue;
+        }
+
+        auto source = deleted.find(changes[i].entry.inode);
+        if (source == deleted.end() ||
+            changes[source->second].relativePath == changes[i].relativePath ||
+            !isSameEntry(changes[source->second].entry, changes[i].entry)) {
+            continue;
+        }
+
+        partners[source->second] = i;
+        renames.emplace(changes[source->second].relativePath,
+                        changes[i].relativePath);
+        deleted.erase(source);
+    }
+
+    // entries of a renamed directory are not reported separately, just like
+    // it is the case for the native backends
+    auto isImplied = [&renames](const fs::path &from, const fs::path &to) {
+        auto fromParent = from.parent_path();
+        auto toParent   = to.parent_path();
+        if (from.filename() != to.filename()) {
+            return false;
+        }
+        while (!fromParent.empty() && !toParent.empty()) {
+            if (renames.count({fromParent, toParent}) > 0) {
+                return true;
+            }
+            if (fromParent.filename() != toParent.filename()) {
+                return false;
+            }
+            fromParent = fromParent.parent_path();
+            toParent   = toParent.parent_path();
+        }
+        return false;
+    };
+
+    std::vector<Change> result;
+    std::set<size_t>    skipped;
+    for (size_t i = 0; i < changes.size(); ++i) {
+        if (skipped.count(i) > 0) {
+            continue;
+        }
+
+        auto partner = partners.find(i);
+        if (partner == partners.end()) {
+            result.push_back(std::move(changes[i]));
+            continue;
+        }
+
+        skipped.insert(partner->second);
+        Change &from = changes[i];
+        Change &to   = changes[partner->second];
+        if (isImplied(from.relativePath, to.relativePath)) {
+            continue;
+        }
+
+        // the pair is reported adjacently, like a native rename
+        from.type = DELETED | RENAMED;
+        to.type   = CREATED | RENAMED;
+        result.push_back(std::move(from));
+        result.push_back(std::move(to));
+    }
+    changes = std::move(result);
+}
+
+bool PollingScanner::isSameEntry(const Entry &lhs, const Entry &rhs)
+{
+    if (lhs.inode != rhs.inode || lhs.device != rhs.device ||
+        lhs.isDirectory != rhs.isDirectory) {
+        return false;
+    }
+
+    // a reused inode is born again, where the file system tells
+    const bool knowsBirth = lhs.birth != 0 && rhs.birth != 0;
+    if (knowsBirth && lhs.birth != rhs.birth) {
+        return false;
+    }
+
+    // the entries of a renamed directory may change along with it
+    if (lhs.isDirectory && knowsBirth) {
+        return true;
+    }
+    return lhs.size == rhs.size && lhs.mtime == rhs.mtime;
+}
+
+void PollingScanner::update(Directory &          directory,
+                            const fs::path &     path,
+                            const fs::path &     relativePath,
+                            const Entry &        self,
+                            bool                 list,
+                            const Context &      context,
+                            std::vector<Change> &changes,
+                            std::vector<Task> *  deferred)
+{
+    ++*context.directoryCount;
+
+    list = list || directory.racy || directory.self.mtime != self.mtime ||
+           directory.self.inode != self.inode;
+    directory.self = self;
+    directory.racy = self.mtime >= context.scanStart - RACY_WINDOW_NS;
+
+    if (list) {
+        listEntries(directory, path, relativePath, context, changes, deferred);
+    } else {
+        updateEntries(directory, path, relativePath, context, changes,
+                      deferred);
+    }
+}
+
+void PollingScanner::updateEntries(Directory &          directory,
+                                   const fs::path &     path,
+                                   const fs::path &     relativePath,
+                                   const Context &      context,
+                                   std::vector<Change> &changes,
+                                   std::vector<Task> *  deferred)
+{
+    // without an mtime change no entry has been added or removed, only the
+    // known entries have to be checked for modifications
+    for (auto file = directory.files.begin(); file != directory.files.end();) {
+        Entry current;
+        if (!statEntry(path / file->first, current) || current.isDirectory) {
+            // racing with a change which will show up in the next listing
+            directory.racy = true;
+            ++file;
+            continue;
+        }
+
+        if (current.inode != file->second.inode) {
+            changes.emplace_back(DELETED, relativePath / file->first,
+                                 file->second);
+            changes.emplace_back(CREATED, relativePath / file->first, current);
+        } else if (current.size != file->second.size ||
+                   current.mtime != file->second.mtime) {
+            changes.emplace_back(MODIFIED, relativePath / file->first);
+        }
+        file->second = current;
+        ++file;
+    }
+
+    for (auto &subdirectory : directory.directories) {
+        const auto subPath = path / subdirectory.first;
+        Entry      current;
+        if (!statEntry(subPath, current) || !current.isDirectory) {
+            directory.racy = true;
+            continue;
+        }
+
+        if (deferred != nullptr) {
+            deferred->push_back({subdirectory.second.get(), subPath,
+                                 relativePath / subdirectory.first, current,
+                                 false});
+        } else {
+            update(*subdirectory.second, subPath,
+                   relativePath / subdirectory.first, current, false, context,
+                   changes, nullptr);
+        }
+    }
+}
+
+void PollingScanner::listEntries(Directory &          directory,
+                                 const fs::path &     path,
+                                 const fs::path &     relativePath,
+                                 const Context &      context,
+                                 std::vector<Change> &changes,
+                                 std::vector<Task> *  deferred)
+{
+    std::vector<std::pair<fs::path::string_type, Entry>> listed;
+
+    std::error_code ec;
+    auto            dirItr = fs::directory_iterator(
+        path, fs::directory_options::skip_permission_denied, ec);
+    for (auto end = fs::directory_iterator(); !ec && dirItr != end;
+         dirItr.increment(ec)) {
+        Entry entry;
+        if (!statEntry(dirItr->path(), entry)) {
+            continue;
+        }
+
+        auto name = dirItr->path().filename().native();
+        if (entry.isDirectory && mIsWatched && !mIsWatched(relativePath / name)) {
+            continue;
+        }
+        listed.emplace_back(std::move(name), entry);
+    }
+    std::sort(listed.begin(), listed.end(),
+              [](const std::pair<fs::path::string_type, Entry> &lhs,
+                 const std::pair<fs::path::string_type, Entry> &rhs) {
+                  return lhs.first < rhs.first;
+              });
+
+    std::vector<std::pair<fs::path::string_type, Entry>>        files;
+    std::vector<std::pair<fs::path::string_type, DirectoryPtr>> directories;
+    std::vector<Change>                                         deleted;
+    std::vector<Change>                                         created;
+    std::vector<Task>                                           pending;
+
+    for (auto &entry : listed) {
+        const auto entryPath = relativePath / entry.first;
+        auto       oldFile   = findEntry(directory.files, entry.first);
+        auto oldDirectory    = findEntry(directory.directories, entry.first);
+        const bool known     = oldFile != directory.files.end() ||
+                           oldDirectory != directory.directories.end();
+
+        if (entry.second.isDirectory) {
+            bool list = true;
+            if (oldDirectory != directory.directories.end() &&
+                oldDirectory->second->self.inode == entry.second.inode) {
+                directories.emplace_back(entry.first,
+                                         std::move(oldDirectory->second));
+                list = false;
+            } else {
+                if (oldDirectory != directory.directories.end()) {
+                    reportDeleted(*oldDirectory->second, entryPath, deleted);
+                }
+                if (known && context.report) {
+                    deleted.emplace_back(
+                        DELETED, entryPath,
+                        oldFile != directory.files.end()
+                            ? oldFile->second
+                            : oldDirectory->second->self);
+                }
+                if (context.report) {
+                    created.emplace_back(CREATED, entryPath, entry.second);
+                }
+                directories.emplace_back(entry.first,
+                                         std::make_unique<Directory>());
+                directories.back().second->self = entry.second;
+            }
+
+            pending.push_back({directories.back().second.get(),
+                               path / entry.first, entryPath, entry.second,
+                               list});
+            continue;
+        }
+
+        if (oldFile != directory.files.end()) {
+            if (oldFile->second.inode != entry.second.inode) {
+                deleted.emplace_back(DELETED, entryPath, oldFile->second);
+                created.emplace_back(CREATED, entryPath, entry.second);
+            } else if (oldFile->second.size != entry.second.size ||
+                       oldFile->second.mtime != entry.second.mtime) {
+                created.emplace_back(MODIFIED, entryPath);
+            }
+        } else if (context.report) {
+            if (oldDirectory != directory.directories.end()) {
+                reportDeleted(*oldDirectory->second, entryPath, deleted);
+                deleted.emplace_back(DELETED, entryPath,
+                                     oldDirectory->second->self);
+            }
+            created.emplace_back(CREATED, entryPath, entry.second);
+        }
+        files.emplace_back(entry.first, entry.second);
+    }
+
+    if (context.report) {
+        for (const auto &file : directory.files) {
+            if (findEntry(files, file.first) == files.end() &&
+                findEntry(directories, file.first) == directories.end()) {
+                deleted.emplace_back(DELETED, relativePath / file.first,
+                                     file.second);
+            }
+        }
+        for (const auto &subdirectory : directory.directories) {
+            if (subdirectory.second &&
+                findEntry(files, subdirectory.first) == files.end() &&
+                findEntry(directories, subdirectory.first) ==
+                    directories.end()) {
+                reportDeleted(*subdirectory.second,
+                              relativePath / subdirectory.first, deleted);
+                deleted.emplace_back(DELETED,
+                                     relativePath / subdirectory.first,
+                                     subdirectory.second->self);
+            }
+        }
+    }
+
+    // deletions precede the creations, so a replaced entry is reported as
+    // deleted first, and a directory precedes its entries
+    changes.insert(changes.end(), std::make_move_iterator(deleted.begin()),
+                   std::make_move_iterator(deleted.end()));
+    changes.insert(changes.end(), std::make_move_iterator(created.begin()),
+                   std::make_move_iterator(created.end()));
+
+    directory.files       = std::move(files);
+    directory.directories = std::move(directories);
+
+    for (const auto &task : pending) {
+        if (deferred != nullptr) {
+            deferred->push_back(task);
+        } else {
+            update(*task.directory, task.path, task.relativePath, task.self,
+                   task.list, context, changes, nullptr);
+        }
+    }
+}
+
+void PollingScanner::reportDeleted(const Directory &    directory,
+                                   const fs::path &     relativePath,
+                                   std::vector<Change> &changes)
+{
+    for (const auto &file : directory.files) {
+        changes.emplace_back(DELETED, relativePath / file.first, file.second);
+    }
+    for (const auto &subdirectory : directory.directories) {
+        const auto subPath = relativePath / subdirectory.first;
+        reportDeleted(*subdirectory.second, subPath, changes);
+        changes.emplace_back(DELETED, subPath, subdirectory.second->self);
+    }
+}
+
+bool PollingScanner::statEntry(const fs::path &path, Entry &out)
+{
+#if defined(PFW_LINUX) && defined(STATX_BASIC_STATS)
+    struct statx result;
+    if (statx(AT_FDCWD, path.c_str(), AT_SYMLINK_NOFOLLOW,
+              STATX_TYPE | STATX_SIZE | STATX_INO | STATX_MTIME | STATX_BTIME,
+              &result) != 0) {
+        return false;
+    }
+
+    out.inode       = result.stx_ino;
+    out.device      = makedev(result.stx_dev_major, result.stx_dev_minor);
+    out.size        = result.stx_size;
+    out.isDirectory = S_ISDIR(result.stx_mode);
+    out.mtime =
+        result.stx_mtime.tv_sec * 1000000000LL + result.stx_mtime.tv_nsec;
+    out.birth = (result.stx_mask & STATX_BTIME)
+                    ? result.stx_btime.tv_sec * 1000000000LL +
+                          result.stx_btime.tv_nsec
+                    : 0;
+#elif defined(PFW_POSIX)
+    struct stat result;
+    if (lstat(path.c_str(), &result) != 0) {
+        return false;
+    }
+
+    out.inode       = result.st_ino;
+    out.device      = result.st_dev;
+    out.size        = result.st_size;
+    out.isDirectory = S_ISDIR(result.st_mode);
+#ifdef PFW_APPLE
+    out.mtime = result.st_mtimespec.tv_sec * 1000000000LL +
+                result.st_mtimespec.tv_nsec;
+    out.birth = result.st_birthtimespec.tv_sec * 1000000000LL +
+                result.st_birthtimespec.tv_nsec;
+#else
+    out.mtime = result.st_mtim.tv_sec * 1000000000LL + result.st_mtim.tv_nsec;
+    out.birth = 0;
+#endif
+#else
+    std::error_code ec;
+    auto            status = fs::symlink_status(path, ec);
+    if (ec || !fs::exists(status)) {
+        return false;
+    }
+
+    out.inode       = 0;
+    out.device      = 0;
+    out.isDirectory = fs::is_directory(status);
+    out.size        = out.isDirectory ? 0 : fs::file_size(path, ec);
+    out.mtime       = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    fs::last_write_time(path, ec).time_since_epoch())
+                    .count();
+    out.birth       = 0;
+#endif
+    return true;
+}
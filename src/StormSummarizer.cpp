@@ -0,0 +1,90 @@
+#include "pfw/StormSummarizer.h"
+
+#include <algorithm>
+
+#include "pfw/FileStatus.h"
+
+using namespace pfw;
+
+void StormSummarizer::summarize(std::vector<EventPtr> &events,
+                                size_t                 threshold)
+{
+    if (threshold == 0 || events.size() <= threshold) {
+        return;
+    }
+
+    // one trie of path components per root
+    std::map<fs::path, Node> roots;
+    for (size_t i = 0; i < events.size(); ++i) {
+        const auto &event = events[i];
+        if (failed(event->type) || buffer_overflow(event->type) ||
+            !event->previousPath.empty()) {
+            continue;
+        }
+
+        Node *node = &roots[event->root];
+        ++node->count;
+        for (const auto &component : event->relativePath) {
+            node = &node->children[component];
+            ++node->count;
+        }
+        node->events.push_back(i);
+    }
+
+    for (const auto &root : roots) {
+        summarize(events, root.first, fs::path(), root.second, threshold);
+    }
+
+    events.erase(std::remove_if(events.begin(), events.end(),
+                                [](const EventPtr &event) { return !event; }),
+                 events.end());
+}
+
+void StormSummarizer::summarize(std::vector<EventPtr> &events,
+                                const fs::path &       root,
+                                const fs::path &       relativePath,
+                                const Node &           node,
+                                size_t                 threshold)
+{
+    if (node.count <= threshold) {
+        return;
+    }
+
+    // a storm in a single subdirectory leaves its siblings alone
+    const std::pair<const fs::path, Node> *storm = nullptr;
+    for (const auto &child : node.children) {
+        if (child.second.count <= threshold) {
+            continue;
+        }
+        if (storm != nullptr) {
+            storm = nullptr;
+            break;
+        }
+        storm = &child;
+    }
+    if (storm != nullptr && node.count - storm->second.count <= threshold) {
+        summarize(events, root, relativePath / storm->first, storm->second,
+                  threshold);
+        return;
+    }
+
+    std::vector<size_t> replaced;
+    collect(node, replaced);
+    const auto first = *std::min_element(replaced.begin(), replaced.end());
+    for (const auto i : replaced) {
+        events[i].reset();
+    }
+
+    FileStatus status;
+    const bool exists = FileStatus::read(root / relativePath, status);
+    events[first] = std::make_unique<Event>(
+        SUBTREE | (exists ? MODIFIED : DELETED), relativePath, root);
+}
+
+void StormSummarizer::collect(const Node &node, std::vector<size_t> &out)
+{
+    out.insert(out.end(), node.events.begin(), node.events.end());
+    for (const auto &child : node.children) {
+        collect(child.second, out);
+    }
+}
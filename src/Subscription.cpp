@@ -0,0 +1,138 @@
+#include "pfw/Subscription.h"
+
+#include <algorithm>
+#include <set>
+
+using namespace pfw;
+
+Subscription::Subscription(BatchCallback callback, SubscriptionOptions options)
+    : mState(std::make_shared<State>())
+    , mExecutor(std::move(options.executor))
+    , mRoot(std::move(options.root))
+    , mSubtree(std::move(options.subtree))
+{
+    mState->callback = std::move(callback);
+    mState->capacity = std::max<size_t>(options.capacity, 1);
+    if (!mExecutor) {
+        mThread = std::thread(&Subscription::run, mState);
+    }
+}
+
+Subscription::~Subscription() { close(); }
+
+void Subscription::publish(const EventBatch &batch)
+{
+    if (!batch || batch->empty()) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mState->mutex);
+    if (mState->isClosed) {
+        return;
+    }
+
+    if (mState->queue.size() >= mState->capacity) {
+        // the subscriber has to scan the roots of the lost events again
+        auto &overflow = mState->overflow;
+        if (!overflow) {
+            overflow = std::make_shared<std::vector<SharedEvent>>();
+        }
+        std::set<fs::path> roots;
+        for (const auto &queued : mState->queue) {
+            mState->dropped += queued != overflow ? 1 : 0;
+            for (const auto &event : *queued) {
+                roots.insert(event->root);
+            }
+        }
+
+        overflow->clear();
+        for (const auto &root : roots) {
+            overflow->emplace_back(
+                std::make_shared<Event>(BUFFER_OVERFLOW, fs::path(), root));
+        }
+        mState->queue.clear();
+        mState->queue.push_back(overflow);
+    }
+    mState->queue.push_back(batch);
+
+    if (!mExecutor) {
+        mState->condition.notify_all();
+        return;
+    }
+    if (mState->isScheduled) {
+        return;
+    }
+    mState->isScheduled = true;
+    lock.unlock();
+
+    mExecutor([state = mState]() {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        drain(*state, lock);
+        state->isScheduled = false;
+    });
+}
+
+void Subscription::close()
+{
+    std::unique_lock<std::mutex> lock(mState->mutex);
+    mState->isClosed = true;
+    mState->queue.clear();
+    mState->overflow.reset();
+    mState->condition.notify_all();
+
+    const auto self = std::this_thread::get_id();
+    if (mState->running != self) {
+        mState->condition.wait(lock, [&]() {
+            return mState->running == std::thread::id();
+        });
+    }
+    lock.unlock();
+
+    if (mThread.joinable()) {
+        if (mThread.get_id() == self) {
+            mThread.detach();
+        } else {
+            mThread.join();
+        }
+    }
+}
+
+size_t Subscription::dropped()
+{
+    std::lock_guard<std::mutex> lock(mState->mutex);
+    return mState->dropped;
+}
+
+const fs::path &Subscription::root() const { return mRoot; }
+
+const fs::path &Subscription::subtree() const { return mSubtree; }
+
+void Subscription::drain(State &state, std::unique_lock<std::mutex> &lock)
+{
+    while (!state.isClosed && !state.queue.empty()) {
+        auto batch = std::move(state.queue.front());
+        state.queue.pop_front();
+        if (batch == state.overflow) {
+            state.overflow.reset();
+        }
+        state.running = std::this_thread::get_id();
+
+        lock.unlock();
+        state.callback(batch);
+        lock.lock();
+
+        state.running = std::thread::id();
+        state.condition.notify_all();
+    }
+}
+
+void Subscription::run(std::shared_ptr<State> state)
+{
+    std::unique_lock<std::mutex> lock(state->mutex);
+    while (!state->isClosed) {
+        state->condition.wait(lock, [&]() {
+            return state->isClosed || !state->queue.empty();
+        });
+        drain(*state, lock);
+    }
+}
@@ -0,0 +1,163 @@
+#include "pfw/SubscriptionRouter.h"
+
+#include <algorithm>
+
+using namespace pfw;
+
+void SubscriptionRouter::add(std::shared_ptr<Subscription> subscription)
+{
+    Node *node = &mRoots[subscription->root()];
+    for (const auto &component : subscription->subtree()) {
+        node = &node->children[component];
+    }
+    node->subscriptions.push_back(std::move(subscription));
+    ++mSize;
+}
+
+void SubscriptionRouter::remove(
+    const std::shared_ptr<Subscription> &subscription)
+{
+    auto root = mRoots.find(subscription->root());
+    if (root == mRoots.end()) {
+        return;
+    }
+
+    Node *node = &root->second;
+    for (const auto &component : subscription->subtree()) {
+        auto child = node->children.find(component);
+        if (child == node->children.end()) {
+            return;
+        }
+        node = &child->second;
+    }
+
+    auto &subscriptions = node->subscriptions;
+    auto  found =
+        std::find(subscriptions.begin(), subscriptions.end(), subscription);
+    if (found != subscriptions.end()) {
+        subscriptions.erase(found);
+        --mSize;
+    }
+}
+
+bool SubscriptionRouter::empty() const { return mSize == 0; }
+
+void SubscriptionRouter::publish(const std::vector<EventPtr> &events) const
+{
+    if (empty()) {
+        return;
+    }
+
+    // the events are copied once and shared by all parts
+    auto  all = std::make_shared<std::vector<SharedEvent>>();
+    Parts parts;
+    for (const auto &event : events) {
+        const SharedEvent shared = std::make_shared<const Event>(*event);
+        all->push_back(shared);
+        if (failed(event->type) || buffer_overflow(event->type)) {
+            broadcast(shared, parts);
+            continue;
+        }
+        route(shared, event->relativePath, parts);
+        if (!event->previousPath.empty()) {
+            route(shared, event->previousPath, parts);
+        }
+    }
+
+    // the subscribers of everything share the whole batch
+    auto everything = mRoots.find(fs::path());
+    if (everything != mRoots.end()) {
+        const EventBatch batch = std::move(all);
+        for (const auto &subscription : everything->second.subscriptions) {
+            subscription->publish(batch);
+        }
+    }
+
+    for (auto &part : parts) {
+        part.first->publish(
+            std::make_shared<std::vector<SharedEvent>>(std::move(part.second)));
+    }
+}
+
+void SubscriptionRouter::route(const SharedEvent &event,
+                               const fs::path &   relativePath,
+                               Parts &            parts) const
+{
+    for (const auto &root : {fs::path(), event->root}) {
+        auto top = mRoots.find(root);
+        if (top == mRoots.end()) {
+            continue;
+        }
+
+        // the subscribers of everything are served by the whole batch
+        const Node *node = &top->second;
+        if (!root.empty()) {
+            add(*node, event, parts);
+        }
+
+        bool isBelow = true;
+        for (const auto &component : relativePath) {
+            auto child = node->children.find(component);
+            if (child == node->children.end()) {
+                isBelow = false;
+                break;
+            }
+            node = &child->second;
+            add(*node, event, parts);
+        }
+
+        // a change of a directory above a subtree affects it as a whole
+        if (isBelow && event->type != MODIFIED) {
+            for (const auto &child : node->children) {
+                collect(child.second, event, parts);
+            }
+        }
+
+        if (event->root.empty()) {
+            break;
+        }
+    }
+}
+
+void SubscriptionRouter::broadcast(const SharedEvent &event,
+                                   Parts &            parts) const
+{
+    // there is no path to route by, the message of a failure is kept in the
+    // relative path
+    for (const auto &top : mRoots) {
+        if (!top.first.empty() && !event->root.empty() &&
+            top.first != event->root) {
+            continue;
+        }
+
+        // the subscribers of everything are served by the whole batch
+        if (!top.first.empty()) {
+            add(top.second, event, parts);
+        }
+        for (const auto &child : top.second.children) {
+            collect(child.second, event, parts);
+        }
+    }
+}
+
+void SubscriptionRouter::add(const Node &       node,
+                             const SharedEvent &event,
+                             Parts &            parts)
+{
+    for (const auto &subscription : node.subscriptions) {
+        auto &part = parts[subscription.get()];
+        if (part.empty() || part.back() != event) {
+            part.push_back(event);
+        }
+    }
+}
+
+void SubscriptionRouter::collect(const Node &       node,
+                                 const SharedEvent &event,
+                                 Parts &            parts)
+{
+    add(node, event, parts);
+    for (const auto &child : node.children) {
+        collect(child.second, event, parts);
+    }
+}
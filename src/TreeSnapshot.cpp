@@ -0,0 +1,267 @@
+#include "pfw/TreeSnapshot.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#include "pfw/internal/definitions.h"
+
+#ifdef PFW_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace pfw;
+
+namespace {
+
+const char   MAGIC[8]  = {'P', 'F', 'W', 'S', 'N', 'A', 'P', '2'};
+const size_t ALIGNMENT = 8;
+
+// writes the file and waits until the data is on the disk
+bool writeFile(const fs::path &path, const std::string &data)
+{
+#ifdef PFW_POSIX
+    const int fd =
+        open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return false;
+    }
+
+    size_t written = 0;
+    while (written < data.size()) {
+        const ssize_t result =
+            write(fd, data.data() + written, data.size() - written);
+        if (result > 0) {
+            written += result;
+        } else if (result == 0 || errno != EINTR) {
+            break;
+        }
+    }
+    const bool synced = written == data.size() && fsync(fd) == 0;
+    return close(fd) == 0 && synced;
+#else
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    return file.write(data.data(), data.size()) && file.flush();
+#endif
+}
+
+// makes the entries of the directory durable, e.g. a rename into it
+bool syncDirectory(const fs::path &directory)
+{
+#ifdef PFW_POSIX
+    const int fd = open(directory.empty() ? "." : directory.c_str(),
+                        O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    const bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
+#else
+    (void)directory;
+    return true;
+#endif
+}
+
+// a read-only view of a whole file
+class MappedFile
+{
+  public:
+    explicit MappedFile(const fs::path &path)
+        : mData(nullptr)
+        , mSize(0)
+    {
+#ifdef PFW_POSIX
+        const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            return;
+        }
+
+        struct stat status;
+        if (fstat(fd, &status) == 0 && status.st_size > 0) {
+            void *data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE,
+                              fd, 0);
+            if (data != MAP_FAILED) {
+                mData = static_cast<const char *>(data);
+                mSize = status.st_size;
+            }
+        }
+        close(fd);
+#else
+        std::ifstream file(path, std::ios::binary);
+        mBuffer.assign(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+        mData = mBuffer.data();
+        mSize = mBuffer.size();
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifdef PFW_POSIX
+        if (mData != nullptr) {
+            munmap(const_cast<char *>(mData), mSize);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const { return mData; }
+    size_t      size() const { return mSize; }
+
+  private:
+    const char *mData;
+    size_t      mSize;
+#ifndef PFW_POSIX
+    std::string mBuffer;
+#endif
+};
+
+size_t aligned(size_t size) { return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1); }
+
+/**
+ * Splits the file into the serialized scanners of its roots.
+ */
+std::map<fs::path, std::pair<const char *, size_t>>
+readSections(const MappedFile &file)
+{
+    std::map<fs::path, std::pair<const char *, size_t>> sections;
+
+    uint64_t rootCount = 0;
+    size_t   position  = sizeof(MAGIC) + sizeof(rootCount);
+    if (file.size() < position ||
+        std::memcmp(file.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        return sections;
+    }
+    std::memcpy(&rootCount, file.data() + sizeof(MAGIC), sizeof(rootCount));
+
+    for (uint64_t i = 0; i < rootCount; ++i) {
+        uint64_t sizes[2];
+        if (file.size() - position < sizeof(sizes)) {
+            break;
+        }
+        std::memcpy(sizes, file.data() + position, sizeof(sizes));
+        position += sizeof(sizes);
+
+        const uint64_t pathSize    = sizes[0];
+        const uint64_t sectionSize = sizes[1];
+        if (pathSize % sizeof(fs::path::value_type) != 0 ||
+            pathSize > file.size() - position ||
+            sectionSize > file.size() - position - pathSize) {
+            break;
+        }
+
+        fs::path::string_type root(pathSize / sizeof(fs::path::value_type),
+                                   fs::path::value_type());
+        std::memcpy(&root[0], file.data() + position, pathSize);
+        sections[root] = {file.data() + position + pathSize, sectionSize};
+        position       = aligned(position + pathSize + sectionSize);
+    }
+    return sections;
+}
+
+}  // namespace
+
+TreeSnapshot::TreeSnapshot(const fs::path &                 file,
+                           PollingScanner::WatchedPredicate isWatched)
+    : mFile(file)
+    , mIsWatched(std::move(isWatched))
+{
+}
+
+std::vector<EventPtr> TreeSnapshot::restore(const std::vector<fs::path> &roots)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    const MappedFile file(mFile);
+    const auto       sections = readSections(file);
+
+    std::vector<EventPtr> events;
+    for (const auto &root : roots) {
+        auto scanner = createScanner(root);
+
+        auto section = sections.find(root);
+        if (section != sections.end() &&
+            scanner->deserialize(section->second.first,
+                                 section->second.second)) {
+            for (const auto &change : scanner->scan()) {
+                events.emplace_back(std::make_unique<Event>(
+                    change.type, change.relativePath, root));
+            }
+        } else {
+            scanner->reset();
+        }
+
+        mScanners[root] = std::move(scanner);
+    }
+    return events;
+}
+
+void TreeSnapshot::addRoot(const fs::path &root)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mScanners.find(root) != mScanners.end()) {
+        return;
+    }
+
+    auto scanner = createScanner(root);
+    scanner->reset();
+    mScanners[root] = std::move(scanner);
+}
+
+void TreeSnapshot::removeRoot(const fs::path &root)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mScanners.erase(root);
+}
+
+bool TreeSnapshot::save()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    std::string data(MAGIC, sizeof(MAGIC));
+    uint64_t    rootCount = mScanners.size();
+    data.append(reinterpret_cast<const char *>(&rootCount), sizeof(rootCount));
+
+    for (const auto &scanner : mScanners) {
+        // the changes have been reported by the watcher already
+        scanner.second->scan();
+
+        std::string section;
+        scanner.second->serialize(section);
+
+        const auto &   root     = scanner.first.native();
+        const uint64_t sizes[2] = {root.size() * sizeof(fs::path::value_type),
+                                   section.size()};
+        data.append(reinterpret_cast<const char *>(sizes), sizeof(sizes));
+        data.append(reinterpret_cast<const char *>(root.data()), sizes[0]);
+        data += section;
+        data.resize(aligned(data.size()), '\0');
+    }
+
+    // a crash while writing leaves the previous snapshot intact; the data
+    // has to be durable before it replaces the snapshot, and the rename is
+    // only durable once the directory is synced
+    auto temporary = mFile;
+    temporary += ".tmp";
+    if (!writeFile(temporary, data)) {
+        return false;
+    }
+
+    std::error_code ec;
+    fs::rename(temporary, mFile, ec);
+    return !ec && syncDirectory(mFile.parent_path());
+}
+
+std::unique_ptr<PollingScanner>
+TreeSnapshot::createScanner(const fs::path &root)
+{
+    return std::make_unique<PollingScanner>(
+        root, std::thread::hardware_concurrency(), mIsWatched);
+}
@@ -2,7 +2,6 @@
 
 #include <csignal>
 #include <cstring>
-#include <map>
 #include <thread>
 
 using namespace pfw;
@@ -89,33 +88,13 @@ void Collector::sendEvents()
         std::swap(inputVector, result);
     }
 
-    // remove duplicates
-    std::map<std::filesystem::path, std::vector<EventPtr>::reverse_iterator>
-        values;
-    for (auto itr = result.rbegin(); itr != result.rend(); ++itr) {
-        auto result = values.emplace((*itr)->relativePath, itr);
-
-        if (result.second) {
-            continue;
-        }
-
-        EventPtr &event           = *itr;
-        EventPtr &conflictedEvent = *result.first->second;
-        conflictedEvent->type     = conflictedEvent->type | event->type;
-
-        event.reset(nullptr);
-    }
-
-    result.erase(std::remove_if(result.begin(), result.end(),
-                                [&](const EventPtr &value) { return !value; }),
-                 result.end());
-
     mFilter->filterAndNotify(std::move(result));
 }
 
-void Collector::sendError(const std::string &errorMsg)
+void Collector::sendError(const std::string &          errorMsg,
+                          const std::filesystem::path &root)
 {
-    mFilter->sendError(errorMsg);
+    mFilter->sendError(errorMsg, root);
 }
 
 void Collector::insert(std::vector<EventPtr> &&events)
@@ -127,9 +106,10 @@ void Collector::insert(std::vector<EventPtr> &&events)
 }
 
 void Collector::push_back(EventType                    type,
-                          const std::filesystem::path &relativePath)
+                          const std::filesystem::path &relativePath,
+                          const std::filesystem::path &root)
 {
     std::lock_guard<std::mutex> lock(event_input_mutex);
     inputVector.emplace_back(
-        std::unique_ptr<Event>(new Event(type, relativePath)));
+        std::unique_ptr<Event>(new Event(type, relativePath, root)));
 }
@@ -0,0 +1,566 @@
+#include "pfw/linux/FanotifyService.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/fanotify.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "pfw/MountTable.h"
+#include "pfw/linux/InotifyWatchRegistry.h"
+
+using namespace pfw;
+
+namespace {
+
+#ifdef FAN_REPORT_DFID_NAME
+const uint64_t EVENT_MASK = FAN_CREATE | FAN_DELETE | FAN_MODIFY | FAN_ATTRIB |
+                            FAN_MOVED_FROM | FAN_MOVED_TO | FAN_ONDIR;
+#endif
+
+// identifies the file system of a path the way fanotify reports it
+std::string fileSystemKey(const std::filesystem::path &path)
+{
+    struct statfs result;
+    if (statfs(path.c_str(), &result) != 0) {
+        return std::string();
+    }
+    return std::string(reinterpret_cast<const char *>(&result.f_fsid),
+                       sizeof(result.f_fsid));
+}
+
+// identifies a directory across all marked file systems
+std::string cacheKey(const std::string &fileSystemKey, const file_handle *handle)
+{
+    return fileSystemKey +
+           std::string(reinterpret_cast<const char *>(&handle->handle_type),
+                       sizeof(handle->handle_type)) +
+           std::string(reinterpret_cast<const char *>(handle->f_handle),
+                       handle->handle_bytes);
+}
+
+}  // namespace
+
+FanotifyService::FanotifyService(std::shared_ptr<Filter>         filter,
+                                 const std::filesystem::path &   path,
+                                 const std::chrono::milliseconds latency)
+    : mFilter(filter)
+    , mCollector(std::make_shared<Collector>(filter, latency))
+    , mFanotifyInstance(-1)
+    , mWakeup(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+    , mIsValid(false)
+    , mStopped(false)
+{
+#ifdef FAN_REPORT_DFID_NAME
+    mFanotifyInstance =
+        fanotify_init(FAN_CLASS_NOTIF | FAN_REPORT_DFID_NAME | FAN_CLOEXEC |
+                          FAN_NONBLOCK,
+                      O_RDONLY | O_LARGEFILE);
+#endif
+    if (mFanotifyInstance == -1 || mWakeup == -1) {
+        return;
+    }
+
+    // failures are not reported, the caller falls back to another backend
+    if (!path.empty()) {
+        const auto root = InotifyWatchRegistry::normalize(path);
+        if (!canResolveHandles(root)) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRoots.insert(root);
+        updateMarks();
+        if (mMarks.find(fileSystemKey(root)) == mMarks.end()) {
+            mRoots.clear();
+            updateMarks();
+            return;
+        }
+    }
+
+    mIsValid = true;
+    mThread  = std::thread(&FanotifyService::work, this);
+}
+
+FanotifyService::~FanotifyService()
+{
+    mStopped = true;
+    if (mThread.joinable()) {
+        uint64_t wakeup = 1;
+        if (write(mWakeup, &wakeup, sizeof(wakeup)) == -1) {
+            mFilter->sendError("Could not stop the fanotify thread.");
+        }
+        mThread.join();
+    }
+
+    for (const auto &mark : mMarks) {
+        close(mark.second.mountFd);
+    }
+    if (mFanotifyInstance != -1) {
+        close(mFanotifyInstance);
+    }
+    if (mWakeup != -1) {
+        close(mWakeup);
+    }
+}
+
+bool FanotifyService::isValid() { return mIsValid; }
+
+bool FanotifyService::isWatching()
+{
+    return mIsValid && !mStopped && !roots().empty();
+}
+
+void FanotifyService::applyFilterOptions(const FilterOptions &previous)
+{
+    // the paths are filtered on delivery, only the marked mounts depend on
+    // the options
+    if (!mIsValid || previous.oneFileSystem == mFilter->isOneFileSystem()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    updateMarks();
+}
+
+bool FanotifyService::addRoot(const std::filesystem::path &path)
+{
+    if (!mIsValid) {
+        return false;
+    }
+
+    const auto      root = InotifyWatchRegistry::normalize(path);
+    std::error_code ec;
+    if (!std::filesystem::is_directory(root, ec)) {
+        mCollector->sendError("Failed to open directory.", root);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mRoots.insert(root).second) {
+        return true;
+    }
+
+    updateMarks();
+    if (mMarks.find(fileSystemKey(root)) == mMarks.end()) {
+        mRoots.erase(root);
+        updateMarks();
+        mCollector->sendError("Failed to mark the file system.", root);
+        return false;
+    }
+    return true;
+}
+
+bool FanotifyService::removeRoot(const std::filesystem::path &path)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mRoots.erase(InotifyWatchRegistry::normalize(path)) == 0) {
+        return false;
+    }
+
+    updateMarks();
+    return true;
+}
+
+std::vector<std::filesystem::path> FanotifyService::roots()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return std::vector<std::filesystem::path>(mRoots.begin(), mRoots.end());
+}
+
+bool FanotifyService::canResolveHandles(const std::filesystem::path &path)
+{
+    std::vector<char> buffer(sizeof(file_handle) + MAX_HANDLE_SZ);
+    auto *handle         = reinterpret_cast<file_handle *>(buffer.data());
+    handle->handle_bytes = MAX_HANDLE_SZ;
+
+    int mountId = 0;
+    if (name_to_handle_at(AT_FDCWD, path.c_str(), handle, &mountId, 0) != 0) {
+        return false;
+    }
+
+    const int mountFd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (mountFd == -1) {
+        return false;
+    }
+
+    // fails without CAP_DAC_READ_SEARCH
+    const int fd = open_by_handle_at(mountFd, handle, O_PATH | O_CLOEXEC);
+    close(mountFd);
+    if (fd == -1) {
+        return false;
+    }
+    close(fd);
+    return true;
+}
+
+void FanotifyService::updateMarks()
+{
+#ifdef FAN_REPORT_DFID_NAME
+    const auto mounts        = MountTable::current();
+    const bool oneFileSystem = mFilter->isOneFileSystem();
+
+    // every file system is marked once, no matter how many roots it contains
+    std::map<std::string, std::filesystem::path> wanted;
+    for (const auto &root : mRoots) {
+        std::vector<std::filesystem::path> paths = {root};
+        if (!oneFileSystem) {
+            for (const auto &mountPoint : mounts.mountPointsBelow(root)) {
+                if (mounts.kindAt(mountPoint) == MountTable::LOCAL &&
+                    !mounts.isSkipped(root, mountPoint, false)) {
+                    paths.push_back(mountPoint);
+                }
+            }
+        }
+
+        for (const auto &path : paths) {
+            const auto key = fileSystemKey(path);
+            if (!key.empty()) {
+                wanted.emplace(key, path);
+            }
+        }
+    }
+
+    bool changed = false;
+    for (auto mark = mMarks.begin(); mark != mMarks.end();) {
+        if (wanted.find(mark->first) != wanted.end()) {
+            ++mark;
+            continue;
+        }
+
+        fanotify_mark(mFanotifyInstance, FAN_MARK_REMOVE | FAN_MARK_FILESYSTEM,
+                      EVENT_MASK, mark->second.mountFd, NULL);
+        close(mark->second.mountFd);
+        mark    = mMarks.erase(mark);
+        changed = true;
+    }
+
+    for (const auto &fileSystem : wanted) {
+        if (mMarks.find(fileSystem.first) != mMarks.end()) {
+            continue;
+        }
+
+        const int mountFd =
+            open(fileSystem.second.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (mountFd == -1) {
+            continue;
+        }
+        if (fanotify_mark(mFanotifyInstance,
+                          FAN_MARK_ADD | FAN_MARK_FILESYSTEM, EVENT_MASK,
+                          mountFd, NULL) != 0) {
+            close(mountFd);
+            continue;
+        }
+
+        mMarks[fileSystem.first] = {mountFd, fileSystem.second};
+        changed                  = true;
+    }
+
+    if (changed) {
+        mDirectories.clear();
+    }
+#endif
+}
+
+void FanotifyService::work()
+{
+    PendingMove pendingMove = {std::filesystem::path(), false, false};
+
+    pollfd fds[2] = {{mFanotifyInstance, POLLIN, 0}, {mWakeup, POLLIN, 0}};
+    while (!mStopped) {
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            mCollector->sendError("Poll on fanotify fails because of error: " +
+                                  std::string(strerror(errno)));
+            break;
+        }
+
+        if (mStopped || (fds[1].revents & POLLIN) != 0) {
+            break;
+        }
+        if ((fds[0].revents & POLLIN) != 0) {
+            read(pendingMove);
+        }
+    }
+}
+
+void FanotifyService::read(PendingMove &pendingMove)
+{
+#ifdef FAN_REPORT_DFID_NAME
+    static const int BUFFER_SIZE = 16384;
+    alignas(fanotify_event_metadata) char buffer[BUFFER_SIZE];
+
+    ssize_t bytesRead;
+    while ((bytesRead = ::read(mFanotifyInstance, buffer, BUFFER_SIZE)) > 0) {
+        auto *metadata = reinterpret_cast<fanotify_event_metadata *>(buffer);
+        for (; FAN_EVENT_OK(metadata, bytesRead);
+             metadata = FAN_EVENT_NEXT(metadata, bytesRead)) {
+            if (metadata->vers != FANOTIFY_METADATA_VERSION) {
+                mCollector->sendError("Unsupported fanotify metadata version.");
+                mStopped = true;
+                return;
+            }
+            if ((metadata->mask & FAN_Q_OVERFLOW) != 0) {
+                overflowed();
+                continue;
+            }
+
+            // the record naming the parent directory and the entry
+            const fanotify_event_info_fid *info   = NULL;
+            size_t                         offset = metadata->metadata_len;
+            while (offset + sizeof(fanotify_event_info_header) <=
+                   metadata->event_len) {
+                const auto *header =
+                    reinterpret_cast<const fanotify_event_info_header *>(
+                        reinterpret_cast<const char *>(metadata) + offset);
+                if (header->len == 0) {
+                    break;
+                }
+                if (header->info_type == FAN_EVENT_INFO_TYPE_DFID_NAME) {
+                    info =
+                        reinterpret_cast<const fanotify_event_info_fid *>(header);
+                    break;
+                }
+                offset += header->len;
+            }
+            if (info == NULL) {
+                continue;
+            }
+
+            const auto *handle =
+                reinterpret_cast<const file_handle *>(info->handle);
+            const char *name = reinterpret_cast<const char *>(
+                handle->f_handle + handle->handle_bytes);
+
+            std::filesystem::path directory;
+            if (!resolve(std::string(reinterpret_cast<const char *>(&info->fsid),
+                                     sizeof(info->fsid)),
+                         handle, directory)) {
+                continue;
+            }
+
+            const auto path =
+                std::strcmp(name, ".") == 0 ? directory : directory / name;
+            const bool isDirectory = (metadata->mask & FAN_ONDIR) != 0;
+
+            if ((metadata->mask & FAN_MOVED_FROM) != 0) {
+                if (pendingMove.isGood) {
+                    deleted(pendingMove.path, pendingMove.isDirectory);
+                }
+                pendingMove = {path, isDirectory, true};
+            }
+            if ((metadata->mask & FAN_CREATE) != 0) {
+                created(path, isDirectory);
+            }
+            if ((metadata->mask & (FAN_MODIFY | FAN_ATTRIB)) != 0) {
+                modified(path);
+            }
+            if ((metadata->mask & FAN_MOVED_TO) != 0) {
+                if (pendingMove.isGood) {
+                    moved(pendingMove, path);
+                    pendingMove.isGood = false;
+                } else {
+                    created(path, isDirectory);
+                }
+            }
+            if ((metadata->mask & FAN_DELETE) != 0) {
+                deleted(path, isDirectory);
+            }
+        }
+    }
+
+    // both halves of a rename are queued at once, so a source without a
+    // destination has been moved out of the marked file systems
+    if (pendingMove.isGood) {
+        deleted(pendingMove.path, pendingMove.isDirectory);
+        pendingMove.isGood = false;
+    }
+#else
+    (void)pendingMove;
+#endif
+}
+
+bool FanotifyService::resolve(const std::string &    fileSystemKey,
+                              const void *           handle,
+                              std::filesystem::path &out)
+{
+    const auto *fileHandle = reinterpret_cast<const file_handle *>(handle);
+    const auto  key        = cacheKey(fileSystemKey, fileHandle);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto                        cached = mDirectories.find(key);
+    if (cached != mDirectories.end()) {
+        out = cached->second;
+        return true;
+    }
+
+    auto mark = mMarks.find(fileSystemKey);
+    if (mark == mMarks.end()) {
+        return false;
+    }
+
+    // a directory which is gone already can not be resolved anymore
+    const int fd = open_by_handle_at(mark->second.mountFd,
+                                     const_cast<file_handle *>(fileHandle),
+                                     O_PATH | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+
+    char       target[PATH_MAX];
+    const auto link   = "/proc/self/fd/" + std::to_string(fd);
+    const auto length = readlink(link.c_str(), target, sizeof(target));
+    close(fd);
+    if (length <= 0 || static_cast<size_t>(length) >= sizeof(target)) {
+        return false;
+    }
+
+    if (mDirectories.size() >= MAX_CACHED_DIRECTORIES) {
+        mDirectories.clear();
+    }
+    out = std::string(target, length);
+    mDirectories.emplace(key, out);
+    return true;
+}
+
+void FanotifyService::remember(const std::filesystem::path &directory)
+{
+    std::vector<char> buffer(sizeof(file_handle) + MAX_HANDLE_SZ);
+    auto *handle         = reinterpret_cast<file_handle *>(buffer.data());
+    handle->handle_bytes = MAX_HANDLE_SZ;
+
+    int mountId = 0;
+    if (name_to_handle_at(AT_FDCWD, directory.c_str(), handle, &mountId, 0) !=
+        0) {
+        return;
+    }
+
+    const auto key = cacheKey(fileSystemKey(directory), handle);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mDirectories.size() >= MAX_CACHED_DIRECTORIES) {
+        mDirectories.clear();
+    }
+    mDirectories[key] = directory;
+}
+
+void FanotifyService::forget(const std::filesystem::path &directory)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto cached = mDirectories.begin(); cached != mDirectories.end();) {
+        if (Filter::isSubPath(directory, cached->second)) {
+            cached = mDirectories.erase(cached);
+        } else {
+            ++cached;
+        }
+    }
+}
+
+void FanotifyService::created(const std::filesystem::path &path,
+                              bool                         isDirectory)
+{
+    push(CREATED, path);
+    if (isDirectory) {
+        remember(path);
+    }
+}
+
+void FanotifyService::modified(const std::filesystem::path &path)
+{
+    push(MODIFIED, path);
+}
+
+void FanotifyService::deleted(const std::filesystem::path &path,
+                              bool                         isDirectory)
+{
+    push(DELETED, path);
+    if (isDirectory) {
+        lost(path);
+    }
+}
+
+void FanotifyService::moved(const PendingMove &          from,
+                            const std::filesystem::path &to)
+{
+    // the cached paths below a moved directory are outdated
+    if (from.isDirectory) {
+        forget(from.path);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // both events are inserted at once, so that they end up in the same
+        // batch
+        std::vector<EventPtr> events;
+        for (const auto &root : mRoots) {
+            const bool fromInside =
+                from.path != root && Filter::isSubPath(root, from.path);
+            const bool toInside = to != root && Filter::isSubPath(root, to);
+            if (fromInside && toInside) {
+                events.emplace_back(std::make_unique<Event>(
+                    DELETED | RENAMED, from.path.lexically_relative(root),
+                    root));
+                events.emplace_back(std::make_unique<Event>(
+                    CREATED | RENAMED, to.lexically_relative(root), root));
+            } else if (fromInside) {
+                events.emplace_back(std::make_unique<Event>(
+                    DELETED, from.path.lexically_relative(root), root));
+            } else if (toInside) {
+                events.emplace_back(std::make_unique<Event>(
+                    CREATED, to.lexically_relative(root), root));
+            }
+        }
+        if (!events.empty()) {
+            mCollector->insert(std::move(events));
+        }
+    }
+
+    if (from.isDirectory) {
+        lost(from.path);
+    }
+}
+
+void FanotifyService::overflowed()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (const auto &root : mRoots) {
+        mCollector->push_back(BUFFER_OVERFLOW, "", root);
+    }
+}
+
+void FanotifyService::push(EventType type, const std::filesystem::path &path)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (const auto &root : mRoots) {
+        if (path != root && Filter::isSubPath(root, path)) {
+            mCollector->push_back(type, path.lexically_relative(root), root);
+        }
+    }
+}
+
+void FanotifyService::lost(const std::filesystem::path &directory)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    bool changed = false;
+    for (auto root = mRoots.begin(); root != mRoots.end();) {
+        if (!Filter::isSubPath(directory, *root)) {
+            ++root;
+            continue;
+        }
+        mCollector->sendError("Service shutdown unexpectedly.", *root);
+        root    = mRoots.erase(root);
+        changed = true;
+    }
+
+    if (changed) {
+        updateMarks();
+    }
+}
@@ -7,16 +7,16 @@
 
 using namespace pfw;
 
-InotifyEventLoop::InotifyEventLoop(int             inotifyInstance,
-                                   InotifyService *inotifyService)
-    : mInotifyService(inotifyService)
+InotifyEventLoop::InotifyEventLoop(int                   inotifyInstance,
+                                   InotifyWatchRegistry *registry)
+    : mRegistry(registry)
     , mInotifyInstance(inotifyInstance)
     , mStopped(true)
 {
     int result = pthread_create(&mEventLoop, nullptr, work, this);
 
     if (result != 0) {
-        mInotifyService->sendError(
+        mRegistry->sendError(
             "Could not start InotifyEventLoop thread. ErrorCode: " +
             std::string(strerror(errno)));
         return;
@@ -36,10 +36,9 @@ void InotifyEventLoop::created(inotify_event *event,
     }
 
     if (isDirectoryEvent) {
-        mInotifyService->createDirectory(event->wd, event->name,
-                                         sendInitEvents);
+        mRegistry->createDirectory(event->wd, event->name, sendInitEvents);
     } else {
-        mInotifyService->create(event->wd, event->name);
+        mRegistry->create(event->wd, event->name);
     }
 }
 void InotifyEventLoop::modified(inotify_event *event)
@@ -48,7 +47,7 @@ void InotifyEventLoop::modified(inotify_event *event)
         return;
     }
 
-    mInotifyService->modify(event->wd, event->name);
+    mRegistry->modify(event->wd, event->name);
 }
 void InotifyEventLoop::deleted(inotify_event *event, bool isDirectoryRemoval)
 {
@@ -57,9 +56,9 @@ void InotifyEventLoop::deleted(inotify_event *event, bool isDirectoryRemoval)
     }
 
     if (isDirectoryRemoval) {
-        mInotifyService->removeDirectory(event->wd);
+        mRegistry->removeDirectory(event->wd);
     } else {
-        mInotifyService->remove(event->wd, event->name);
+        mRegistry->remove(event->wd, event->name);
     }
 }
 void InotifyEventLoop::moveStart(inotify_event *     event,
@@ -88,19 +87,19 @@ void InotifyEventLoop::moveEnd(inotify_event *     event,
 
     if (renameEvent.cookie != event->cookie) {
         if (renameEvent.isDirectory) {
-            mInotifyService->removeDirectory(renameEvent.wd, renameEvent.name);
+            mRegistry->removeDirectory(renameEvent.wd, renameEvent.name);
         }
-        mInotifyService->remove(renameEvent.wd, renameEvent.name);
+        mRegistry->remove(renameEvent.wd, renameEvent.name);
 
         return created(event, isDirectoryEvent, false);
     }
 
     if (renameEvent.isDirectory) {
-        mInotifyService->moveDirectory(renameEvent.wd, renameEvent.name,
-                                       event->wd, event->name);
+        mRegistry->moveDirectory(renameEvent.wd, renameEvent.name, event->wd,
+                                 event->name);
     } else {
-        mInotifyService->move(renameEvent.wd, renameEvent.name, event->wd,
-                              event->name);
+        mRegistry->move(renameEvent.wd, renameEvent.name, event->wd,
+                        event->name);
     }
 }
 
@@ -131,7 +130,7 @@ void *InotifyEventLoop::work(void *args)
         if (eventLoop->mStopped) {
             break;
         } else if (bytesRead == 0) {
-            eventLoop->mInotifyService->sendError(
+            eventLoop->mRegistry->sendError(
                 "InotifyEventLoop thread mStopped because read returned 0.");
             break;
         } else if (bytesRead == -1) {
@@ -139,7 +138,7 @@ void *InotifyEventLoop::work(void *args)
             if (errno == EINTR) {
                 break;
             }
-            eventLoop->mInotifyService->sendError(
+            eventLoop->mRegistry->sendError(
                 "Read on inotify fails because of error: " +
                 std::string(strerror(errno)));
             break;
@@ -180,8 +179,8 @@ void *InotifyEventLoop::work(void *args)
 
                 eventLoop->moveStart(event, isDirectoryEvent, renameEvent);
             } else if (event->mask & (uint32_t)IN_MOVE_SELF) {
-                eventLoop->mInotifyService->remove(event->wd, event->name);
-                eventLoop->mInotifyService->removeDirectory(event->wd);
+                eventLoop->mRegistry->remove(event->wd, event->name);
+                eventLoop->mRegistry->removeDirectory(event->wd);
             }
         } while ((position += sizeof(struct inotify_event) + event->len) <
                  bytesRead);
@@ -200,11 +199,11 @@ void *InotifyEventLoop::work(void *args)
             // will loose the information of pending rename event.
             if (renameEvent.isGood) {
                 if (renameEvent.isDirectory) {
-                    eventLoop->mInotifyService->removeDirectory(
+                    eventLoop->mRegistry->removeDirectory(
                         renameEvent.wd, renameEvent.name);
                 }
-                eventLoop->mInotifyService->remove(renameEvent.wd,
-                                                   renameEvent.name);
+                eventLoop->mRegistry->remove(renameEvent.wd,
+                                             renameEvent.name);
             }
         }
     }
@@ -231,7 +230,7 @@ InotifyEventLoop::~InotifyEventLoop()
 
     auto errorCode = pthread_cancel(mEventLoop);
     if (errorCode != 0) {
-        mInotifyService->sendError(
+        mRegistry->sendError(
             "Could not cancel InotifyEventLoop thread. ErrorCode: " +
             std::to_string(errorCode));
         return;
@@ -239,7 +238,7 @@ InotifyEventLoop::~InotifyEventLoop()
 
     errorCode = pthread_join(mEventLoop, NULL);
     if (errorCode != 0) {
-        mInotifyService->sendError(
+        mRegistry->sendError(
             "Could not join InotifyEventLoop thread. ErrorCode: " +
             std::to_string(errorCode));
     }
@@ -7,45 +7,50 @@ using namespace pfw;
 InotifyNode::InotifyNode(InotifyTree *                tree,
                          int                          inotifyInstance,
                          InotifyNode *                parent,
-                         const std::filesystem::path &fileWatcherRoot,
-                         const std::filesystem::path &relPath,
+                         const std::filesystem::path &name,
                          bool                         bSendInitEvent)
     : mInotifyInstance(inotifyInstance)
-    , mFileWatcherRoot(fileWatcherRoot)
-    , mRelPath(relPath)
+    , mName(name)
     , mParent(parent)
     , mTree(tree)
     , mWatchDescriptorInitialized(false)
     , mChildren(new std::map<std::filesystem::path, InotifyNode *>)
+    , mLastActivity(std::chrono::steady_clock::now())
 {
+    const auto path = getPath();
 
-    int attr = mParent != NULL ? ATTRIBUTES : ATTRIBUTES | IN_MOVE_SELF;
-
-    mWatchDescriptor = inotify_add_watch(
-        mInotifyInstance, (mFileWatcherRoot / mRelPath).c_str(), attr);
+    mWatchDescriptor =
+        inotify_add_watch(mInotifyInstance, path.c_str(), watchAttributes());
 
     mAlive = (mWatchDescriptor != -1);
 
     if (!mAlive) {
         if (errno == EACCES) {
             mTree->sendError("Read access to the given file (" +
-                             mRelPath.string() + ") is not permitted.");
+                                 path.string() + ") is not permitted.",
+                             path);
         } else if (errno == EFAULT) {
             mTree->sendError("pathname points outside of the process's "
-                             "accessible address space.");
+                             "accessible address space.",
+                             path);
         } else if (errno == ENOSPC) {
-            mTree->sendError("Inotify limit reached");
+            if (mParent != NULL) {
+                // the subtree is polled instead
+                mTree->watchLimitReached(path);
+            } else {
+                mTree->sendError("Inotify limit reached", path);
+            }
         } else if (errno == ENOMEM) {
-            mTree->sendError("Not enough space/cannot allocate memory");
+            mTree->sendError("Not enough space/cannot allocate memory", path);
         } else if (errno == EBADF || errno == EINVAL) {
-            mTree->sendError("Invalid file descriptor");
+            mTree->sendError("Invalid file descriptor", path);
         }
 
         return;
     }
 
     std::error_code ec;
-    auto status = std::filesystem::status(mFileWatcherRoot / mRelPath, ec);
+    auto            status = std::filesystem::status(path, ec);
     if (ec || !std::filesystem::is_directory(status) ||
         std::filesystem::is_symlink(status)) {
         inotify_rm_watch(mInotifyInstance, mWatchDescriptor);
@@ -61,39 +66,35 @@ InotifyNode::InotifyNode(InotifyTree *                tree,
 
 void InotifyNode::initRecursively(bool bSendInitEvent)
 {
+    const auto      path = getPath();
     std::error_code ec;
-    auto            dirItr =
-        std::filesystem::directory_iterator(
-            mFileWatcherRoot / mRelPath,
-            std::filesystem::directory_options::skip_permission_denied,
-            ec);
+    auto            dirItr = std::filesystem::directory_iterator(
+        path, std::filesystem::directory_options::skip_permission_denied, ec);
     if (ec) {
         return;
     }
     for (auto &child : dirItr) {
         std::error_code statusEc;
-        auto            status = std::filesystem::status(child);
+        auto            status = std::filesystem::status(child, statusEc);
         if (statusEc || std::filesystem::is_symlink(status)) {
             continue;
         }
 
         const auto filename = child.path().filename();
 
-        if (std::filesystem::is_directory(status)) {
+        if (std::filesystem::is_directory(status) &&
+            mTree->isWatched(path / filename)) {
 
             InotifyNode *childInotifyNode =
-                new InotifyNode(mTree, mInotifyInstance, this, mFileWatcherRoot,
-                                mRelPath / filename, bSendInitEvent);
+                createChild(filename, bSendInitEvent);
 
-            if (childInotifyNode->isAlive()) {
+            if (childInotifyNode != NULL) {
                 (*mChildren)[filename] = childInotifyNode;
-            } else {
-                delete childInotifyNode;
             }
         }
 
         if (bSendInitEvent) {
-            mTree->sendInitEvent(mRelPath / filename);
+            mTree->sendInitEvent(path / filename);
         }
     }
 }
@@ -112,38 +113,101 @@ InotifyNode::~InotifyNode()
     delete mChildren;
 }
 
-void InotifyNode::addChild(const std::filesystem::path &name,
-                           bool                         sendInitEvents)
+InotifyNode *InotifyNode::createChild(const std::filesystem::path &name,
+                                      bool sendInitEvents)
 {
-    InotifyNode *child =
-        new InotifyNode(mTree, mInotifyInstance, this, mFileWatcherRoot,
-                        mRelPath / name, sendInitEvents);
+    // an already crawled root of the tree is adopted instead of crawling the
+    // same directories a second time
+    const auto   path  = getPath() / name;
+    InotifyNode *child = mTree->adoptRoot(path, this);
+    if (child != NULL) {
+        return child;
+    }
 
-    if (child->isAlive()) {
-        (*mChildren)[name] = child;
-    } else {
+    // directories beyond the watch budget are polled instead
+    if (!mTree->reserveWatch(path)) {
+        return NULL;
+    }
+
+    child = new InotifyNode(mTree, mInotifyInstance, this, name,
+                            sendInitEvents);
+
+    if (!child->isAlive()) {
         delete child;
+        return NULL;
     }
+    return child;
 }
 
-void InotifyNode::fixPaths()
+InotifyNode *InotifyNode::addChild(const std::filesystem::path &name,
+                                   bool                         sendInitEvents)
 {
-    const auto relPath = mParent->getRelPath() / mRelPath.filename();
+    if (!mTree->isWatched(getPath() / name)) {
+        return NULL;
+    }
 
-    if (relPath == mRelPath) {
-        return;
+    InotifyNode *child = createChild(name, sendInitEvents);
+    if (child != NULL) {
+        (*mChildren)[name] = child;
     }
+    return child;
+}
+
+InotifyNode *InotifyNode::getChild(const std::filesystem::path &name)
+{
+    auto child = mChildren->find(name);
+    return child != mChildren->end() ? child->second : NULL;
+}
 
-    mRelPath = relPath;
+void InotifyNode::applyFilter()
+{
+    for (auto i = mChildren->begin(); i != mChildren->end();) {
+        if (!mTree->isWatched(i->second->getPath())) {
+            delete i->second;
+            i = mChildren->erase(i);
+            continue;
+        }
 
-    for (auto i = mChildren->begin(); i != mChildren->end(); ++i) {
-        i->second->fixPaths();
+        i->second->applyFilter();
+        ++i;
+    }
+}
+
+void InotifyNode::rescan()
+{
+    const auto      path = getPath();
+    std::error_code ec;
+    auto            dirItr = std::filesystem::directory_iterator(
+        path, std::filesystem::directory_options::skip_permission_denied, ec);
+    if (ec) {
+        return;
+    }
+    for (auto &child : dirItr) {
+        std::error_code statusEc;
+        auto            status = std::filesystem::status(child, statusEc);
+        if (statusEc || std::filesystem::is_symlink(status) ||
+            !std::filesystem::is_directory(status)) {
+            continue;
+        }
+
+        const auto   filename  = child.path().filename();
+        InotifyNode *childNode = getChild(filename);
+        if (childNode != NULL) {
+            // already observed directories might lead to further directories
+            // which have been skipped by the previous filter
+            childNode->rescan();
+        } else {
+            addChild(filename, false);
+        }
     }
 }
 
-std::filesystem::path InotifyNode::getRelPath() { return mRelPath; }
+std::filesystem::path InotifyNode::getPath()
+{
+    return mParent != NULL ? mParent->getPath() / mName : mName;
+}
 
-std::filesystem::path InotifyNode::getName() { return mRelPath.filename(); }
+std::filesystem::path InotifyNode::getName() { return mName.filename(); }
 
 bool InotifyNode::isAlive() { return mAlive; }
 
@@ -179,17 +243,55 @@ void InotifyNode::insertChild(InotifyNode *childNode)
 void InotifyNode::setNewParent(const std::filesystem::path &filename,
                                InotifyNode *                parentNode)
 {
-    if (mRelPath == std::filesystem::path() || parentNode == NULL) {
+    if (parentNode == NULL) {
         return;
     }
-    mRelPath = mRelPath.parent_path() / filename;
-    mParent  = parentNode;
-    fixPaths();
+
+    const bool wasRoot = mParent == NULL;
+    mName              = filename;
+    mParent            = parentNode;
+
+    if (wasRoot && mWatchDescriptorInitialized) {
+        // replaces the mask of the existing watch, the descriptor stays
+        inotify_add_watch(mInotifyInstance, getPath().c_str(),
+                          watchAttributes());
+    }
+}
+
+void InotifyNode::makeRoot(const std::filesystem::path &path)
+{
+    mName   = path;
+    mParent = NULL;
+
+    if (mWatchDescriptorInitialized) {
+        inotify_add_watch(mInotifyInstance, path.c_str(), watchAttributes());
+    }
+}
+
+void InotifyNode::touch()
+{
+    const auto now = std::chrono::steady_clock::now();
+    for (InotifyNode *node = this; node != NULL; node = node->mParent) {
+        node->mLastActivity = now;
+    }
+}
+
+size_t
+InotifyNode::collectIdle(std::vector<IdleSubtree> &            idle,
+                         std::chrono::steady_clock::time_point idleSince)
+{
+    size_t watchCount = 1;
+    for (auto &child : *mChildren) {
+        watchCount += child.second->collectIdle(idle, idleSince);
+    }
+
+    if (mParent != NULL && mLastActivity < idleSince) {
+        idle.push_back({this, watchCount, mLastActivity});
+    }
+    return watchCount;
 }
 
-std::filesystem::path
-InotifyNode::createFullPath(const std::filesystem::path &root,
-                            const std::filesystem::path &relPath)
+int InotifyNode::watchAttributes()
 {
-    return root / relPath;
+    return mParent != NULL ? ATTRIBUTES : ATTRIBUTES | IN_MOVE_SELF;
 }
@@ -5,139 +5,76 @@ using namespace pfw;
 InotifyService::InotifyService(std::shared_ptr<Filter>         filter,
                                const std::filesystem::path &   path,
                                const std::chrono::milliseconds latency)
-    : mCollector(std::make_shared<Collector>(filter, latency))
-    , mEventLoop(NULL)
-    , mTree(NULL)
+    : mRegistry(InotifyWatchRegistry::instance())
+    , mFilter(filter)
+    , mCollector(std::make_shared<Collector>(filter, latency))
 {
-    mInotifyInstance = inotify_init();
-
-    if (mInotifyInstance == -1) {
+    if (!mRegistry->isValid()) {
         mCollector->sendError("could not init inotify");
         return;
     }
 
-    mTree = new InotifyTree(mInotifyInstance, path, mCollector);
-    if (!mTree->isRootAlive()) {
-        delete mTree;
-        mTree      = NULL;
-        mEventLoop = NULL;
-    } else {
-        mEventLoop = new InotifyEventLoop(mInotifyInstance, this);
+    if (!path.empty()) {
+        addRoot(path);
     }
 }
 
 InotifyService::~InotifyService()
 {
-    if (mEventLoop != NULL) {
-        delete mEventLoop;
-    }
-
-    if (mTree != NULL) {
-        delete mTree;
+    for (const auto &root : roots()) {
+        mRegistry->unsubscribe(this, root);
     }
-
-    close(mInotifyInstance);
-}
-
-void InotifyService::create(int wd, std::filesystem::path name)
-{
-    dispatch(CREATED, wd, name);
 }
 
-void InotifyService::sendError(std::string errorMsg)
+bool InotifyService::addRoot(const std::filesystem::path &path)
 {
-    mCollector->sendError(errorMsg);
+    return mRegistry->isValid() && mRegistry->subscribe(this, path);
 }
 
-void InotifyService::dispatch(EventType             actionOld,
-                              int                   wdOld,
-                              std::filesystem::path nameOld,
-                              EventType             actionNew,
-                              int                   wdNew,
-                              std::filesystem::path nameNew)
+bool InotifyService::removeRoot(const std::filesystem::path &path)
 {
-    std::vector<EventPtr> result;
-    std::filesystem::path pathOld;
-    if (!mTree->getRelPath(pathOld, wdOld)) {
-        return;
-    }
-    result.emplace_back(std::make_unique<Event>(actionOld, pathOld / nameOld));
-
-    std::filesystem::path pathNew;
-    if (!mTree->getRelPath(pathNew, wdNew)) {
-        return;
+    const auto root = InotifyWatchRegistry::normalize(path);
+    {
+        std::lock_guard<std::mutex> lock(mRootsMutex);
+        if (mRoots.find(root) == mRoots.end()) {
+            return false;
+        }
     }
-    result.emplace_back(std::make_unique<Event>(actionNew, pathNew / nameNew));
 
-    mCollector->insert(std::move(result));
+    mRegistry->unsubscribe(this, root);
+    return true;
 }
 
-void InotifyService::dispatch(EventType             action,
-                              int                   wd,
-                              std::filesystem::path name)
+std::vector<std::filesystem::path> InotifyService::roots()
 {
-    std::filesystem::path path;
-    if (!mTree->getRelPath(path, wd)) {
-        return;
-    }
-
-    std::filesystem::path newPath = path / name;
-
-    mCollector->push_back(action, newPath);
+    std::lock_guard<std::mutex> lock(mRootsMutex);
+    return std::vector<std::filesystem::path>(mRoots.begin(), mRoots.end());
 }
 
 bool InotifyService::isWatching()
 {
-    if (mTree == NULL || mEventLoop == NULL) {
-        return false;
-    }
-
-    return mTree->isRootAlive() && mEventLoop->isLooping();
+    return mRegistry->isLooping() && !roots().empty();
 }
 
-void InotifyService::modify(int wd, std::filesystem::path name)
+void InotifyService::applyFilterOptions(const FilterOptions &previous)
 {
-    dispatch(MODIFIED, wd, name);
+    mRegistry->applyFilterOptions(this, previous);
 }
 
-void InotifyService::remove(int wd, std::filesystem::path name)
-{
-    dispatch(DELETED, wd, name);
-}
-
-void InotifyService::createDirectory(int                   wd,
-                                     std::filesystem::path name,
-                                     bool                  sendInitEvents)
-{
-    if (!mTree->nodeExists(wd)) {
-        return;
-    }
-
-    mTree->addDirectory(wd, name, sendInitEvents);
-    dispatch(CREATED, wd, name);
-}
-
-void InotifyService::removeDirectory(int wd) { mTree->removeDirectory(wd); }
-
-void InotifyService::removeDirectory(int wd, const std::filesystem::path &name)
+void InotifyService::sendError(const std::string &          errorMsg,
+                               const std::filesystem::path &root)
 {
-    mTree->removeDirectory(wd, name);
+    mCollector->sendError(errorMsg, root);
 }
 
-void InotifyService::move(int                   wdOld,
-                          std::filesystem::path oldName,
-                          int                   wdNew,
-                          std::filesystem::path newName)
+void InotifyService::rootAdded(const std::filesystem::path &root)
 {
-    dispatch(DELETED | RENAMED, wdOld, oldName, CREATED | RENAMED, wdNew,
-             newName);
+    std::lock_guard<std::mutex> lock(mRootsMutex);
+    mRoots.insert(root);
 }
 
-void InotifyService::moveDirectory(int                   wdOld,
-                                   std::filesystem::path oldName,
-                                   int                   wdNew,
-                                   std::filesystem::path newName)
+void InotifyService::rootRemoved(const std::filesystem::path &root)
 {
-    move(wdOld, oldName, wdNew, newName);
-    mTree->moveDirectory(wdOld, oldName, wdNew, newName);
+    std::lock_guard<std::mutex> lock(mRootsMutex);
+    mRoots.erase(root);
 }
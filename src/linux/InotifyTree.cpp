@@ -1,33 +1,190 @@
 #include "pfw/linux/InotifyTree.h"
 
+#include "pfw/linux/InotifyWatchRegistry.h"
+
 using namespace pfw;
 
-InotifyTree::InotifyTree(int                          inotifyInstance,
-                         const std::filesystem::path &path,
-                         std::shared_ptr<Collector>   collector)
-    : mRoot(NULL)
+InotifyTree::InotifyTree(int inotifyInstance, InotifyWatchRegistry *registry)
+    : mRegistry(registry)
     , mInotifyInstance(inotifyInstance)
-    , mCollector(collector)
 {
-    if (!std::filesystem::exists(path)) {
-        mCollector->sendError("Failed to open directory.");
-        return;
+}
+
+InotifyNode *InotifyTree::addRoot(const std::filesystem::path &path)
+{
+    InotifyNode *node =
+        new InotifyNode(this, mInotifyInstance, NULL, path, false);
+
+    if (!node->isAlive()) {
+        delete node;
+        return NULL;
     }
 
-    mRoot = new InotifyNode(this, mInotifyInstance, NULL, path,
-                            std::filesystem::path(""), false);
+    mRoots[path] = node;
+    return node;
+}
 
-    if (!mRoot->isAlive()) {
-        mCollector->sendError("Service shutdown unexpectedly.");
-        delete mRoot;
-        mRoot = NULL;
+void InotifyTree::removeRoot(const std::filesystem::path &path)
+{
+    auto rootItr = mRoots.find(path);
+    if (rootItr == mRoots.end()) {
         return;
     }
+
+    InotifyNode *node = rootItr->second;
+    mRoots.erase(rootItr);
+    delete node;
+}
+
+InotifyNode *InotifyTree::adoptRoot(const std::filesystem::path &path,
+                                    InotifyNode *                parent)
+{
+    auto rootItr = mRoots.find(path);
+    if (rootItr == mRoots.end()) {
+        return NULL;
+    }
+
+    InotifyNode *node = rootItr->second;
+    mRoots.erase(rootItr);
+    node->setNewParent(path.filename(), parent);
+    return node;
 }
 
-void InotifyTree::sendInitEvent(const std::filesystem::path relPath)
+InotifyNode *InotifyTree::detachNode(const std::filesystem::path &path)
 {
-    mCollector->push_back(CREATED, relPath);
+    InotifyNode *node = findNode(path);
+    if (node == NULL || node->getParent() == NULL) {
+        return node;
+    }
+
+    node->getParent()->removeAndGetChild(node->getName());
+    node->makeRoot(path);
+    mRoots[path] = node;
+    return node;
+}
+
+bool InotifyTree::isRoot(const std::filesystem::path &path)
+{
+    return mRoots.find(path) != mRoots.end();
+}
+
+std::vector<std::filesystem::path> InotifyTree::roots()
+{
+    std::vector<std::filesystem::path> result;
+    for (const auto &root : mRoots) {
+        result.push_back(root.first);
+    }
+    return result;
+}
+
+InotifyNode *InotifyTree::findRootOf(const std::filesystem::path &path)
+{
+    for (const auto &root : mRoots) {
+        if (Filter::isSubPath(root.first, path)) {
+            return root.second;
+        }
+    }
+    return NULL;
+}
+
+InotifyNode *InotifyTree::findNode(const std::filesystem::path &path)
+{
+    InotifyNode *node = findRootOf(path);
+    if (node == NULL) {
+        return NULL;
+    }
+
+    for (const auto &name : path.lexically_relative(node->getPath())) {
+        if (name == ".") {
+            continue;
+        }
+        node = node->getChild(name);
+        if (node == NULL) {
+            return NULL;
+        }
+    }
+    return node;
+}
+
+InotifyNode *InotifyTree::ensureNode(const std::filesystem::path &path)
+{
+    InotifyNode *node = findRootOf(path);
+    if (node == NULL) {
+        return NULL;
+    }
+
+    for (const auto &name : path.lexically_relative(node->getPath())) {
+        if (name == ".") {
+            continue;
+        }
+        InotifyNode *child = node->getChild(name);
+        node = child != NULL ? child : node->addChild(name, false);
+        if (node == NULL) {
+            return NULL;
+        }
+    }
+    return node;
+}
+
+void InotifyTree::sendInitEvent(const std::filesystem::path &path)
+{
+    mRegistry->sendInitEvent(path);
+}
+
+bool InotifyTree::isWatched(const std::filesystem::path &path)
+{
+    return mRegistry->isWatched(path);
+}
+
+size_t InotifyTree::watchCount()
+{
+    std::lock_guard<std::mutex> locked(mapBlock);
+    return mInotifyNodeByWatchDescriptor.size();
+}
+
+void InotifyTree::touch(int wd)
+{
+    InotifyNode *node = getInotifyTreeByWatchDescriptor(wd);
+    if (node != NULL) {
+        node->touch();
+    }
+}
+
+void InotifyTree::collectIdle(std::vector<IdleSubtree> &            idle,
+                              std::chrono::steady_clock::time_point idleSince)
+{
+    for (const auto &root : mRoots) {
+        root.second->collectIdle(idle, idleSince);
+    }
+}
+
+void InotifyTree::applyFilter()
+{
+    for (const auto &root : mRoots) {
+        root.second->applyFilter();
+    }
+}
+
+void InotifyTree::applyNewlyIncluded(InotifyNode *                node,
+                                     const std::filesystem::path &relPath)
+{
+    bool crawled = false;
+    for (const auto &name : relPath) {
+        InotifyNode *child = node->getChild(name);
+        if (child == NULL) {
+            // a freshly added child crawls its whole subtree already
+            child   = node->addChild(name, false);
+            crawled = true;
+        }
+        node = child;
+        if (node == NULL || crawled) {
+            break;
+        }
+    }
+
+    if (node != NULL && !crawled) {
+        node->rescan();
+    }
 }
 
 InotifyNode *InotifyTree::getInotifyTreeByWatchDescriptor(int watchDescriptor)
@@ -58,7 +215,7 @@ void InotifyTree::addNodeReferenceByWD(int wd, InotifyNode *node)
     mInotifyNodeByWatchDescriptor[wd] = node;
 }
 
-bool InotifyTree::getRelPath(std::filesystem::path &out, int wd)
+bool InotifyTree::getPath(std::filesystem::path &out, int wd)
 {
     InotifyNode *node = getInotifyTreeByWatchDescriptor(wd);
 
@@ -66,11 +223,17 @@ bool InotifyTree::getRelPath(std::filesystem::path &out, int wd)
         return false;
     }
 
-    out = node->getRelPath();
+    out = node->getPath();
     return true;
 }
 
-bool InotifyTree::isRootAlive() { return mRoot != NULL; }
+bool InotifyTree::isRoot(int wd)
+{
+    InotifyNode *node = getInotifyTreeByWatchDescriptor(wd);
+    return node != NULL && node->getParent() == NULL;
+}
+
+bool InotifyTree::isRootAlive() { return !mRoots.empty(); }
 
 bool InotifyTree::nodeExists(int wd)
 {
@@ -98,9 +261,7 @@ void InotifyTree::removeDirectory(int wd)
 
     InotifyNode *parent = node->getParent();
     if (parent == NULL) {
-        mCollector->sendError("Service shutdown unexpectedly.");
-        delete mRoot;
-        mRoot = NULL;
+        removeRoot(node->getPath());
         return;
     }
 
@@ -143,14 +304,25 @@ void InotifyTree::moveDirectory(int                          wdOld,
     nodeNew->insertChild(movingNode);
 }
 
-void InotifyTree::sendError(const std::string &error)
+void InotifyTree::sendError(const std::string &          error,
+                            const std::filesystem::path &path)
+{
+    mRegistry->sendError(error, path);
+}
+
+bool InotifyTree::reserveWatch(const std::filesystem::path &path)
+{
+    return mRegistry->reserveWatch(path);
+}
+
+void InotifyTree::watchLimitReached(const std::filesystem::path &path)
 {
-    mCollector->sendError(error);
+    mRegistry->watchLimitReached(path);
 }
 
 InotifyTree::~InotifyTree()
 {
-    if (isRootAlive()) {
-        delete mRoot;
+    for (auto &root : mRoots) {
+        delete root.second;
     }
 }
@@ -0,0 +1,999 @@
+#include "pfw/linux/InotifyWatchRegistry.h"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+
+#include "pfw/linux/InotifyEventLoop.h"
+#include "pfw/linux/InotifyService.h"
+#include "pfw/linux/InotifyTree.h"
+
+using namespace pfw;
+
+std::shared_ptr<InotifyWatchRegistry> InotifyWatchRegistry::instance()
+{
+    static std::mutex                          instanceMutex;
+    static std::weak_ptr<InotifyWatchRegistry> instance;
+
+    std::lock_guard<std::mutex> lock(instanceMutex);
+    auto                        registry = instance.lock();
+    if (!registry) {
+        registry.reset(new InotifyWatchRegistry());
+        instance = registry;
+    }
+    return registry;
+}
+
+InotifyWatchRegistry::InotifyWatchRegistry()
+    : mInotifyInstance(inotify_init())
+    , mTree(NULL)
+    , mEventLoop(NULL)
+    , mWatchBudget(defaultWatchBudget())
+    , mPollingInterval(std::chrono::seconds(1))
+    , mStopPolling(false)
+{
+    if (mInotifyInstance != -1) {
+        mTree = new InotifyTree(mInotifyInstance, this);
+    }
+}
+
+InotifyWatchRegistry::~InotifyWatchRegistry()
+{
+    {
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+        mStopPolling = true;
+    }
+    mPollingCondition.notify_all();
+    if (mPollingThread.joinable()) {
+        mPollingThread.join();
+    }
+
+    if (mEventLoop != NULL) {
+        delete mEventLoop;
+    }
+
+    if (mTree != NULL) {
+        delete mTree;
+    }
+
+    if (mInotifyInstance != -1) {
+        close(mInotifyInstance);
+    }
+}
+
+bool InotifyWatchRegistry::isValid() { return mTree != NULL; }
+
+bool InotifyWatchRegistry::isLooping()
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+    return mEventLoop != NULL && mEventLoop->isLooping();
+}
+
+std::filesystem::path
+InotifyWatchRegistry::normalize(const std::filesystem::path &path)
+{
+    std::error_code ec;
+    auto            result = std::filesystem::absolute(path, ec);
+    if (ec) {
+        result = path;
+    }
+
+    result = result.lexically_normal();
+    if (!result.has_filename() && result.has_relative_path()) {
+        result = result.parent_path();
+    }
+    return result;
+}
+
+bool InotifyWatchRegistry::subscribe(InotifyService *             service,
+                                     const std::filesystem::path &path)
+{
+    const auto root = normalize(path);
+    {
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+        if (!isValid()) {
+            return false;
+        }
+
+        // mounts are not notified, so the table is refreshed with every root
+        mMounts = MountTable::current();
+
+        // make room for the new directories by demoting idle subtrees, the
+        // rest of them is polled in case that is not enough
+        if (mTree->findNode(root) == NULL) {
+            const size_t watchCount = mTree->watchCount();
+            const size_t available =
+                mWatchBudget > watchCount ? mWatchBudget - watchCount : 0;
+            const size_t needed = countDirectories(root, mWatchBudget);
+            if (needed > available) {
+                demoteIdle(needed - available, root, idleSince());
+            }
+        }
+    }
+
+    // the demoted subtrees give up their watches before the root is crawled,
+    // and the parts of the root beyond the budget are polled on return
+    startPendingPolling();
+    const bool subscribed = addSubscription(service, root);
+    startPendingPolling();
+    return subscribed;
+}
+
+bool InotifyWatchRegistry::addSubscription(InotifyService *             service,
+                                           const std::filesystem::path &root)
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+    std::error_code ec;
+    if (!std::filesystem::exists(root, ec)) {
+        service->sendError("Failed to open directory.", root);
+        return false;
+    }
+
+    mSubscriptions[root].push_back(service);
+
+    InotifyNode *node = mTree->findNode(root);
+    if (node != NULL) {
+        // the directory is observed already, only the parts skipped because
+        // of the filters of the other subscribers have to be crawled
+        if (!isCompletelyCrawled(service, root)) {
+            node->rescan();
+        }
+    } else {
+        node = mTree->findRootOf(root) != NULL ? mTree->ensureNode(root)
+                                               : mTree->addRoot(root);
+    }
+
+    if (node == NULL) {
+        auto &subscribers = mSubscriptions[root];
+        subscribers.erase(
+            std::find(subscribers.begin(), subscribers.end(), service));
+        if (subscribers.empty()) {
+            mSubscriptions.erase(root);
+        }
+
+        service->sendError("Service shutdown unexpectedly.", root);
+        return false;
+    }
+
+    // the event loop is started lazily with the first root, so that a
+    // registry without any valid root does not occupy a thread
+    if (mEventLoop == NULL) {
+        mEventLoop = new InotifyEventLoop(mInotifyInstance, this);
+    }
+
+    service->rootAdded(root);
+    return true;
+}
+
+void InotifyWatchRegistry::unsubscribe(InotifyService *             service,
+                                       const std::filesystem::path &path)
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+    const auto root         = normalize(path);
+    auto       subscription = mSubscriptions.find(root);
+    if (subscription == mSubscriptions.end()) {
+        return;
+    }
+
+    auto &subscribers = subscription->second;
+    auto  subscriber =
+        std::find(subscribers.begin(), subscribers.end(), service);
+    if (subscriber == subscribers.end()) {
+        return;
+    }
+
+    subscribers.erase(subscriber);
+    service->rootRemoved(root);
+    if (!subscribers.empty()) {
+        return;
+    }
+    mSubscriptions.erase(subscription);
+
+    if (mTree->isRoot(root)) {
+        // subscriptions below the root keep their part of the tree
+        std::filesystem::path detached;
+        for (auto below = mSubscriptions.upper_bound(root);
+             below != mSubscriptions.end() &&
+             Filter::isSubPath(root, below->first);
+             ++below) {
+            if (!detached.empty() && Filter::isSubPath(detached, below->first)) {
+                continue;
+            }
+            mTree->detachNode(below->first);
+            detached = below->first;
+        }
+
+        mTree->removeRoot(root);
+    } else if (!isCompletelyCrawled(service, root)) {
+        // directories which were only observed for this subscription are not
+        // needed anymore
+        InotifyNode *containingRoot = mTree->findRootOf(root);
+        if (containingRoot != NULL) {
+            containingRoot->applyFilter();
+        }
+    }
+
+    prunePolling();
+}
+
+void InotifyWatchRegistry::applyFilterOptions(InotifyService *     service,
+                                              const FilterOptions &previous)
+{
+    {
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+        applyFilter(service, previous);
+    }
+    startPendingPolling();
+}
+
+void InotifyWatchRegistry::applyFilter(InotifyService *     service,
+                                       const FilterOptions &previous)
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+    if (!isValid()) {
+        return;
+    }
+
+    mMounts = MountTable::current();
+    mTree->applyFilter();
+    prunePolling();
+
+    const auto options       = service->mFilter->options();
+    const auto newlyIncluded = Filter::newlyIncluded(previous, options);
+    for (const auto &subscription : mSubscriptions) {
+        const auto &subscribers = subscription.second;
+        if (std::find(subscribers.begin(), subscribers.end(), service) ==
+            subscribers.end()) {
+            continue;
+        }
+
+        InotifyNode *node = mTree->findNode(subscription.first);
+        if (node == NULL) {
+            continue;
+        }
+
+        for (const auto &path : newlyIncluded) {
+            mTree->applyNewlyIncluded(node, path);
+        }
+
+        // the mount points below the root are crawled as well now
+        if (previous.oneFileSystem && !options.oneFileSystem) {
+            node->rescan();
+        }
+    }
+}
+
+size_t InotifyWatchRegistry::watchCount()
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+    return mTree != NULL ? mTree->watchCount() : 0;
+}
+
+size_t InotifyWatchRegistry::watchBudget()
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+    return mWatchBudget;
+}
+
+void InotifyWatchRegistry::setWatchBudget(size_t budget)
+{
+    {
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+        mWatchBudget = budget;
+
+        const size_t watchCount = this->watchCount();
+        if (watchCount > mWatchBudget) {
+            demoteIdle(watchCount - mWatchBudget, std::filesystem::path(),
+                       std::chrono::steady_clock::time_point::max());
+        }
+    }
+    startPendingPolling();
+}
+
+void InotifyWatchRegistry::setPollingInterval(
+    std::chrono::milliseconds interval)
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+    mPollingInterval = interval;
+}
+
+std::vector<std::filesystem::path> InotifyWatchRegistry::polledPaths()
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+    std::vector<std::filesystem::path> result;
+    for (const auto &polled : mPolled) {
+        result.push_back(polled.first);
+    }
+    return result;
+}
+
+void InotifyWatchRegistry::create(int wd, std::filesystem::path name)
+{
+    dispatch(CREATED, wd, name);
+}
+
+void InotifyWatchRegistry::createDirectory(int                   wd,
+                                           std::filesystem::path name,
+                                           bool                  sendInitEvents)
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+    if (!mTree->nodeExists(wd)) {
+        return;
+    }
+
+    mTree->addDirectory(wd, name, sendInitEvents);
+    dispatch(CREATED, wd, name);
+}
+
+void InotifyWatchRegistry::dispatch(EventType             action,
+                                    int                   wd,
+                                    std::filesystem::path name)
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+    std::filesystem::path path;
+    if (!mTree->getPath(path, wd)) {
+        return;
+    }
+    mTree->touch(wd);
+
+    ServiceEvents events;
+    collect(events, action, name.empty() ? path : path / name);
+    deliver(events);
+}
+
+void InotifyWatchRegistry::dispatch(EventType             actionOld,
+                                    int                   wdOld,
+                                    std::filesystem::path nameOld,
+                                    EventType             actionNew,
+                                    int                   wdNew,
+                                    std::filesystem::path nameNew)
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+    std::filesystem::path pathOld;
+    std::filesystem::path pathNew;
+    if (!mTree->getPath(pathOld, wdOld) || !mTree->getPath(pathNew, wdNew)) {
+        return;
+    }
+    mTree->touch(wdOld);
+    mTree->touch(wdNew);
+
+    ServiceEvents sources;
+    ServiceEvents destinations;
+    collect(sources, actionOld, pathOld / nameOld);
+    collect(destinations, actionNew, pathNew / nameNew);
+
+    // both halves of a subscription are inserted next to each other, so
+    // that they end up in the same batch; a subscription which only sees
+    // one of them gets a plain deletion or creation
+    ServiceEvents events;
+    for (auto &serviceSources : sources) {
+        auto &out     = events[serviceSources.first];
+        auto &targets = destinations[serviceSources.first];
+        for (auto &source : serviceSources.second) {
+            auto target = std::find_if(
+                targets.begin(), targets.end(), [&](const EventPtr &event) {
+                    return event && event->root == source->root;
+                });
+            if (target == targets.end()) {
+                source->type = source->type & ~RENAMED;
+                out.emplace_back(std::move(source));
+                continue;
+            }
+            out.emplace_back(std::move(source));
+            out.emplace_back(std::move(*target));
+        }
+    }
+    for (auto &serviceDestinations : destinations) {
+        auto &out = events[serviceDestinations.first];
+        for (auto &target : serviceDestinations.second) {
+            if (target) {
+                target->type = target->type & ~RENAMED;
+                out.emplace_back(std::move(target));
+            }
+        }
+    }
+    deliver(events);
+}
+
+void InotifyWatchRegistry::modify(int wd, std::filesystem::path name)
+{
+    dispatch(MODIFIED, wd, name);
+}
+
+void InotifyWatchRegistry::remove(int wd, std::filesystem::path name)
+{
+    dispatch(DELETED, wd, name);
+}
+
+void InotifyWatchRegistry::removeDirectory(int wd)
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+    std::filesystem::path path;
+    if (!mTree->getPath(path, wd)) {
+        return;
+    }
+
+    dropSubscriptions(path);
+    stopPolling(path);
+    mTree->removeDirectory(wd);
+}
+
+void InotifyWatchRegistry::removeDirectory(int                          wd,
+                                           const std::filesystem::path &name)
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+    std::filesystem::path path;
+    if (!mTree->getPath(path, wd)) {
+        return;
+    }
+
+    dropSubscriptions(path / name);
+    stopPolling(path / name);
+    mTree->removeDirectory(wd, name);
+}
+
+void InotifyWatchRegistry::move(int                   wdOld,
+                                std::filesystem::path oldName,
+                                int                   wdNew,
+                                std::filesystem::path newName)
+{
+    dispatch(DELETED | RENAMED, wdOld, oldName, CREATED | RENAMED, wdNew,
+             newName);
+}
+
+void InotifyWatchRegistry::moveDirectory(int                   wdOld,
+                                         std::filesystem::path oldName,
+                                         int                   wdNew,
+                                         std::filesystem::path newName)
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+    move(wdOld, oldName, wdNew, newName);
+
+    // subscribers of the moved directory lost their root
+    std::filesystem::path pathOld;
+    std::vector<std::filesystem::path> polled;
+    if (mTree->getPath(pathOld, wdOld)) {
+        pathOld /= oldName;
+        dropSubscriptions(pathOld);
+
+        for (auto itr = mPolled.lower_bound(pathOld);
+             itr != mPolled.end() && Filter::isSubPath(pathOld, itr->first);
+             ++itr) {
+            polled.push_back(itr->first.lexically_relative(pathOld));
+        }
+        stopPolling(pathOld);
+    }
+
+    mTree->moveDirectory(wdOld, oldName, wdNew, newName);
+
+    // polled parts of the moved directory are polled at their new location
+    std::filesystem::path pathNew;
+    if (polled.empty() || !mTree->getPath(pathNew, wdNew)) {
+        return;
+    }
+    pathNew /= newName;
+    for (const auto &relPath : polled) {
+        const auto path = (pathNew / relPath).lexically_normal();
+        if (mTree->findNode(path) == NULL &&
+            mTree->findNode(path.parent_path()) != NULL) {
+            startPolling(path);
+        }
+    }
+}
+
+void InotifyWatchRegistry::sendError(std::string errorMsg)
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+    for (const auto &subscription : mSubscriptions) {
+        for (auto *service : subscription.second) {
+            service->sendError(errorMsg, subscription.first);
+        }
+    }
+}
+
+void InotifyWatchRegistry::sendError(const std::string &          errorMsg,
+                                     const std::filesystem::path &path)
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+    for (const auto &subscription : mSubscriptions) {
+        if (!Filter::isSubPath(subscription.first, path) &&
+            !Filter::isSubPath(path, subscription.first)) {
+            continue;
+        }
+        for (auto *service : subscription.second) {
+            service->sendError(errorMsg, subscription.first);
+        }
+    }
+}
+
+bool InotifyWatchRegistry::isWatched(const std::filesystem::path &path)
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+    for (auto current = path;; current = current.parent_path()) {
+        auto subscription = mSubscriptions.find(current);
+        if (subscription != mSubscriptions.end()) {
+            const auto relPath = current == path
+                                     ? std::filesystem::path()
+                                     : path.lexically_relative(current);
+            for (auto *service : subscription->second) {
+                if (service->mFilter->isWatched(relPath) &&
+                    !mMounts.isSkipped(current, path,
+                                       service->mFilter->isOneFileSystem())) {
+                    return true;
+                }
+            }
+        }
+
+        if (!current.has_relative_path()) {
+            break;
+        }
+    }
+
+    // directories leading to the root of another subscription are needed
+    auto below = mSubscriptions.upper_bound(path);
+    return below != mSubscriptions.end() && Filter::isSubPath(path, below->first);
+}
+
+void InotifyWatchRegistry::sendInitEvent(const std::filesystem::path &path)
+{
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+    ServiceEvents events;
+    collect(events, CREATED, path);
+    deliver(events);
+}
+
+void InotifyWatchRegistry::collect(ServiceEvents &              events,
+                                   EventType                    action,
+                                   const std::filesystem::path &path)
+{
+    for (auto current = path;; current = current.parent_path()) {
+        auto subscription = mSubscriptions.find(current);
+        if (subscription != mSubscriptions.end()) {
+            const auto relPath = current == path
+                                     ? std::filesystem::path()
+                                     : path.lexically_relative(current);
+            for (auto *service : subscription->second) {
+                events[service].emplace_back(
+                    std::make_unique<Event>(action, relPath, current));
+            }
+        }
+
+        if (!current.has_relative_path()) {
+            break;
+        }
+    }
+}
+
+void InotifyWatchRegistry::deliver(ServiceEvents &events)
+{
+    for (auto &serviceEvents : events) {
+        serviceEvents.first->mCollector->insert(
+            std::move(serviceEvents.second));
+    }
+}
+
+void InotifyWatchRegistry::dropSubscriptions(const std::filesystem::path &path)
+{
+    for (auto subscription = mSubscriptions.lower_bound(path);
+         subscription != mSubscriptions.end() &&
+         Filter::isSubPath(path, subscription->first);) {
+        for (auto *service : subscription->second) {
+            service->rootRemoved(subscription->first);
+            service->sendError("Service shutdown unexpectedly.",
+                               subscription->first);
+        }
+        subscription = mSubscriptions.erase(subscription);
+    }
+}
+
+bool InotifyWatchRegistry::isCompletelyCrawled(
+    InotifyService *service, const std::filesystem::path &root)
+{
+    for (auto current = root;; current = current.parent_path()) {
+        auto subscription = mSubscriptions.find(current);
+        if (subscription != mSubscriptions.end()) {
+            for (auto *subscriber : subscription->second) {
+                if (subscriber == service) {
+                    continue;
+                }
+                const auto options = subscriber->mFilter->options();
+                if (options.includePaths.empty() &&
+                    options.excludePaths.empty()) {
+                    return true;
+                }
+            }
+        }
+
+        if (!current.has_relative_path()) {
+            break;
+        }
+    }
+    return false;
+}
+
+bool InotifyWatchRegistry::isNeededBySubscription(
+    const std::filesystem::path &path)
+{
+    auto subscription = mSubscriptions.lower_bound(path);
+    return subscription != mSubscriptions.end() &&
+           Filter::isSubPath(path, subscription->first);
+}
+
+size_t InotifyWatchRegistry::defaultWatchBudget()
+{
+    std::ifstream maxUserWatches("/proc/sys/fs/inotify/max_user_watches");
+    size_t        limit = 0;
+    if (!(maxUserWatches >> limit) || limit == 0) {
+        return std::numeric_limits<size_t>::max();
+    }
+
+    // leaves room for other inotify users of the same account
+    return limit / 4 * 3;
+}
+
+std::chrono::steady_clock::time_point InotifyWatchRegistry::idleSince()
+{
+    return std::chrono::steady_clock::now() -
+           mPollingInterval * DEMOTION_IDLE_SCANS;
+}
+
+bool InotifyWatchRegistry::reserveWatch(const std::filesystem::path &path)
+{
+    // changes made by other machines would never be notified
+    if (mMounts.kindAt(path) == MountTable::REMOTE) {
+        startPolling(path);
+        auto polled = mPolled.find(path);
+        if (polled != mPolled.end()) {
+            polled->second.remote = true;
+        }
+        return false;
+    }
+
+    if (mTree->watchCount() < mWatchBudget) {
+        mPolled.erase(path);
+        return true;
+    }
+
+    startPolling(path);
+    return false;
+}
+
+void InotifyWatchRegistry::watchLimitReached(const std::filesystem::path &path)
+{
+    // the kernel limit is shared with other processes, so the budget is
+    // reduced to what is actually available
+    mWatchBudget = std::min(mWatchBudget, mTree->watchCount());
+    startPolling(path);
+}
+
+size_t InotifyWatchRegistry::countDirectories(const std::filesystem::path &path,
+                                              size_t limit)
+{
+    std::error_code ec;
+    if (!std::filesystem::is_directory(path, ec)) {
+        return 0;
+    }
+
+    size_t count  = 1;
+    auto   dirItr = std::filesystem::recursive_directory_iterator(
+        path, std::filesystem::directory_options::skip_permission_denied, ec);
+    for (auto end = std::filesystem::recursive_directory_iterator();
+         !ec && dirItr != end && count < limit; dirItr.increment(ec)) {
+        if (!dirItr->is_directory(ec) || dirItr->is_symlink(ec)) {
+            continue;
+        }
+
+        if (!isWatched(dirItr->path())) {
+            dirItr.disable_recursion_pending();
+            continue;
+        }
+        // remote mounts are polled without occupying any watch
+        if (mMounts.kindAt(dirItr->path()) != MountTable::LOCAL) {
+            dirItr.disable_recursion_pending();
+            continue;
+        }
+        ++count;
+    }
+    return count;
+}
+
+void InotifyWatchRegistry::demoteIdle(
+    size_t                                count,
+    const std::filesystem::path &         exclude,
+    std::chrono::steady_clock::time_point idleSince)
+{
+    std::vector<IdleSubtree> idle;
+    mTree->collectIdle(idle, idleSince);
+
+    // the least recently active subtrees first, larger ones on a tie
+    std::sort(idle.begin(), idle.end(),
+              [](const IdleSubtree &lhs, const IdleSubtree &rhs) {
+                  if (lhs.lastActivity != rhs.lastActivity) {
+                      return lhs.lastActivity < rhs.lastActivity;
+                  }
+                  return lhs.watchCount > rhs.watchCount;
+              });
+
+    std::vector<std::filesystem::path> demoted;
+    size_t                             freed = 0;
+    for (const auto &subtree : idle) {
+        if (freed >= count) {
+            break;
+        }
+
+        const auto path = subtree.node->getPath();
+        if (!exclude.empty() && (Filter::isSubPath(path, exclude) ||
+                                 Filter::isSubPath(exclude, path))) {
+            continue;
+        }
+        if (isNeededBySubscription(path)) {
+            continue;
+        }
+
+        auto overlapping = std::find_if(
+            demoted.begin(), demoted.end(),
+            [&path](const std::filesystem::path &other) {
+                return Filter::isSubPath(other, path) ||
+                       Filter::isSubPath(path, other);
+            });
+        if (overlapping != demoted.end()) {
+            continue;
+        }
+
+        demoted.push_back(path);
+        freed += subtree.watchCount;
+    }
+
+    for (const auto &path : demoted) {
+        demote(path);
+    }
+}
+
+void InotifyWatchRegistry::demote(const std::filesystem::path &path)
+{
+    InotifyNode *node = mTree->findNode(path);
+    if (node == NULL || node->getParent() == NULL) {
+        return;
+    }
+
+    // the snapshot is taken while the watches are still in place, so no
+    // change falls in between; they are removed once it is polled
+    startPolling(path);
+    auto polled = mPolled.find(path);
+    if (polled != mPolled.end() &&
+        polled->second.state != PolledSubtree::POLLING) {
+        polled->second.demoted = true;
+    }
+}
+
+void InotifyWatchRegistry::makeRoomFor(const std::filesystem::path &path)
+{
+    auto polled = mPolled.find(path);
+    if (polled == mPolled.end()) {
+        return;
+    }
+
+    const size_t needed     = polled->second.scanner->directoryCount();
+    const size_t watchCount = mTree->watchCount();
+    if (watchCount + needed > mWatchBudget) {
+        demoteIdle(watchCount + needed - mWatchBudget, path, idleSince());
+    }
+}
+
+void InotifyWatchRegistry::promote(const std::filesystem::path &path)
+{
+    auto polled = mPolled.find(path);
+    if (polled == mPolled.end() ||
+        polled->second.state != PolledSubtree::POLLING) {
+        return;
+    }
+    polled->second.busyScans = 0;
+
+    if (mTree->watchCount() >= mWatchBudget) {
+        return;
+    }
+
+    InotifyNode *parent = mTree->findNode(path.parent_path());
+    if (parent == NULL) {
+        mPolled.erase(path);
+        return;
+    }
+
+    // reserving the watch of the directory ends its polling
+    parent->addChild(path.filename(), false);
+}
+
+void InotifyWatchRegistry::startPolling(const std::filesystem::path &path)
+{
+    if (mPolled.find(path) != mPolled.end()) {
+        return;
+    }
+
+    // a subtree of a polled directory is covered by it already, and the
+    // polled subtrees below the path are covered by the new one
+    for (auto parent = path.parent_path(); parent.has_relative_path();
+         parent      = parent.parent_path()) {
+        if (mPolled.find(parent) != mPolled.end()) {
+            return;
+        }
+    }
+    stopPolling(path);
+
+    mPolled[path] = {std::make_shared<PollingScanner>(path), 0, false,
+                     PolledSubtree::PENDING, false};
+
+    if (!mPollingThread.joinable()) {
+        mPollingThread = std::thread(&InotifyWatchRegistry::pollingLoop, this);
+    }
+    mPollingCondition.notify_all();
+}
+
+void InotifyWatchRegistry::startPendingPolling()
+{
+    using Pending = std::pair<std::filesystem::path,
+                              std::shared_ptr<PollingScanner>>;
+
+    std::unique_lock<std::recursive_mutex> lock(mMutex);
+    for (;;) {
+        std::vector<Pending> pending;
+        for (auto &polled : mPolled) {
+            if (polled.second.state == PolledSubtree::PENDING) {
+                polled.second.state = PolledSubtree::STARTING;
+                pending.emplace_back(polled.first, polled.second.scanner);
+            }
+        }
+        if (pending.empty()) {
+            break;
+        }
+
+        // a snapshot takes as long as a full scan of the subtree, just like
+        // the scans of the polling loop
+        lock.unlock();
+        for (auto &subtree : pending) {
+            subtree.second->reset();
+        }
+        lock.lock();
+
+        for (const auto &subtree : pending) {
+            auto polled = mPolled.find(subtree.first);
+            if (polled == mPolled.end() ||
+                polled->second.scanner != subtree.second) {
+                continue;
+            }
+            polled->second.state = PolledSubtree::POLLING;
+            if (!polled->second.demoted) {
+                continue;
+            }
+            polled->second.demoted = false;
+
+            // a subscription below the subtree might have come up meanwhile
+            InotifyNode *node = mTree->findNode(subtree.first);
+            if (isNeededBySubscription(subtree.first)) {
+                mPolled.erase(polled);
+            } else if (node != NULL && node->getParent() != NULL) {
+                node->getParent()->removeChild(node->getName());
+            }
+        }
+        mPollingCondition.notify_all();
+    }
+
+    // the snapshots another thread is taking are awaited as well
+    mPollingCondition.wait(
+        lock, [this]() { return !hasPolling(PolledSubtree::STARTING); });
+}
+
+bool InotifyWatchRegistry::hasPolling(PolledSubtree::State state)
+{
+    return std::any_of(mPolled.begin(), mPolled.end(),
+                       [state](const std::pair<const std::filesystem::path,
+                                               PolledSubtree> &polled) {
+                           return polled.second.state == state;
+                       });
+}
+
+void InotifyWatchRegistry::stopPolling(const std::filesystem::path &path)
+{
+    for (auto polled = mPolled.lower_bound(path);
+         polled != mPolled.end() && Filter::isSubPath(path, polled->first);) {
+        polled = mPolled.erase(polled);
+    }
+}
+
+void InotifyWatchRegistry::prunePolling()
+{
+    for (auto polled = mPolled.begin(); polled != mPolled.end();) {
+        if (mTree->findNode(polled->first.parent_path()) == NULL ||
+            !isWatched(polled->first)) {
+            polled = mPolled.erase(polled);
+        } else {
+            ++polled;
+        }
+    }
+}
+
+void InotifyWatchRegistry::pollingLoop()
+{
+    using Scan = std::pair<std::shared_ptr<PollingScanner>,
+                           std::vector<PollingScanner::Change>>;
+
+    std::unique_lock<std::recursive_mutex> lock(mMutex);
+    while (!mStopPolling) {
+        mPollingCondition.wait_for(lock, mPollingInterval, [this]() {
+            return mStopPolling || hasPolling(PolledSubtree::PENDING);
+        });
+        if (mStopPolling) {
+            break;
+        }
+
+        // subtrees which started being polled from the event loop
+        if (hasPolling(PolledSubtree::PENDING)) {
+            lock.unlock();
+            startPendingPolling();
+            lock.lock();
+        }
+
+        std::vector<Scan> scans;
+        for (const auto &polled : mPolled) {
+            if (polled.second.state == PolledSubtree::POLLING) {
+                scans.emplace_back(polled.second.scanner,
+                                   std::vector<PollingScanner::Change>());
+            }
+        }
+
+        // the file system is scanned without blocking the event loop
+        lock.unlock();
+        for (auto &scan : scans) {
+            scan.second = scan.first->scan();
+        }
+        lock.lock();
+
+        ServiceEvents                      events;
+        std::vector<std::filesystem::path> busy;
+        for (const auto &scan : scans) {
+            const auto &root   = scan.first->root();
+            auto        polled = mPolled.find(root);
+            if (polled == mPolled.end() ||
+                polled->second.scanner != scan.first) {
+                continue;
+            }
+
+            for (const auto &change : scan.second) {
+                collect(events, change.type, root / change.relativePath);
+            }
+
+            if (scan.second.empty()) {
+                polled->second.busyScans = 0;
+            } else if (!polled->second.remote &&
+                       ++polled->second.busyScans >= PROMOTION_SCANS) {
+                busy.push_back(root);
+            }
+        }
+        deliver(events);
+        if (busy.empty()) {
+            continue;
+        }
+
+        // the idle subtrees demoted in exchange keep their watches until
+        // their snapshot is taken
+        for (const auto &path : busy) {
+            makeRoomFor(path);
+        }
+        lock.unlock();
+        startPendingPolling();
+        lock.lock();
+
+        for (const auto &path : busy) {
+            promote(path);
+        }
+    }
+}
@@ -135,3 +135,22 @@ bool FSEventsService::isWatching()
 {
     return mRunLoop != NULL && mRunLoop->isLooping();
 }
+
+void FSEventsService::applyFilterOptions(const FilterOptions &previous)
+{
+    // an FSEvents stream always observes the whole tree, so the Filter drops
+    // the events of excluded subtrees on its own
+}
+
+bool FSEventsService::addRoot(const std::filesystem::path &path)
+{
+    sendError("Multiple roots are not supported on this platform.");
+    return false;
+}
+
+bool FSEventsService::removeRoot(const std::filesystem::path &path)
+{
+    return false;
+}
+
+std::vector<std::filesystem::path> FSEventsService::roots() { return {mPath}; }
@@ -0,0 +1,166 @@
+#include "pfw/polling/PollingService.h"
+
+#include "pfw/MountTable.h"
+
+using namespace pfw;
+
+namespace {
+
+std::filesystem::path normalize(const std::filesystem::path &path)
+{
+    std::error_code ec;
+    auto            result = std::filesystem::absolute(path, ec);
+    if (ec) {
+        result = path;
+    }
+
+    result = result.lexically_normal();
+    if (!result.has_filename() && result.has_relative_path()) {
+        result = result.parent_path();
+    }
+    return result;
+}
+
+}  // namespace
+
+PollingService::PollingService(std::shared_ptr<Filter>         filter,
+                               const std::filesystem::path &   path,
+                               const std::chrono::milliseconds latency)
+    : mFilter(filter)
+    , mInterval(latency)
+    , mStopped(false)
+{
+    if (!path.empty()) {
+        addRoot(path);
+    }
+
+    mThread = std::thread(&PollingService::work, this);
+}
+
+PollingService::~PollingService()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopped = true;
+    }
+    mCondition.notify_all();
+    mThread.join();
+}
+
+bool PollingService::isWatching()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return !mStopped && !mScanners.empty();
+}
+
+void PollingService::applyFilterOptions(const FilterOptions &)
+{
+    // the snapshots are retaken with the new filter, so newly included
+    // subtrees are not reported as created
+    std::lock_guard<std::mutex> scanLock(mScanMutex);
+    for (const auto &root : roots()) {
+        std::shared_ptr<PollingScanner> scanner;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto                        itr = mScanners.find(root);
+            if (itr == mScanners.end()) {
+                continue;
+            }
+            scanner = itr->second;
+        }
+        scanner->reset();
+    }
+}
+
+bool PollingService::addRoot(const std::filesystem::path &path)
+{
+    const auto      root = normalize(path);
+    std::error_code ec;
+    if (!std::filesystem::is_directory(root, ec)) {
+        mFilter->sendError("Failed to open directory.", root);
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mScanners.find(root) != mScanners.end()) {
+            return true;
+        }
+    }
+
+    auto filter  = mFilter;
+    auto mounts  = std::make_shared<const MountTable>(MountTable::current());
+    auto scanner = std::make_shared<PollingScanner>(
+        root, std::thread::hardware_concurrency(),
+        [filter, mounts, root](const std::filesystem::path &relativePath) {
+            return filter->isWatched(relativePath) &&
+                   !mounts->isSkipped(root, root / relativePath,
+                                      filter->isOneFileSystem());
+        });
+
+    std::lock_guard<std::mutex> scanLock(mScanMutex);
+    scanner->reset();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mScanners[root] = scanner;
+    return true;
+}
+
+bool PollingService::removeRoot(const std::filesystem::path &path)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mScanners.erase(normalize(path)) > 0;
+}
+
+std::vector<std::filesystem::path> PollingService::roots()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    std::vector<std::filesystem::path> result;
+    for (const auto &scanner : mScanners) {
+        result.push_back(scanner.first);
+    }
+    return result;
+}
+
+void PollingService::work()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (!mStopped) {
+        mCondition.wait_for(lock, mInterval, [this]() { return mStopped; });
+        if (mStopped) {
+            break;
+        }
+
+        auto scanners = mScanners;
+        lock.unlock();
+
+        std::vector<EventPtr>              events;
+        std::vector<std::filesystem::path> lost;
+        {
+            std::lock_guard<std::mutex> scanLock(mScanMutex);
+            for (const auto &scanner : scanners) {
+                for (const auto &change : scanner.second->scan()) {
+                    events.emplace_back(std::make_unique<Event>(
+                        change.type, change.relativePath, scanner.first));
+                }
+
+                std::error_code ec;
+                if (!std::filesystem::is_directory(scanner.first, ec)) {
+                    lost.push_back(scanner.first);
+                }
+            }
+        }
+
+        if (!events.empty()) {
+            mFilter->filterAndNotify(std::move(events));
+        }
+
+        lock.lock();
+        for (const auto &root : lost) {
+            if (mScanners.erase(root) > 0) {
+                mFilter->sendError("Service shutdown unexpectedly.", root);
+            }
+        }
+    }
+}
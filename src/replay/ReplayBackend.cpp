@@ -0,0 +1,70 @@
+#include "pfw/replay/ReplayBackend.h"
+
+#include <algorithm>
+
+using namespace pfw;
+
+ReplayBackend::ReplayBackend(std::shared_ptr<Filter>      filter,
+                             const std::filesystem::path &path,
+                             const std::chrono::milliseconds)
+    : mFilter(filter)
+{
+    if (!path.empty()) {
+        addRoot(path);
+    }
+}
+
+bool ReplayBackend::isWatching()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return !mRoots.empty();
+}
+
+void ReplayBackend::applyFilterOptions(const FilterOptions &)
+{
+    // the Filter drops the events of excluded paths
+}
+
+bool ReplayBackend::addRoot(const std::filesystem::path &path)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (std::find(mRoots.begin(), mRoots.end(), path) == mRoots.end()) {
+        mRoots.push_back(path);
+    }
+    return true;
+}
+
+bool ReplayBackend::removeRoot(const std::filesystem::path &path)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto root = std::find(mRoots.begin(), mRoots.end(), path);
+    if (root == mRoots.end()) {
+        return false;
+    }
+    mRoots.erase(root);
+    return true;
+}
+
+std::vector<std::filesystem::path> ReplayBackend::roots()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mRoots;
+}
+
+void ReplayBackend::replay(std::vector<EventPtr> &&events)
+{
+    const auto roots = this->roots();
+    for (auto &event : events) {
+        if (event->root.empty() && !roots.empty()) {
+            event->root = roots.front();
+        }
+    }
+    mFilter->filterAndNotify(std::move(events));
+}
+
+void ReplayBackend::sendError(const std::string &          errorMsg,
+                              const std::filesystem::path &root)
+{
+    mFilter->sendError(errorMsg, root);
+}
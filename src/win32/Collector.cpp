@@ -1,6 +1,6 @@
 #include "pfw/win32/Collector.h"
 
-#include <map>
+#include <thread>
 
 using namespace pfw;
 
@@ -36,26 +36,6 @@ void Collector::sendEvents()
         std::swap(_inputVector, result);
     }
 
-    // remove duplicates
-    std::map<fs::path, std::vector<EventPtr>::reverse_iterator> values;
-    for (auto itr = result.rbegin(); itr != result.rend(); ++itr) {
-        auto result = values.emplace((*itr)->relativePath, itr);
-
-        if (result.second) {
-            continue;
-        }
-
-        EventPtr &event           = *itr;
-        EventPtr &conflictedEvent = *result.first->second;
-        conflictedEvent->type     = conflictedEvent->type | event->type;
-
-        event.reset(nullptr);
-    }
-
-    result.erase(std::remove_if(result.begin(), result.end(),
-                                [&](const EventPtr &value) { return !value; }),
-                 result.end());
-
     _filter->filterAndNotify(std::move(result));
 }
 
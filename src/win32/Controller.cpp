@@ -17,6 +17,7 @@ Controller::Controller(FilterPtr                       filter,
     : mDirectoryHandle(INVALID_HANDLE_VALUE)
     , mWatcher(nullptr)
     , mCollector(std::make_shared<Collector>(filter, latency))
+    , mPath(path)
 {
     mDirectoryHandle = openDirectory(path);
 
@@ -40,3 +41,19 @@ bool Controller::isWatching()
 {
     return (bool)mWatcher && mWatcher->isRunning();
 }
+
+void Controller::applyFilterOptions(const FilterOptions &previous)
+{
+    // ReadDirectoryChangesW always observes the whole tree, so the Filter
+    // drops the events of excluded subtrees on its own
+}
+
+bool Controller::addRoot(const fs::path &path)
+{
+    mCollector->sendError("Multiple roots are not supported on this platform.");
+    return false;
+}
+
+bool Controller::removeRoot(const fs::path &path) { return false; }
+
+std::vector<fs::path> Controller::roots() { return {mPath}; }
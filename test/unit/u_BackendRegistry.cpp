@@ -0,0 +1,147 @@
+#include "catch_wrapper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "pfw/BackendRegistry.h"
+#include "pfw/FileSystemWatcher.h"
+#include "pfw/internal/definitions.h"
+#include "pfw/replay/ReplayBackend.h"
+
+#if defined(PFW_LINUX) && !defined(PFW_USE_POLLING)
+#include "pfw/linux/FanotifyService.h"
+#endif
+
+#include "testutil/FileSandbox.h"
+
+using namespace std::chrono_literals;
+using namespace pfw;
+
+TEST_CASE("test the backend registry", "[BackendRegistry]")
+{
+    auto &registry = BackendRegistry::instance();
+
+    SECTION("the default backends are registered")
+    {
+        CHECK(registry.contains(BackendRegistry::POLLING));
+        CHECK(registry.contains(BackendRegistry::REPLAY));
+        CHECK(registry.contains(registry.resolve(BackendRegistry::NATIVE, {})));
+        CHECK(!registry.contains("unknown"));
+    }
+
+    SECTION("a local directory is watched natively")
+    {
+        FileSandbox sandbox;
+        CHECK(registry.resolve(BackendRegistry::AUTO, sandbox.path()) ==
+              registry.resolve(BackendRegistry::NATIVE, sandbox.path()));
+        CHECK(registry.resolve(BackendRegistry::POLLING, sandbox.path()) ==
+              BackendRegistry::POLLING);
+    }
+
+    SECTION("events are replayed through the filter")
+    {
+        FileSandbox sandbox;
+
+        std::mutex            eventsMutex;
+        std::vector<EventPtr> events;
+        FileSystemWatcher     watcher(
+            sandbox.path(), 10ms,
+            [&](std::vector<EventPtr> &&batch) {
+                std::lock_guard<std::mutex> lock(eventsMutex);
+                for (auto &event : batch) {
+                    events.emplace_back(std::move(event));
+                }
+            },
+            WatcherOptions(FilterOptions{{}, {"excluded"}},
+                           BackendRegistry::REPLAY));
+
+        auto *backend = dynamic_cast<ReplayBackend *>(watcher.backend());
+        REQUIRE(backend != nullptr);
+        CHECK(watcher.isWatching());
+
+        std::vector<EventPtr> replayed;
+        replayed.emplace_back(std::make_unique<Event>(CREATED, "file"));
+        replayed.emplace_back(std::make_unique<Event>(CREATED, "excluded/file"));
+        backend->replay(std::move(replayed));
+
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        REQUIRE(events.size() == 1);
+        CHECK(events[0]->type == CREATED);
+        CHECK(events[0]->relativePath == "file");
+        CHECK(events[0]->root == sandbox.path());
+    }
+
+    SECTION("an unknown backend falls back to the native one")
+    {
+        FileSandbox sandbox;
+
+        std::mutex            eventsMutex;
+        std::vector<EventPtr> events;
+        FileSystemWatcher     watcher(
+            sandbox.path(), 10ms,
+            [&](std::vector<EventPtr> &&batch) {
+                std::lock_guard<std::mutex> lock(eventsMutex);
+                for (auto &event : batch) {
+                    events.emplace_back(std::move(event));
+                }
+            },
+            WatcherOptions({}, "unknown"));
+
+        CHECK(watcher.isWatching());
+        CHECK(dynamic_cast<ReplayBackend *>(watcher.backend()) == nullptr);
+
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        REQUIRE(!events.empty());
+        CHECK(failed(events[0]->type));
+    }
+
+#if defined(PFW_LINUX) && !defined(PFW_USE_POLLING)
+    SECTION("fanotify reports changes or falls back to inotify")
+    {
+        FileSandbox sandbox;
+
+        std::mutex            eventsMutex;
+        std::vector<EventPtr> events;
+        FileSystemWatcher     watcher(
+            sandbox.path(), 10ms,
+            [&](std::vector<EventPtr> &&batch) {
+                std::lock_guard<std::mutex> lock(eventsMutex);
+                for (auto &event : batch) {
+                    events.emplace_back(std::move(event));
+                }
+            },
+            WatcherOptions({}, BackendRegistry::FANOTIFY));
+        REQUIRE(watcher.isWatching());
+        INFO("fanotify in use: "
+             << (dynamic_cast<FanotifyService *>(watcher.backend()) != nullptr));
+
+        sandbox.createDirectory("dir");
+        std::this_thread::sleep_for(100ms);
+        sandbox.createFile("dir/file");
+        std::this_thread::sleep_for(100ms);
+        sandbox.rename("dir/file", "renamed");
+        std::this_thread::sleep_for(200ms);
+
+        std::lock_guard<std::mutex> lock(eventsMutex);
+
+        auto find = [&](EventType type, const fs::path &path) {
+            return std::find_if(events.begin(), events.end(),
+                                [&](const EventPtr &event) {
+                                    return event->type == type &&
+                                           event->relativePath == path;
+                                });
+        };
+        CHECK(find(CREATED, "dir") != events.end());
+        CHECK(find(CREATED, "dir/file") != events.end());
+
+        auto from = find(DELETED | RENAMED, "dir/file");
+        REQUIRE(from != events.end());
+        REQUIRE(std::next(from) != events.end());
+        CHECK((*std::next(from))->type == (CREATED | RENAMED));
+        CHECK((*std::next(from))->relativePath == "renamed");
+    }
+#endif
+}
@@ -0,0 +1,185 @@
+#include "catch_wrapper.h"
+
+#include <chrono>
+#include <mutex>
+#include <type_traits>
+
+#include "pfw/FileSystemWatcher.h"
+#include "pfw/replay/ReplayBackend.h"
+
+#include "testutil/FileSandbox.h"
+
+using namespace std::chrono_literals;
+using namespace pfw;
+
+namespace {
+
+std::vector<EventPtr> events(EventType type, std::vector<fs::path> paths)
+{
+    std::vector<EventPtr> result;
+    for (const auto &path : paths) {
+        result.emplace_back(std::make_unique<Event>(type, path));
+    }
+    return result;
+}
+
+void replay(NativeInterface &watcher, std::vector<EventPtr> &&events)
+{
+    auto *backend = dynamic_cast<pfw::ReplayBackend *>(watcher.backend());
+    REQUIRE(backend != nullptr);
+    backend->replay(std::move(events));
+}
+
+// a handler which is not wrapped into a std::function
+struct Recorder {
+    std::mutex            *mutex;
+    std::vector<EventPtr> *received;
+    size_t                *calls;
+
+    template <class Batch>
+    void operator()(Batch &&batch)
+    {
+        std::lock_guard<std::mutex> lock(*mutex);
+        ++*calls;
+        for (auto &event : batch) {
+            received->emplace_back(std::move(event));
+        }
+    }
+};
+
+template <class T>
+struct CountingAllocator {
+    using value_type = T;
+
+    static size_t allocations;
+
+    CountingAllocator() = default;
+    template <class U>
+    CountingAllocator(const CountingAllocator<U> &)
+    {
+    }
+
+    T *allocate(size_t n)
+    {
+        ++allocations;
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T *p, size_t n) { std::allocator<T>().deallocate(p, n); }
+
+    template <class U>
+    bool operator==(const CountingAllocator<U> &) const
+    {
+        return true;
+    }
+    template <class U>
+    bool operator!=(const CountingAllocator<U> &) const
+    {
+        return false;
+    }
+};
+template <class T>
+size_t CountingAllocator<T>::allocations = 0;
+
+}  // namespace
+
+TEST_CASE("test the policy based watcher", "[BasicFileSystemWatcher]")
+{
+    static_assert(std::is_base_of<BasicFileSystemWatcher<>,
+                                  FileSystemWatcher>::value,
+                  "FileSystemWatcher is the default instantiation");
+
+    FileSandbox           sandbox;
+    std::mutex            mutex;
+    std::vector<EventPtr> received;
+    size_t                calls = 0;
+    const Recorder        recorder{&mutex, &received, &calls};
+
+    SECTION("the coalescers rewrite the batch")
+    {
+        using Watcher = BasicFileSystemWatcher<
+            policy::ReplayBackend,
+            policy::Coalescing<policy::PathCoalescing,
+                               policy::StormSummarizing<3>>,
+            policy::InlineDispatch, std::allocator<EventPtr>, Recorder>;
+        Watcher watcher(sandbox.path(), 10ms, recorder);
+
+        auto batch = events(CREATED, {"a", "b"});
+        batch.emplace_back(std::make_unique<Event>(MODIFIED, "a"));
+        replay(watcher, std::move(batch));
+
+        REQUIRE(received.size() == 2);
+        CHECK(received[0]->relativePath == "b");
+        CHECK(received[1]->relativePath == "a");
+        CHECK(received[1]->type == (CREATED | MODIFIED));
+
+        received.clear();
+        replay(watcher, events(CREATED, {"dir/a", "dir/b", "dir/c", "dir/d"}));
+        REQUIRE(received.size() == 1);
+        CHECK(subtree(received[0]->type));
+        CHECK(received[0]->relativePath == "dir");
+    }
+
+    SECTION("the handler receives the batches of the allocator")
+    {
+        using Allocator = CountingAllocator<EventPtr>;
+        using Watcher =
+            BasicFileSystemWatcher<policy::ReplayBackend, policy::NoCoalescing,
+                                   policy::InlineDispatch, Allocator, Recorder>;
+        Watcher watcher(sandbox.path(), 10ms, recorder);
+
+        const auto before = Allocator::allocations;
+        replay(watcher, events(CREATED, {"a", "b"}));
+        replay(watcher, events(CREATED, {"c"}));
+        CHECK(received.size() == 3);
+        // the buffer of the first batch is reused for the second one
+        CHECK(Allocator::allocations - before == 1);
+    }
+
+    SECTION("the handler is invoked in parallel")
+    {
+        using Watcher =
+            BasicFileSystemWatcher<policy::ReplayBackend, policy::NoCoalescing,
+                                   policy::ParallelDispatch<4>,
+                                   std::allocator<EventPtr>, Recorder>;
+        Watcher watcher(sandbox.path(), 10ms, recorder);
+
+        std::vector<fs::path> paths;
+        for (int i = 0; i < 32; ++i) {
+            paths.push_back("file" + std::to_string(i));
+        }
+        replay(watcher, events(CREATED, paths));
+
+        std::lock_guard<std::mutex> lock(mutex);
+        CHECK(received.size() == 32);
+        CHECK(calls > 1);
+    }
+
+    SECTION("the stages are not invoked concurrently")
+    {
+        using Watcher = BasicFileSystemWatcher<
+            policy::ReplayBackend, policy::PathCoalescing,
+            policy::InlineDispatch, std::allocator<EventPtr>, Recorder>;
+        WatcherOptions options;
+        options.dispatchConcurrency = 4;
+        Watcher watcher(sandbox.path(), 10ms, recorder, options);
+
+        std::vector<fs::path> paths;
+        for (int i = 0; i < 32; ++i) {
+            paths.push_back("file" + std::to_string(i % 16));
+        }
+        replay(watcher, events(CREATED, paths));
+
+        std::lock_guard<std::mutex> lock(mutex);
+        CHECK(received.size() == 16);
+        CHECK(calls == 1);
+    }
+
+    SECTION("an explicit backend takes precedence over the policy")
+    {
+        WatcherOptions options;
+        options.backend = BackendRegistry::REPLAY;
+        BasicFileSystemWatcher<policy::PollingBackend> watcher(
+            sandbox.path(), 10ms, [](std::vector<EventPtr> &&) {}, options);
+        CHECK(dynamic_cast<pfw::ReplayBackend *>(watcher.backend()) != nullptr);
+    }
+}
@@ -0,0 +1,142 @@
+#include "catch_wrapper.h"
+
+#include <chrono>
+
+#include "pfw/ChangeIndex.h"
+#include "pfw/FileSystemWatcher.h"
+#include "pfw/replay/ReplayBackend.h"
+
+#include "testutil/FileSandbox.h"
+
+using namespace std::chrono_literals;
+using namespace pfw;
+
+namespace {
+
+std::vector<EventPtr> events(EventType type, std::vector<fs::path> paths)
+{
+    std::vector<EventPtr> result;
+    for (const auto &path : paths) {
+        result.emplace_back(std::make_unique<Event>(type, path, "/root"));
+    }
+    return result;
+}
+
+std::vector<fs::path> paths(const Changes &changes)
+{
+    std::vector<fs::path> result;
+    for (const auto &event : changes.events) {
+        result.push_back(event->relativePath);
+    }
+    return result;
+}
+
+}  // namespace
+
+TEST_CASE("test the change index", "[ChangeIndex]")
+{
+    ChangeIndex index(4);
+
+    SECTION("an unknown token is answered with a fresh instance")
+    {
+        index.add(events(CREATED, {"a"}));
+
+        auto changes = index.changesSince(ChangeToken());
+        CHECK(changes.isFreshInstance);
+        CHECK(paths(changes) == std::vector<fs::path>{"a"});
+
+        ChangeIndex other(4);
+        CHECK(other.changesSince(changes.token).isFreshInstance);
+    }
+
+    SECTION("the changes since a token are deduplicated")
+    {
+        const auto token = index.token();
+        index.add(events(CREATED, {"a", "b"}));
+        index.add(events(MODIFIED, {"a"}));
+
+        auto changes = index.changesSince(token);
+        CHECK(!changes.isFreshInstance);
+        REQUIRE(paths(changes) == std::vector<fs::path>{"b", "a"});
+        CHECK(changes.events[1]->type == (CREATED | MODIFIED));
+        CHECK(changes.events[1]->root == "/root");
+
+        index.add(events(DELETED, {"b"}));
+        changes = index.changesSince(changes.token);
+        CHECK(!changes.isFreshInstance);
+        REQUIRE(paths(changes) == std::vector<fs::path>{"b"});
+        CHECK(changes.events[0]->type == DELETED);
+
+        changes = index.changesSince(changes.token);
+        CHECK(!changes.isFreshInstance);
+        CHECK(changes.events.empty());
+    }
+
+    SECTION("only the types since the token are reported")
+    {
+        index.add(events(CREATED, {"a"}));
+        const auto token = index.token();
+        index.add(events(MODIFIED, {"a"}));
+        index.add(events(MODIFIED, {"a"}));
+
+        auto changes = index.changesSince(token);
+        REQUIRE(changes.events.size() == 1);
+        CHECK(changes.events[0]->type == MODIFIED);
+
+        index.add(events(DELETED, {"a"}));
+        changes = index.changesSince(token);
+        REQUIRE(changes.events.size() == 1);
+        CHECK(changes.events[0]->type == (MODIFIED | DELETED));
+    }
+
+    SECTION("a token older than the retained paths is too old")
+    {
+        const auto token = index.token();
+        index.add(events(CREATED, {"a"}));
+        const auto second = index.token();
+        index.add(events(CREATED, {"b", "c", "d", "e"}));
+
+        CHECK(index.changesSince(token).isFreshInstance);
+
+        auto changes = index.changesSince(second);
+        CHECK(!changes.isFreshInstance);
+        CHECK(paths(changes) == std::vector<fs::path>{"b", "c", "d", "e"});
+    }
+
+    SECTION("an overflow invalidates every earlier token")
+    {
+        const auto token = index.token();
+        index.add(events(CREATED, {"a"}));
+
+        std::vector<EventPtr> overflow;
+        overflow.emplace_back(std::make_unique<Event>(BUFFER_OVERFLOW, ""));
+        index.add(overflow);
+        const auto afterOverflow = index.token();
+        index.add(events(CREATED, {"b"}));
+
+        auto changes = index.changesSince(token);
+        CHECK(changes.isFreshInstance);
+        CHECK(paths(changes) == std::vector<fs::path>{"b"});
+        CHECK(!index.changesSince(afterOverflow).isFreshInstance);
+    }
+
+    SECTION("the watcher records the delivered events")
+    {
+        FileSandbox    sandbox;
+        WatcherOptions options({}, BackendRegistry::REPLAY);
+        options.changeIndexSize = 16;
+
+        FileSystemWatcher watcher(
+            sandbox.path(), 10ms, [](std::vector<EventPtr> &&) {}, options);
+        const auto token = watcher.changeToken();
+
+        auto *backend = dynamic_cast<ReplayBackend *>(watcher.backend());
+        REQUIRE(backend != nullptr);
+        backend->replay(events(CREATED, {"a", "b"}));
+        backend->replay(events(MODIFIED, {"a"}));
+
+        auto changes = watcher.changesSince(token);
+        CHECK(!changes.isFreshInstance);
+        CHECK(paths(changes) == std::vector<fs::path>{"b", "a"});
+    }
+}
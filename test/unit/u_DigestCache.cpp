@@ -0,0 +1,161 @@
+#include "catch_wrapper.h"
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "pfw/DigestCache.h"
+#include "pfw/FileSystemWatcher.h"
+#include "pfw/internal/definitions.h"
+#include "pfw/replay/ReplayBackend.h"
+
+#include "testutil/FileSandbox.h"
+
+using namespace std::chrono_literals;
+using namespace pfw;
+
+namespace {
+
+std::vector<EventPtr> event(EventType type, const fs::path &relativePath,
+                            const fs::path &root)
+{
+    std::vector<EventPtr> events;
+    events.emplace_back(std::make_unique<Event>(type, relativePath, root));
+    return events;
+}
+
+}  // namespace
+
+TEST_CASE("test the digest cache", "[DigestCache]")
+{
+    SECTION("the digest is XXH64")
+    {
+        CHECK(DigestCache::hash("", 0) == 0xEF46DB3751D8E999ULL);
+        CHECK(DigestCache::hash("abc", 3) == 0x44BC2CF5AD770999ULL);
+
+        // the streaming hash does not depend on the chunking
+        FileSandbox sandbox;
+        const auto  content = FileSandbox::generateRandomData(100000);
+        sandbox.createFile("file", content);
+
+        uint64_t digest = 0;
+        REQUIRE(DigestCache::hashFile(sandbox.path() / "file", digest));
+        CHECK(digest == DigestCache::hash(content.data(), content.size()));
+    }
+
+    FileSandbox sandbox;
+    sandbox.createFile("file", std::string("content"));
+    DigestCache cache(2);
+
+    SECTION("modifications without a content change are dropped")
+    {
+        auto events = event(CREATED, "file", sandbox.path());
+        cache.apply(events);
+        REQUIRE(events.size() == 1);
+        REQUIRE(events[0]->digest);
+        const auto digest = *events[0]->digest;
+
+        // rewriting the same content
+        sandbox.modifyFile("file", "content");
+        events = event(MODIFIED, "file", sandbox.path());
+        cache.apply(events);
+        CHECK(events.empty());
+
+        sandbox.modifyFile("file", "changed");
+        events = event(MODIFIED, "file", sandbox.path());
+        cache.apply(events);
+        REQUIRE(events.size() == 1);
+        CHECK(*events[0]->digest != digest);
+    }
+
+    SECTION("the first modification of a file is delivered")
+    {
+        auto events = event(MODIFIED, "file", sandbox.path());
+        cache.apply(events);
+        CHECK(events.size() == 1);
+
+        sandbox.remove("file");
+        events = event(DELETED, "file", sandbox.path());
+        cache.apply(events);
+        CHECK(events.size() == 1);
+        CHECK(!events[0]->digest);
+
+        sandbox.createFile("file", std::string("content"));
+        events = event(MODIFIED, "file", sandbox.path());
+        cache.apply(events);
+        CHECK(events.size() == 1);
+    }
+
+    SECTION("files beyond the hash budget are delivered without a digest")
+    {
+        DigestCache limited(2, 1 << 20, 4);
+
+        auto events = event(CREATED, "file", sandbox.path());
+        limited.apply(events);
+        REQUIRE(events.size() == 1);
+        CHECK(!events[0]->digest);
+
+        sandbox.modifyFile("file", "content");
+        events = event(MODIFIED, "file", sandbox.path());
+        limited.apply(events);
+        REQUIRE(events.size() == 1);
+        CHECK(!events[0]->digest);
+    }
+
+    SECTION("a backend without a collector drops a touch as well")
+    {
+        size_t delivered = 0;
+
+        WatcherOptions options({}, BackendRegistry::REPLAY);
+        options.digestContents = true;
+
+        FileSystemWatcher watcher(
+            sandbox.path(), 10ms,
+            [&](std::vector<EventPtr> &&batch) { delivered += batch.size(); },
+            options);
+        auto *backend = dynamic_cast<ReplayBackend *>(watcher.backend());
+        REQUIRE(backend != nullptr);
+
+        backend->replay(event(MODIFIED, "file", fs::path()));
+        backend->replay(event(MODIFIED, "file", fs::path()));
+        CHECK(delivered == 1);
+    }
+
+#if !defined(PFW_USE_POLLING) && !defined(PFW_APPLE)
+    SECTION("the collector drops a touch and a chmod")
+    {
+        std::mutex            eventsMutex;
+        std::vector<EventPtr> events;
+
+        WatcherOptions options;
+        options.digestContents = true;
+
+        FileSystemWatcher watcher(
+            sandbox.path(), 10ms,
+            [&](std::vector<EventPtr> &&batch) {
+                std::lock_guard<std::mutex> lock(eventsMutex);
+                for (auto &event : batch) {
+                    events.emplace_back(std::move(event));
+                }
+            },
+            options);
+
+        sandbox.modifyFile("file", "changed");
+        std::this_thread::sleep_for(200ms);
+        fs::last_write_time(sandbox.path() / "file",
+                            fs::file_time_type::clock::now());
+        fs::permissions(sandbox.path() / "file", fs::perms::owner_exec,
+                        fs::perm_options::add);
+        std::this_thread::sleep_for(200ms);
+        sandbox.modifyFile("file", "changed again");
+        std::this_thread::sleep_for(200ms);
+
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        REQUIRE(events.size() == 2);
+        CHECK(events[0]->type == MODIFIED);
+        CHECK(events[1]->type == MODIFIED);
+        CHECK(events[0]->digest != events[1]->digest);
+    }
+#endif
+}
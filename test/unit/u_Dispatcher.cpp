@@ -0,0 +1,150 @@
+#include "catch_wrapper.h"
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "pfw/Dispatcher.h"
+#include "pfw/FileSystemWatcher.h"
+#include "pfw/replay/ReplayBackend.h"
+
+#include "testutil/FileSandbox.h"
+
+using namespace std::chrono_literals;
+using namespace pfw;
+
+namespace {
+
+// every path is repeated, its sequence numbers tell the original order
+std::vector<EventPtr> events(size_t paths, size_t repetitions)
+{
+    std::vector<EventPtr> result;
+    for (size_t r = 0; r < repetitions; ++r) {
+        for (size_t p = 0; p < paths; ++p) {
+            const auto directory = "dir" + std::to_string(p % 8);
+            const auto file      = "file" + std::to_string(p);
+            result.emplace_back(
+                std::make_unique<Event>(MODIFIED, fs::path(directory) / file,
+                                        "/root"));
+            result.back()->sequence = r;
+        }
+    }
+    return result;
+}
+
+}  // namespace
+
+TEST_CASE("test the dispatcher", "[Dispatcher]")
+{
+    SECTION("the shards are chosen by path or top level directory")
+    {
+        const Event first(CREATED, "src/main.cpp", "/root");
+        const Event second(MODIFIED, "src/main.cpp", "/root");
+        const Event sibling(CREATED, "src/linux/inotify.cpp", "/root");
+
+        CHECK(Dispatcher::shard(first, Dispatcher::BY_PATH, 8) ==
+              Dispatcher::shard(second, Dispatcher::BY_PATH, 8));
+        CHECK(Dispatcher::shard(first, Dispatcher::BY_TOP_LEVEL_DIRECTORY,
+                                8) ==
+              Dispatcher::shard(sibling, Dispatcher::BY_TOP_LEVEL_DIRECTORY,
+                                8));
+        CHECK(Dispatcher::shard(first, Dispatcher::BY_PATH, 1) == 0);
+    }
+
+    SECTION("the order of each path is kept")
+    {
+        for (const auto partition :
+             {Dispatcher::BY_PATH, Dispatcher::BY_TOP_LEVEL_DIRECTORY}) {
+            Dispatcher dispatcher(4, partition);
+
+            std::mutex                   receivedMutex;
+            std::map<fs::path, uint64_t> next;
+            std::set<std::thread::id>    threads;
+            size_t                       received  = 0;
+            bool                         isOrdered = true;
+
+            auto callback = [&](std::vector<EventPtr> &&shard) {
+                std::this_thread::sleep_for(10ms);
+                std::lock_guard<std::mutex> lock(receivedMutex);
+                threads.insert(std::this_thread::get_id());
+                for (const auto &event : shard) {
+                    isOrdered &= next[event->relativePath]++ == event->sequence;
+                    ++received;
+                }
+            };
+            dispatcher.dispatch(events(40, 5), callback);
+
+            CHECK(received == 200);
+            CHECK(isOrdered);
+            CHECK(threads.size() > 1);
+        }
+    }
+
+    SECTION("the paths of a rename share a shard")
+    {
+        Dispatcher dispatcher(8);
+
+        std::vector<EventPtr> batch;
+        auto add = [&](EventType type, const fs::path &relativePath) {
+            batch.push_back(
+                std::make_unique<Event>(type, relativePath, "/root"));
+            return batch.back().get();
+        };
+        for (int i = 0; i < 20; ++i) {
+            const auto n = std::to_string(i);
+            add(DELETED | RENAMED, "from" + n);
+            add(CREATED | RENAMED, "to" + n);
+            add(RENAMED, "moved" + n)->previousPath = "source" + n;
+            add(CREATED, "source" + n);
+        }
+
+        std::mutex                 receivedMutex;
+        std::map<fs::path, size_t> shards;
+        size_t                     shardCount = 0;
+
+        auto callback = [&](std::vector<EventPtr> &&shard) {
+            std::lock_guard<std::mutex> lock(receivedMutex);
+            for (const auto &event : shard) {
+                shards[event->relativePath] = shardCount;
+            }
+            ++shardCount;
+        };
+        dispatcher.dispatch(std::move(batch), callback);
+
+        CHECK(shardCount > 1);
+        for (int i = 0; i < 20; ++i) {
+            const auto n = std::to_string(i);
+            CHECK(shards["from" + n] == shards["to" + n]);
+            CHECK(shards["moved" + n] == shards["source" + n]);
+        }
+    }
+
+    SECTION("the watcher invokes the callback in parallel")
+    {
+        FileSandbox    sandbox;
+        WatcherOptions options({}, BackendRegistry::REPLAY);
+        options.dispatchConcurrency = 4;
+
+        std::mutex        receivedMutex;
+        size_t            batches  = 0;
+        size_t            received = 0;
+        FileSystemWatcher watcher(
+            sandbox.path(), 10ms,
+            [&](std::vector<EventPtr> &&shard) {
+                std::lock_guard<std::mutex> lock(receivedMutex);
+                ++batches;
+                received += shard.size();
+            },
+            options);
+
+        auto *backend = dynamic_cast<ReplayBackend *>(watcher.backend());
+        REQUIRE(backend != nullptr);
+        backend->replay(events(40, 1));
+
+        std::lock_guard<std::mutex> lock(receivedMutex);
+        CHECK(received == 40);
+        CHECK(batches > 1);
+    }
+}
@@ -0,0 +1,256 @@
+#include "catch_wrapper.h"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "pfw/EventJournal.h"
+#include "pfw/FileSystemWatcher.h"
+#include "pfw/replay/ReplayBackend.h"
+
+#include "testutil/FileSandbox.h"
+
+using namespace std::chrono_literals;
+using namespace pfw;
+
+namespace {
+
+std::vector<EventPtr> batch(size_t count, const std::string &prefix = "file")
+{
+    std::vector<EventPtr> events;
+    for (size_t i = 0; i < count; ++i) {
+        events.emplace_back(std::make_unique<Event>(
+            i % 2 == 0 ? CREATED : MODIFIED,
+            fs::path("dir") / (prefix + std::to_string(i)), "/root"));
+    }
+    return events;
+}
+
+fs::path firstSegment(const fs::path &directory)
+{
+    for (const auto &entry : fs::directory_iterator(directory)) {
+        if (entry.path().extension() == ".log") {
+            return entry.path();
+        }
+    }
+    return fs::path();
+}
+
+size_t segmentCount(const fs::path &directory)
+{
+    size_t count = 0;
+    for (const auto &entry : fs::directory_iterator(directory)) {
+        count += entry.path().extension() == ".log";
+    }
+    return count;
+}
+
+}  // namespace
+
+TEST_CASE("test the event journal", "[EventJournal]")
+{
+    FileSandbox sandbox;
+    const auto  directory = sandbox.path() / "journal";
+
+    SECTION("events get increasing sequence numbers and survive a restart")
+    {
+        {
+            EventJournal journal(directory);
+            REQUIRE(journal.isValid());
+            CHECK(journal.firstSequence() == 1);
+            CHECK(journal.lastSequence() == 0);
+
+            auto events = batch(3);
+            journal.append(events);
+            CHECK(events[0]->sequence == 1);
+            CHECK(events[2]->sequence == 3);
+
+            // buffered events are visible before they are synced
+            std::vector<EventPtr> read;
+            CHECK(journal.readSince(0, read));
+            REQUIRE(read.size() == 3);
+            CHECK(read[1]->relativePath == events[1]->relativePath);
+        }
+
+        EventJournal journal(directory);
+        REQUIRE(journal.isValid());
+        CHECK(journal.lastSequence() == 3);
+
+        auto events = batch(2, "other");
+        journal.append(events);
+        CHECK(events[0]->sequence == 4);
+
+        std::vector<EventPtr> read;
+        CHECK(journal.readSince(2, read));
+        REQUIRE(read.size() == 3);
+        CHECK(read[0]->sequence == 3);
+        CHECK(read[0]->type == CREATED);
+        CHECK(read[0]->relativePath == fs::path("dir") / "file2");
+        CHECK(read[0]->root == "/root");
+        CHECK(read[2]->sequence == 5);
+        CHECK(read[2]->type == MODIFIED);
+        CHECK(read[2]->relativePath == fs::path("dir") / "other1");
+    }
+
+    SECTION("a torn frame is dropped on startup")
+    {
+        {
+            EventJournal journal(directory);
+            auto         events = batch(4);
+            journal.append(events);
+            REQUIRE(journal.flush());
+        }
+
+        const auto segment = firstSegment(directory);
+        fs::resize_file(segment, fs::file_size(segment) - 1);
+
+        // the sequence numbers of the dropped events are not reused
+        EventJournal journal(directory);
+        CHECK(journal.lastSequence() == 4);
+
+        auto events = batch(1);
+        journal.append(events);
+        CHECK(events[0]->sequence == 5);
+
+        std::vector<EventPtr> read;
+        CHECK(journal.readSince(0, read));
+        CHECK(read.size() == 1);
+    }
+
+    SECTION("sequence numbers are not reused after an unsynced append")
+    {
+        JournalOptions options;
+        options.syncInterval = 1h;
+
+        EventJournal journal(directory, options);
+        auto         events = batch(3);
+        journal.append(events);
+        CHECK(events[2]->sequence == 3);
+
+        // what a crash leaves on disk before the events have been synced
+        const auto crashed = sandbox.path() / "crashed";
+        fs::copy(directory, crashed);
+
+        EventJournal recovered(crashed);
+        REQUIRE(recovered.isValid());
+        CHECK(recovered.lastSequence() > 3);
+
+        auto more = batch(1);
+        recovered.append(more);
+        CHECK(more[0]->sequence > 3);
+
+        std::vector<EventPtr> read;
+        CHECK(recovered.readSince(3, read));
+        REQUIRE(read.size() == 1);
+        CHECK(read[0]->sequence == more[0]->sequence);
+    }
+
+    SECTION("old segments are pruned by size")
+    {
+        JournalOptions options;
+        options.segmentSize = 256;
+        options.maxSize     = 1024;
+
+        EventJournal journal(directory, options);
+        for (int i = 0; i < 50; ++i) {
+            auto events = batch(10);
+            journal.append(events);
+            journal.flush();
+        }
+        CHECK(journal.lastSequence() == 500);
+        CHECK(segmentCount(directory) > 1);
+        CHECK(segmentCount(directory) < 10);
+        CHECK(journal.firstSequence() > 1);
+
+        std::vector<EventPtr> read;
+        CHECK(!journal.readSince(0, read));
+        REQUIRE(!read.empty());
+        CHECK(read.front()->sequence == journal.firstSequence());
+        CHECK(read.back()->sequence == 500);
+
+        read.clear();
+        CHECK(journal.readSince(490, read));
+        CHECK(read.size() == 10);
+    }
+
+    SECTION("appending continues while the journal is written")
+    {
+        JournalOptions options;
+        options.segmentSize  = 4096;
+        options.syncInterval = 1ms;
+
+        EventJournal journal(directory, options);
+        std::thread  appender([&]() {
+            for (int i = 0; i < 200; ++i) {
+                auto events = batch(5);
+                journal.append(events);
+            }
+        });
+        for (int i = 0; i < 20; ++i) {
+            journal.flush();
+        }
+        appender.join();
+
+        std::vector<EventPtr> read;
+        CHECK(journal.readSince(0, read));
+        REQUIRE(read.size() == 1000);
+        size_t inOrder = 0;
+        for (size_t i = 0; i < read.size(); ++i) {
+            inOrder += read[i]->sequence == i + 1;
+        }
+        CHECK(inOrder == 1000);
+        CHECK(segmentCount(directory) > 1);
+    }
+
+    SECTION("old segments are pruned by age")
+    {
+        JournalOptions options;
+        options.segmentSize = 1;
+        options.maxAge      = std::chrono::seconds(0);
+
+        EventJournal journal(directory, options);
+        for (int i = 0; i < 3; ++i) {
+            auto events = batch(1);
+            journal.append(events);
+            std::this_thread::sleep_for(10ms);
+            journal.flush();
+        }
+        CHECK(segmentCount(directory) == 1);
+        CHECK(journal.firstSequence() == 4);
+    }
+
+    SECTION("the watcher journals every delivered event")
+    {
+        std::mutex            eventsMutex;
+        std::vector<EventPtr> events;
+
+        WatcherOptions options({}, BackendRegistry::REPLAY);
+        options.journalPath = directory;
+
+        FileSystemWatcher watcher(
+            sandbox.path(), 10ms,
+            [&](std::vector<EventPtr> &&batch) {
+                std::lock_guard<std::mutex> lock(eventsMutex);
+                for (auto &event : batch) {
+                    events.emplace_back(std::move(event));
+                }
+            },
+            options);
+        REQUIRE(watcher.journal() != nullptr);
+
+        auto *backend = dynamic_cast<ReplayBackend *>(watcher.backend());
+        REQUIRE(backend != nullptr);
+        backend->replay(batch(2));
+        backend->replay(batch(1, "other"));
+
+        std::vector<EventPtr> read;
+        CHECK(watcher.journal()->readSince(1, read));
+
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        REQUIRE(events.size() == 3);
+        CHECK(events[0]->sequence == 1);
+        CHECK(events[2]->sequence == 3);
+        REQUIRE(read.size() == 2);
+        CHECK(read[1]->relativePath == events[2]->relativePath);
+    }
+}
@@ -0,0 +1,113 @@
+#include "catch_wrapper.h"
+
+#include <chrono>
+
+#include "pfw/EventQueue.h"
+#include "pfw/FileSystemWatcher.h"
+#include "pfw/internal/definitions.h"
+#include "pfw/replay/ReplayBackend.h"
+
+#include "testutil/FileSandbox.h"
+
+#ifdef PFW_POSIX
+#include <poll.h>
+#endif
+
+using namespace std::chrono_literals;
+using namespace pfw;
+
+namespace {
+
+std::vector<EventPtr> events(EventType type, std::vector<fs::path> paths)
+{
+    std::vector<EventPtr> result;
+    for (const auto &path : paths) {
+        result.emplace_back(std::make_unique<Event>(type, path, "/root"));
+    }
+    return result;
+}
+
+#ifdef PFW_POSIX
+bool isReadable(int fd)
+{
+    pollfd descriptor{fd, POLLIN, 0};
+    return ::poll(&descriptor, 1, 0) == 1 && (descriptor.revents & POLLIN);
+}
+#endif
+
+}  // namespace
+
+TEST_CASE("test the event queue", "[EventQueue]")
+{
+    EventQueue            queue;
+    std::vector<EventPtr> batch;
+
+    SECTION("the batches are handed over together")
+    {
+        CHECK(!queue.poll(batch));
+
+        queue.push(events(CREATED, {"a", "b"}));
+        queue.push(events(MODIFIED, {"a"}));
+        REQUIRE(queue.poll(batch));
+        REQUIRE(batch.size() == 3);
+        CHECK(batch[0]->relativePath == "a");
+        CHECK(batch[2]->type == MODIFIED);
+
+        CHECK(!queue.poll(batch));
+        CHECK(batch.empty());
+    }
+
+    SECTION("a consumer which falls behind receives an overflow")
+    {
+        EventQueue bounded(3);
+        bounded.push(events(CREATED, {"a", "b"}));
+
+        auto other = events(CREATED, {"c", "d"});
+        other[1]->root = "/other";
+        bounded.push(std::move(other));
+        bounded.push(events(MODIFIED, {"a"}));
+
+        REQUIRE(bounded.poll(batch));
+        REQUIRE(batch.size() == 3);
+        CHECK(batch[0]->type == BUFFER_OVERFLOW);
+        CHECK(batch[0]->root == "/other");
+        CHECK(batch[1]->type == BUFFER_OVERFLOW);
+        CHECK(batch[1]->root == "/root");
+        CHECK(batch[2]->type == MODIFIED);
+    }
+
+#ifdef PFW_POSIX
+    SECTION("the descriptor is readable while events are queued")
+    {
+        REQUIRE(queue.fd() != -1);
+        CHECK(!isReadable(queue.fd()));
+
+        queue.push(events(CREATED, {"a"}));
+        queue.push(events(CREATED, {"b"}));
+        CHECK(isReadable(queue.fd()));
+
+        REQUIRE(queue.poll(batch));
+        CHECK(!isReadable(queue.fd()));
+
+        queue.push(events(DELETED, {"a"}));
+        CHECK(isReadable(queue.fd()));
+    }
+#endif
+
+    SECTION("a watcher without callback queues its events")
+    {
+        FileSandbox    sandbox;
+        WatcherOptions options({}, BackendRegistry::REPLAY);
+
+        FileSystemWatcher watcher(sandbox.path(), 10ms, options);
+        REQUIRE(watcher.eventQueue() != nullptr);
+
+        auto *backend = dynamic_cast<ReplayBackend *>(watcher.backend());
+        REQUIRE(backend != nullptr);
+        backend->replay(events(CREATED, {"a", "b"}));
+
+        REQUIRE(watcher.eventQueue()->poll(batch));
+        CHECK(batch.size() == 2);
+        CHECK(!watcher.eventQueue()->poll(batch));
+    }
+}
@@ -0,0 +1,101 @@
+#include "catch_wrapper.h"
+
+#include "pfw/EventStream.h"
+
+#ifndef PFW_COROUTINES
+#error "the event stream tests need C++20 coroutines"
+#endif
+
+#include <chrono>
+
+#include "pfw/FileSystemWatcher.h"
+#include "pfw/replay/ReplayBackend.h"
+
+#include "testutil/FileSandbox.h"
+
+using namespace std::chrono_literals;
+using namespace pfw;
+
+namespace {
+
+// runs eagerly and is never awaited itself
+struct Task {
+    struct promise_type {
+        Task                get_return_object() { return {}; }
+        std::suspend_never  initial_suspend() { return {}; }
+        std::suspend_never  final_suspend() noexcept { return {}; }
+        void                return_void() {}
+        void                unhandled_exception() { std::terminate(); }
+    };
+};
+
+Task consume(EventStream &stream, std::vector<size_t> &sizes)
+{
+    for (;;) {
+        auto batch = co_await stream.next();
+        if (batch.empty()) {
+            co_return;
+        }
+        sizes.push_back(batch.size());
+    }
+}
+
+std::vector<EventPtr> events(EventType type, std::vector<fs::path> paths)
+{
+    std::vector<EventPtr> result;
+    for (const auto &path : paths) {
+        result.emplace_back(std::make_unique<Event>(type, path, "/root"));
+    }
+    return result;
+}
+
+}  // namespace
+
+TEST_CASE("test the event stream", "[EventStream]")
+{
+    std::vector<size_t> sizes;
+
+    SECTION("the consumer is resumed by the delivery")
+    {
+        FileSandbox    sandbox;
+        EventStream    stream;
+        WatcherOptions options({}, BackendRegistry::REPLAY);
+
+        FileSystemWatcher watcher(sandbox.path(), 10ms, stream.callback(),
+                                  options);
+        auto *backend = dynamic_cast<ReplayBackend *>(watcher.backend());
+        REQUIRE(backend != nullptr);
+
+        consume(stream, sizes);
+        CHECK(sizes.empty());
+
+        backend->replay(events(CREATED, {"a", "b"}));
+        backend->replay(events(MODIFIED, {"a"}));
+        CHECK(sizes == std::vector<size_t>{2, 1});
+    }
+
+    SECTION("a busy consumer receives the merged batches")
+    {
+        std::vector<std::coroutine_handle<>> scheduled;
+        EventStream                          stream(
+            [&](std::coroutine_handle<> handle) {
+                scheduled.push_back(handle);
+            });
+        auto callback = stream.callback();
+
+        consume(stream, sizes);
+        callback(events(CREATED, {"a"}));
+        callback(events(CREATED, {"b", "c"}));
+        REQUIRE(scheduled.size() == 1);
+        CHECK(sizes.empty());
+
+        scheduled.front().resume();
+        CHECK(sizes == std::vector<size_t>{3});
+
+        stream.close();
+        REQUIRE(scheduled.size() == 2);
+        scheduled.back().resume();
+        CHECK(sizes == std::vector<size_t>{3});
+    }
+}
+
@@ -0,0 +1,160 @@
+#include "catch_wrapper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "pfw/FileIndex.h"
+#include "pfw/FileSystemWatcher.h"
+#include "pfw/internal/definitions.h"
+
+#include "testutil/FileSandbox.h"
+
+using namespace std::chrono_literals;
+using namespace pfw;
+
+namespace {
+
+std::vector<fs::path> paths(std::vector<FileIndex::Entry> entries)
+{
+    std::vector<fs::path> result;
+    for (const auto &entry : entries) {
+        result.push_back(entry.relativePath);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::vector<EventPtr> event(EventType type, const fs::path &relativePath,
+                            const fs::path &root)
+{
+    std::vector<EventPtr> events;
+    events.emplace_back(std::make_unique<Event>(type, relativePath, root));
+    return events;
+}
+
+}  // namespace
+
+TEST_CASE("test the file index", "[FileIndex]")
+{
+    SECTION("glob patterns")
+    {
+        CHECK(FileIndex::matches("*.cpp", "main.cpp"));
+        CHECK(!FileIndex::matches("*.cpp", "src/main.cpp"));
+        CHECK(FileIndex::matches("src/*.cpp", "src/main.cpp"));
+        CHECK(FileIndex::matches("**/*.cpp", "main.cpp"));
+        CHECK(FileIndex::matches("**/*.cpp", "src/linux/main.cpp"));
+        CHECK(FileIndex::matches("src/**", "src/linux/main.cpp"));
+        CHECK(FileIndex::matches("src/?ain.*", "src/main.h"));
+        CHECK(!FileIndex::matches("src/?ain.*", "src/mmain.h"));
+        CHECK(!FileIndex::matches("src/*", "src/linux/main.cpp"));
+    }
+
+    FileSandbox sandbox;
+    sandbox.createDirectory("src");
+    sandbox.createDirectory("src/linux");
+    sandbox.createDirectory("excluded");
+    sandbox.createFile("README.md", std::string("readme"));
+    sandbox.createFile("src/main.cpp");
+    sandbox.createFile("src/main.h");
+    sandbox.createFile("src/linux/inotify.cpp");
+    sandbox.createFile("excluded/file.cpp");
+
+    FileIndex index([](const fs::path &relativePath) {
+        return relativePath != "excluded";
+    });
+    index.addRoot(sandbox.path());
+
+    SECTION("the roots are crawled")
+    {
+        CHECK(index.size() == 7);
+
+        FileIndex::Entry entry;
+        REQUIRE(index.find(sandbox.path(), "README.md", entry));
+        CHECK(!entry.isDirectory);
+        CHECK(entry.size == 6);
+#ifdef PFW_POSIX
+        CHECK(entry.inode != 0);
+#endif
+        REQUIRE(index.find(sandbox.path(), "src/linux", entry));
+        CHECK(entry.isDirectory);
+        CHECK(!index.find(sandbox.path(), "excluded/file.cpp", entry));
+    }
+
+    SECTION("subtrees, patterns and extensions are queried")
+    {
+        CHECK(paths(index.list(sandbox.path(), "src")) ==
+              std::vector<fs::path>{"src/linux", "src/linux/inotify.cpp",
+                                    "src/main.cpp", "src/main.h"});
+        CHECK(paths(index.list(sandbox.path(), "src", false)) ==
+              std::vector<fs::path>{"src/linux", "src/main.cpp",
+                                    "src/main.h"});
+        CHECK(paths(index.glob(sandbox.path(), "**/*.cpp")) ==
+              std::vector<fs::path>{"src/linux/inotify.cpp", "src/main.cpp"});
+        CHECK(paths(index.glob(sandbox.path(), "src/main.*")) ==
+              std::vector<fs::path>{"src/main.cpp", "src/main.h"});
+        CHECK(paths(index.withExtension(sandbox.path(), ".md")) ==
+              std::vector<fs::path>{"README.md"});
+        CHECK(index.list("/unknown").empty());
+    }
+
+    SECTION("events keep the index current")
+    {
+        sandbox.createDirectory("lib");
+        sandbox.createFile("lib/util.cpp");
+        index.update(event(CREATED, "lib", sandbox.path()));
+        CHECK(paths(index.withExtension(sandbox.path(), ".cpp")) ==
+              std::vector<fs::path>{"lib/util.cpp", "src/linux/inotify.cpp",
+                                    "src/main.cpp"});
+
+        sandbox.modifyFile("README.md", "changed readme");
+        index.update(event(MODIFIED, "README.md", sandbox.path()));
+        FileIndex::Entry entry;
+        REQUIRE(index.find(sandbox.path(), "README.md", entry));
+        CHECK(entry.size == 14);
+
+        fs::remove_all(sandbox.path() / "src");
+        index.update(event(DELETED, "src", sandbox.path()));
+        CHECK(index.list(sandbox.path(), "src").empty());
+        CHECK(paths(index.withExtension(sandbox.path(), ".cpp")) ==
+              std::vector<fs::path>{"lib/util.cpp"});
+    }
+
+    SECTION("an overflow crawls the root again")
+    {
+        sandbox.createFile("unreported.cpp");
+        index.update(event(BUFFER_OVERFLOW, "", sandbox.path()));
+
+        FileIndex::Entry entry;
+        CHECK(index.find(sandbox.path(), "unreported.cpp", entry));
+    }
+
+    SECTION("a summarized subtree is crawled again")
+    {
+        fs::remove(sandbox.path() / "src/main.h");
+        sandbox.createFile("src/linux/fanotify.cpp");
+        index.update(event(SUBTREE | MODIFIED, "src", sandbox.path()));
+        CHECK(paths(index.list(sandbox.path(), "src")) ==
+              std::vector<fs::path>{"src/linux", "src/linux/fanotify.cpp",
+                                    "src/linux/inotify.cpp", "src/main.cpp"});
+    }
+
+    SECTION("the watcher maintains the index")
+    {
+        WatcherOptions options;
+        options.fileIndex = true;
+
+        FileSystemWatcher watcher(
+            sandbox.path(), 10ms, [](std::vector<EventPtr> &&) {}, options);
+        REQUIRE(watcher.fileIndex() != nullptr);
+        CHECK(watcher.fileIndex()->size() == 8);
+
+        sandbox.createDirectory("new");
+        std::this_thread::sleep_for(100ms);
+        sandbox.createFile("new/file.txt");
+        std::this_thread::sleep_for(200ms);
+
+        CHECK(paths(watcher.fileIndex()->glob(sandbox.path(), "new/*")) ==
+              std::vector<fs::path>{"new/file.txt"});
+    }
+}
@@ -0,0 +1,109 @@
+#include "catch_wrapper.h"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "pfw/FileStatus.h"
+#include "pfw/FileSystemWatcher.h"
+#include "pfw/internal/definitions.h"
+#include "pfw/replay/ReplayBackend.h"
+
+#include "testutil/FileSandbox.h"
+
+using namespace std::chrono_literals;
+using namespace pfw;
+
+TEST_CASE("test the file status", "[FileStatus]")
+{
+    FileSandbox sandbox;
+    sandbox.createDirectory("dir");
+    sandbox.createFile("dir/file", std::string("content"));
+
+    SECTION("the status of a path is read")
+    {
+        FileStatus status;
+        REQUIRE(FileStatus::read(sandbox.path() / "dir/file", status));
+        CHECK(status.type == FileStatus::REGULAR);
+        CHECK(status.size == 7);
+        CHECK(status.mtime > 0);
+#ifdef PFW_POSIX
+        CHECK(status.inode != 0);
+#endif
+
+        REQUIRE(FileStatus::read(sandbox.path() / "dir", status));
+        CHECK(status.type == FileStatus::DIRECTORY);
+        CHECK(!FileStatus::read(sandbox.path() / "missing", status));
+    }
+
+    SECTION("a large batch is enriched by several threads")
+    {
+        std::vector<EventPtr> events;
+        for (int i = 0; i < 1000; ++i) {
+            events.emplace_back(std::make_unique<Event>(
+                MODIFIED, i % 2 == 0 ? "dir/file" : "missing", sandbox.path()));
+        }
+        events.emplace_back(std::make_unique<Event>(FAILED, "dir/file"));
+
+        FileStatus::enrich(events, 4);
+        for (size_t i = 0; i < 1000; ++i) {
+            REQUIRE(events[i]->status.has_value() == (i % 2 == 0));
+        }
+        CHECK(events[0]->status->size == 7);
+        CHECK(!events.back()->status);
+    }
+
+    SECTION("a backend without a collector attaches the status as well")
+    {
+        std::vector<EventPtr> events;
+
+        WatcherOptions options({}, BackendRegistry::REPLAY);
+        options.statEvents = true;
+
+        FileSystemWatcher watcher(
+            sandbox.path(), 10ms,
+            [&](std::vector<EventPtr> &&batch) { events = std::move(batch); },
+            options);
+        auto *backend = dynamic_cast<ReplayBackend *>(watcher.backend());
+        REQUIRE(backend != nullptr);
+
+        std::vector<EventPtr> replayed;
+        replayed.emplace_back(std::make_unique<Event>(MODIFIED, "dir/file"));
+        backend->replay(std::move(replayed));
+
+        REQUIRE(events.size() == 1);
+        REQUIRE(events[0]->status);
+        CHECK(events[0]->status->size == 7);
+    }
+
+#if !defined(PFW_USE_POLLING) && !defined(PFW_APPLE)
+    SECTION("the collector attaches the status to the events")
+    {
+        std::mutex            eventsMutex;
+        std::vector<EventPtr> events;
+
+        WatcherOptions options;
+        options.statEvents = true;
+
+        FileSystemWatcher watcher(
+            sandbox.path(), 10ms,
+            [&](std::vector<EventPtr> &&batch) {
+                std::lock_guard<std::mutex> lock(eventsMutex);
+                for (auto &event : batch) {
+                    events.emplace_back(std::move(event));
+                }
+            },
+            options);
+
+        sandbox.createFile("new", std::string("12345"));
+        std::this_thread::sleep_for(200ms);
+
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        REQUIRE(!events.empty());
+        CHECK(events[0]->relativePath == "new");
+        REQUIRE(events[0]->status);
+        CHECK(events[0]->status->type == FileStatus::REGULAR);
+        CHECK(events[0]->status->size == 5);
+    }
+#endif
+}
@@ -6,6 +6,7 @@
 #include <iostream>
 #include <limits.h>
 #include <locale>
+#include <set>
 #include <string>
 #include <thread>
 
@@ -16,6 +17,10 @@
 
 #include "pfw/internal/definitions.h"
 
+#if defined(PFW_LINUX) && !defined(PFW_USE_POLLING)
+#include "pfw/linux/InotifyWatchRegistry.h"
+#endif
+
 using namespace std::chrono_literals;
 using namespace pfw;
 
@@ -101,6 +106,17 @@ class TestFileSystemAdapter
     {
     }
 
+    TestFileSystemAdapter(const std::vector<fs::path> &paths,
+                          std::chrono::milliseconds    duration)
+        : vecEvents(new std::vector<EventPtr>())
+        , fswatch(paths,
+                  duration,
+                  std::bind(&TestFileSystemAdapter::listernerFunction,
+                            this,
+                            std::placeholders::_1))
+    {
+    }
+
     VecEvents getEventsAfterWait(std::chrono::microseconds ms)
     {
         std::this_thread::sleep_for(ms);
@@ -116,6 +132,14 @@ class TestFileSystemAdapter
 
     bool isWatching() { return fswatch.isWatching(); }
 
+    void setFilterOptions(const FilterOptions &filterOptions)
+    {
+        fswatch.setFilterOptions(filterOptions);
+    }
+
+    bool addRoot(const fs::path &path) { return fswatch.addRoot(path); }
+    bool removeRoot(const fs::path &path) { return fswatch.removeRoot(path); }
+
   private:
     void listernerFunction(std::vector<EventPtr> &&events)
     {
@@ -716,6 +740,163 @@ TEST_CASE("test the file system watcher", "[FileSystemWatcher]")
         CHECK(watcher->isWatching());
     }
 
+    SECTION("Filter")
+    {
+        fs::path includedDir = "included";
+        fs::path excludedDir = "excluded";
+        fs::path fileName    = "created_file";
+        sandbox.createDirectory(relWatchedDir / includedDir);
+        sandbox.createDirectory(relWatchedDir / excludedDir);
+        sandbox.createDirectory(relWatchedDir / excludedDir / "sub");
+
+        SECTION("excluded subtree")
+        {
+            auto watcher = startWatching();
+            watcher->setFilterOptions({{}, {excludedDir}});
+
+            sandbox.createFile(relWatchedDir / includedDir / fileName);
+            sandbox.createFile(relWatchedDir / excludedDir / "sub" / fileName);
+
+            std::vector<ExpectedEvent> expectedEvents = {
+                ExpectedEvent(includedDir / fileName, EventType::CREATED)};
+
+            REQUIRE(eventWasDetected(watcher, expectedEvents,
+                                     {excludedDir / "sub" / fileName}));
+            CHECK(watcher->isWatching());
+        }
+
+        SECTION("hot reload of filter options")
+        {
+            auto watcher = startWatching();
+            watcher->setFilterOptions({{includedDir}, {}});
+
+            sandbox.createFile(relWatchedDir / excludedDir / "sub" / fileName);
+            REQUIRE(eventWasDetected(watcher, {},
+                                     {excludedDir / "sub" / fileName}));
+
+            watcher->setFilterOptions({{}, {includedDir}});
+
+            sandbox.modifyFile(relWatchedDir / excludedDir / "sub" / fileName,
+                               "content");
+            sandbox.createFile(relWatchedDir / includedDir / fileName);
+
+            std::vector<ExpectedEvent> expectedEvents = {ExpectedEvent(
+                excludedDir / "sub" / fileName, EventType::MODIFIED)};
+
+            REQUIRE(eventWasDetected(watcher, expectedEvents,
+                                     {includedDir / fileName}));
+            CHECK(watcher->isWatching());
+        }
+    }
+
+#if defined(PFW_LINUX) && !defined(PFW_USE_POLLING)
+    SECTION("multiple roots")
+    {
+        fs::path rootA    = sandbox.createDirectory("root_a");
+        fs::path rootB    = sandbox.createDirectory("root_b");
+        fs::path fileName = "created_file";
+
+        auto watcher = std::make_shared<TestFileSystemAdapter>(
+            std::vector<fs::path>{rootA, absWatchedDir}, defaultLatency);
+        std::this_thread::sleep_for(10ms);
+
+        REQUIRE(watcher->addRoot(rootB));
+        CHECK(!watcher->addRoot(absWatchedDir / "nested"));
+
+        sandbox.createFile("root_a" / fileName);
+        sandbox.createFile("root_b" / fileName);
+        sandbox.createFile(relWatchedDir / fileName);
+
+        auto events = watcher->getEventsAfterWait(
+            std::chrono::milliseconds(grace_period_ms));
+
+        std::set<fs::path> roots;
+        for (const auto &event : *events) {
+            if (event->relativePath == fileName && created(event->type)) {
+                roots.insert(event->root);
+            }
+        }
+        CHECK(roots == std::set<fs::path>{rootA, rootB, absWatchedDir});
+
+        REQUIRE(watcher->removeRoot(rootA));
+        sandbox.modifyFile("root_a" / fileName, "content");
+        sandbox.modifyFile("root_b" / fileName, "content");
+
+        events = watcher->getEventsAfterWait(
+            std::chrono::milliseconds(grace_period_ms));
+        REQUIRE(events->size() == 1);
+        CHECK(events->front()->root == rootB);
+        CHECK(watcher->isWatching());
+    }
+
+    SECTION("overlapping watchers share their watches")
+    {
+        fs::path nestedDir = sandbox.createDirectory(relWatchedDir / "nested");
+        fs::path fileName  = "created_file";
+
+        auto outer = startWatching();
+        const auto watchCount =
+            InotifyWatchRegistry::instance()->watchCount();
+
+        auto inner = std::make_shared<TestFileSystemAdapter>(nestedDir,
+                                                             defaultLatency);
+        std::this_thread::sleep_for(10ms);
+        CHECK(InotifyWatchRegistry::instance()->watchCount() == watchCount);
+
+        sandbox.createFile(relWatchedDir / "nested" / fileName);
+
+        REQUIRE(eventWasDetected(
+            outer, {ExpectedEvent("nested" / fileName, EventType::CREATED)}));
+        REQUIRE(eventWasDetected(
+            inner, {ExpectedEvent(fileName, EventType::CREATED)}));
+
+        outer.reset();
+        sandbox.modifyFile(relWatchedDir / "nested" / fileName, "content");
+        REQUIRE(eventWasDetected(
+            inner, {ExpectedEvent(fileName, EventType::MODIFIED)}));
+        CHECK(inner->isWatching());
+    }
+
+    SECTION("watch budget")
+    {
+        const std::vector<fs::path> dirNames = {"a", "b", "c", "d"};
+        for (const auto &dirName : dirNames) {
+            sandbox.createDirectory(relWatchedDir / dirName);
+        }
+        fs::path fileName = "created_file";
+
+        auto registry = InotifyWatchRegistry::instance();
+        registry->setPollingInterval(20ms);
+        registry->setWatchBudget(3);
+
+        auto watcher = startWatching();
+        CHECK(registry->watchCount() == 3);
+        REQUIRE(registry->polledPaths().size() == 2);
+
+        std::vector<ExpectedEvent> expectedEvents;
+        for (const auto &dirName : dirNames) {
+            sandbox.createFile(relWatchedDir / dirName / fileName);
+            expectedEvents.emplace_back(dirName / fileName, EventType::CREATED);
+        }
+        REQUIRE(eventWasDetected(watcher, expectedEvents));
+
+        // a busy polled directory is promoted in exchange for an idle one
+        const fs::path busyDir = registry->polledPaths().front();
+        std::this_thread::sleep_for(300ms);
+        for (int i = 0; i < 5; ++i) {
+            sandbox.modifyFile(relWatchedDir / busyDir.filename() / fileName,
+                               std::to_string(i));
+            std::this_thread::sleep_for(30ms);
+        }
+        watcher->getEventsAfterWait(std::chrono::milliseconds(grace_period_ms));
+
+        const auto polledPaths = registry->polledPaths();
+        CHECK(std::find(polledPaths.begin(), polledPaths.end(), busyDir) ==
+              polledPaths.end());
+        CHECK(registry->watchCount() <= 3);
+    }
+#endif
+
     SECTION("Directory")
     {
         SECTION("directory creation")
@@ -1091,3 +1272,342 @@ TEST_CASE("test the file system watcher", "[FileSystemWatcher]")
         }
     }
 }
+
+TEST_CASE("test combined renames", "[FileSystemWatcher]")
+{
+    auto pair = [](const fs::path &from, const fs::path &to) {
+        std::vector<EventPtr> events;
+        events.emplace_back(
+            std::make_unique<Event>(DELETED | RENAMED, from, "/root"));
+        events.emplace_back(
+            std::make_unique<Event>(CREATED | RENAMED, to, "/root"));
+        return events;
+    };
+
+    SECTION("a rename pair becomes a single event")
+    {
+        auto events = pair("from", "to");
+        events.emplace_back(
+            std::make_unique<Event>(DELETED | RENAMED, "moved_out", "/root"));
+        Filter::combineRenames(events);
+
+        REQUIRE(events.size() == 2);
+        CHECK(events[0]->type == RENAMED);
+        CHECK(events[0]->relativePath == "to");
+        CHECK(events[0]->previousPath == "from");
+        CHECK(events[1]->type == (DELETED | RENAMED));
+        CHECK(events[1]->previousPath.empty());
+    }
+
+    SECTION("only adjacent halves are paired")
+    {
+        auto events = pair("moved_out", "moved_in");
+        events.insert(events.begin() + 1, std::make_unique<Event>(
+                                              MODIFIED, "other", "/root"));
+        Filter::combineRenames(events);
+
+        REQUIRE(events.size() == 3);
+        CHECK(events[0]->type == (DELETED | RENAMED));
+        CHECK(events[2]->type == (CREATED | RENAMED));
+        CHECK(events[2]->previousPath.empty());
+    }
+
+    SECTION("a rename across the filter boundary is one half")
+    {
+        std::vector<EventPtr> delivered;
+        Filter filter(
+            [&](std::vector<EventPtr> &&events) {
+                for (auto &event : events) {
+                    delivered.emplace_back(std::move(event));
+                }
+            },
+            FilterOptions{{}, {"excluded"}});
+        filter.setCombineRenames(true);
+
+        filter.filterAndNotify(pair("file", "excluded/file"));
+        filter.filterAndNotify(pair("excluded/other", "other"));
+        filter.filterAndNotify(pair("excluded/a", "excluded/b"));
+
+        REQUIRE(delivered.size() == 2);
+        CHECK(delivered[0]->type == (DELETED | RENAMED));
+        CHECK(delivered[0]->relativePath == "file");
+        CHECK(delivered[1]->type == (CREATED | RENAMED));
+        CHECK(delivered[1]->relativePath == "other");
+        CHECK(delivered[1]->previousPath.empty());
+    }
+
+#ifndef PFW_APPLE
+    SECTION("the watcher reports a rename once")
+    {
+        FileSandbox sandbox;
+        sandbox.createFile("file");
+
+        std::mutex            eventsMutex;
+        std::vector<EventPtr> events;
+
+        WatcherOptions options;
+        options.combineRenames = true;
+
+        FileSystemWatcher watcher(
+            sandbox.path(), defaultLatency,
+            [&](std::vector<EventPtr> &&batch) {
+                std::lock_guard<std::mutex> lock(eventsMutex);
+                for (auto &event : batch) {
+                    events.emplace_back(std::move(event));
+                }
+            },
+            options);
+        std::this_thread::sleep_for(10ms);
+
+        sandbox.rename("file", "renamed");
+        std::this_thread::sleep_for(std::chrono::milliseconds(grace_period_ms));
+
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        REQUIRE(events.size() == 1);
+        CHECK(renamed(events[0]->type));
+        CHECK(!created(events[0]->type));
+        CHECK(!deleted(events[0]->type));
+        CHECK(events[0]->relativePath == "renamed");
+        CHECK(events[0]->previousPath == "file");
+    }
+#endif
+
+#if defined(PFW_LINUX) && !defined(PFW_USE_POLLING)
+    SECTION("a move across the root of a watcher is not a rename")
+    {
+        FileSandbox sandbox;
+        sandbox.createDirectory("inner");
+        sandbox.createFile("inner/moved_out");
+        sandbox.createFile("moved_in");
+
+        // the outer watcher keeps both directories in the registry
+        FileSystemWatcher outer(sandbox.path(), defaultLatency,
+                                [](std::vector<EventPtr> &&) {});
+
+        std::mutex            eventsMutex;
+        std::vector<EventPtr> events;
+
+        WatcherOptions options;
+        options.combineRenames = true;
+
+        FileSystemWatcher inner(
+            sandbox.path() / "inner", 200ms,
+            [&](std::vector<EventPtr> &&batch) {
+                std::lock_guard<std::mutex> lock(eventsMutex);
+                for (auto &event : batch) {
+                    events.emplace_back(std::move(event));
+                }
+            },
+            options);
+        std::this_thread::sleep_for(10ms);
+
+        sandbox.rename("inner/moved_out", "moved_out");
+        sandbox.rename("moved_in", "inner/moved_in");
+        std::this_thread::sleep_for(500ms);
+
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        REQUIRE(events.size() == 2);
+        CHECK(events[0]->type == DELETED);
+        CHECK(events[0]->relativePath == "moved_out");
+        CHECK(events[1]->type == CREATED);
+        CHECK(events[1]->relativePath == "moved_in");
+    }
+#endif
+}
+
+TEST_CASE("test coalesced saves", "[FileSystemWatcher]")
+{
+    auto add = [](std::vector<EventPtr> &events, EventType type,
+                  const fs::path &relativePath) {
+        events.emplace_back(
+            std::make_unique<Event>(type, relativePath, "/root"));
+    };
+
+    SECTION("temporary file names are recognized")
+    {
+        CHECK(Filter::isTemporary("src/main.cpp~"));
+        CHECK(Filter::isTemporary("main.cpp.tmp"));
+        CHECK(Filter::isTemporary("main.cpp.tmp.1234"));
+        CHECK(Filter::isTemporary("src/.main.cpp.swp"));
+        CHECK(!Filter::isTemporary("main.cpp"));
+        CHECK(!Filter::isTemporary("tmp/main.cpp"));
+    }
+
+    SECTION("a save becomes a modification of the target")
+    {
+        std::vector<EventPtr> events;
+        add(events, CREATED, "file.tmp");
+        add(events, MODIFIED, "other");
+        add(events, MODIFIED, "file.tmp");
+        add(events, DELETED | RENAMED, "file.tmp");
+        add(events, CREATED | RENAMED, "file");
+        Filter::coalesceSaves(events);
+
+        REQUIRE(events.size() == 2);
+        CHECK(events[0]->relativePath == "other");
+        CHECK(events[1]->type == MODIFIED);
+        CHECK(events[1]->relativePath == "file");
+    }
+
+    SECTION("two saves in one batch")
+    {
+        std::vector<EventPtr> events;
+        add(events, CREATED, "file.tmp");
+        add(events, DELETED | RENAMED, "file.tmp");
+        add(events, CREATED | RENAMED, "file");
+        add(events, CREATED, "file.tmp");
+        add(events, MODIFIED, "file.tmp");
+        add(events, DELETED | RENAMED, "file.tmp");
+        add(events, CREATED | RENAMED, "file");
+        Filter::coalesceSaves(events);
+
+        REQUIRE(events.size() == 2);
+        CHECK(events[0]->type == MODIFIED);
+        CHECK(events[0]->relativePath == "file");
+        CHECK(events[1]->type == MODIFIED);
+        CHECK(events[1]->relativePath == "file");
+    }
+
+    SECTION("temp created after the save survives")
+    {
+        std::vector<EventPtr> events;
+        add(events, CREATED, "file.tmp");
+        add(events, DELETED | RENAMED, "file.tmp");
+        add(events, CREATED | RENAMED, "file");
+        add(events, CREATED, "file.tmp");
+        Filter::coalesceSaves(events);
+
+        REQUIRE(events.size() == 2);
+        CHECK(events[0]->type == MODIFIED);
+        CHECK(events[0]->relativePath == "file");
+        CHECK(events[1]->type == CREATED);
+        CHECK(events[1]->relativePath == "file.tmp");
+    }
+
+    SECTION("other renames are left alone")
+    {
+        std::vector<EventPtr> events;
+        add(events, CREATED, "file.tmp");
+        add(events, DELETED | RENAMED, "file");
+        add(events, CREATED | RENAMED, "renamed");
+        add(events, DELETED | RENAMED, "a.tmp");
+        add(events, CREATED | RENAMED, "b.tmp");
+        add(events, DELETED | RENAMED, "c.tmp");
+        add(events, MODIFIED, "other");
+        add(events, CREATED | RENAMED, "c");
+        Filter::coalesceSaves(events);
+        CHECK(events.size() == 8);
+    }
+
+#if !defined(PFW_USE_POLLING) && !defined(PFW_APPLE)
+    SECTION("the watcher reports a save once")
+    {
+        FileSandbox sandbox;
+        sandbox.createFile("file");
+
+        std::mutex            eventsMutex;
+        std::vector<EventPtr> events;
+
+        WatcherOptions options;
+        options.coalesceSaves  = true;
+        options.combineRenames = true;
+
+        FileSystemWatcher watcher(
+            sandbox.path(), defaultLatency,
+            [&](std::vector<EventPtr> &&batch) {
+                std::lock_guard<std::mutex> lock(eventsMutex);
+                for (auto &event : batch) {
+                    events.emplace_back(std::move(event));
+                }
+            },
+            options);
+        std::this_thread::sleep_for(10ms);
+
+        sandbox.createFile("file.tmp~", std::string("saved"));
+        sandbox.rename("file.tmp~", "file");
+        std::this_thread::sleep_for(std::chrono::milliseconds(grace_period_ms));
+
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        REQUIRE(events.size() == 1);
+        CHECK(events[0]->type == MODIFIED);
+        CHECK(events[0]->relativePath == "file");
+    }
+#endif
+}
+
+TEST_CASE("test chunked delivery", "[FileSystemWatcher]")
+{
+    std::vector<size_t>       sizes;
+    std::vector<fs::path>     paths;
+    std::vector<const void *> buffers;
+
+    Filter filter([&](std::vector<EventPtr> &&events) {
+        sizes.push_back(events.size());
+        buffers.push_back(events.data());
+        for (const auto &event : events) {
+            paths.push_back(event->relativePath);
+        }
+    });
+
+    std::vector<EventPtr> events;
+    std::vector<fs::path> expected;
+    for (int i = 0; i < 10; ++i) {
+        expected.push_back("file" + std::to_string(i));
+        events.emplace_back(std::make_unique<Event>(CREATED, expected.back()));
+    }
+
+    SECTION("a large batch is delivered in bounded chunks")
+    {
+        filter.setMaxBatchSize(4);
+        filter.filterAndNotify(std::move(events));
+
+        CHECK(sizes == std::vector<size_t>{4, 4, 2});
+        CHECK(paths == expected);
+        // the callback did not keep the chunk, so its buffer is reused
+        CHECK(buffers[0] == buffers[1]);
+        CHECK(buffers[1] == buffers[2]);
+    }
+
+    SECTION("a rename pair is not split")
+    {
+        events[3]->type = DELETED | RENAMED;
+        events[4]->type = CREATED | RENAMED;
+        filter.setMaxBatchSize(4);
+        filter.filterAndNotify(std::move(events));
+
+        CHECK(sizes == std::vector<size_t>{3, 4, 3});
+        CHECK(paths == expected);
+    }
+
+    SECTION("a rename pair with merged halves is not split")
+    {
+        events[3]->type = DELETED | RENAMED;
+        events[4]->type = CREATED | RENAMED;
+        events.emplace_back(std::make_unique<Event>(CREATED, "file3"));
+        events.emplace_back(std::make_unique<Event>(MODIFIED, "file4"));
+        filter.setMaxBatchSize(4);
+        filter.filterAndNotify(std::move(events));
+
+        CHECK(sizes == std::vector<size_t>{3, 4, 3});
+        CHECK(paths == expected);
+    }
+
+    SECTION("a rename pair exceeds a single event chunk")
+    {
+        events[0]->type = DELETED | RENAMED;
+        events[1]->type = CREATED | RENAMED;
+        filter.setMaxBatchSize(1);
+        filter.filterAndNotify(std::move(events));
+
+        REQUIRE(sizes.size() == 9);
+        CHECK(sizes[0] == 2);
+        CHECK(paths == expected);
+    }
+
+    SECTION("a small batch is delivered as a whole")
+    {
+        filter.setMaxBatchSize(10);
+        filter.filterAndNotify(std::move(events));
+        CHECK(sizes == std::vector<size_t>{10});
+    }
+}
@@ -0,0 +1,112 @@
+#include "catch_wrapper.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory_resource>
+
+#include "pfw/FileSystemWatcher.h"
+#include "pfw/replay/ReplayBackend.h"
+
+#include "testutil/FileSandbox.h"
+
+using namespace std::chrono_literals;
+using namespace pfw;
+
+namespace {
+
+// counts what is requested from the global allocator
+class CountingResource : public std::pmr::memory_resource
+{
+  public:
+    size_t allocations() const { return mAllocations; }
+
+  private:
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+        ++mAllocations;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    std::atomic<size_t> mAllocations{0};
+};
+
+std::vector<EventPtr> events(EventType type, std::vector<fs::path> paths)
+{
+    std::vector<EventPtr> result;
+    for (const auto &path : paths) {
+        result.emplace_back(std::make_unique<Event>(type, path));
+    }
+    return result;
+}
+
+}  // namespace
+
+TEST_CASE("test the memory resource", "[MemoryResource]")
+{
+    CountingResource resource;
+
+    SECTION("the batches of the handler are reused")
+    {
+        FileSandbox    sandbox;
+        WatcherOptions options({}, BackendRegistry::REPLAY);
+        options.memoryResource = &resource;
+
+        using Batch   = std::pmr::vector<EventPtr>;
+        size_t events = 0;
+        PmrFileSystemWatcher watcher(
+            sandbox.path(), 10ms,
+            [&](Batch &&batch) {
+                CHECK(batch.get_allocator().resource() == &resource);
+                events += batch.size();
+            },
+            options);
+
+        auto *backend = dynamic_cast<ReplayBackend *>(watcher.backend());
+        REQUIRE(backend != nullptr);
+        backend->replay(::events(MODIFIED, {"a", "b", "c"}));
+        const auto warmedUp = resource.allocations();
+        CHECK(warmedUp > 0);
+
+        for (int i = 0; i < 10; ++i) {
+            backend->replay(::events(MODIFIED, {"a", "b", "c"}));
+        }
+        CHECK(events == 33);
+        CHECK(resource.allocations() == warmedUp);
+    }
+
+    SECTION("the filter allocates nothing in the steady state")
+    {
+        FileSandbox    sandbox;
+        WatcherOptions options({}, BackendRegistry::REPLAY);
+        options.memoryResource = &resource;
+
+        size_t            events = 0;
+        FileSystemWatcher watcher(
+            sandbox.path(), 10ms,
+            [&](std::vector<EventPtr> &&batch) { events += batch.size(); },
+            options);
+
+        auto *backend = dynamic_cast<ReplayBackend *>(watcher.backend());
+        REQUIRE(backend != nullptr);
+        // the duplicates are merged by the filter
+        backend->replay(::events(MODIFIED, {"a", "b", "a", "c", "b"}));
+        const auto warmedUp = resource.allocations();
+        CHECK(warmedUp > 0);
+
+        for (int i = 0; i < 10; ++i) {
+            backend->replay(::events(MODIFIED, {"a", "b", "a", "c", "b"}));
+        }
+        CHECK(events == 33);
+        CHECK(resource.allocations() == warmedUp);
+    }
+}
@@ -0,0 +1,76 @@
+#include "catch_wrapper.h"
+
+#include <sstream>
+
+#include "pfw/MountTable.h"
+
+using namespace pfw;
+
+TEST_CASE("test the mount table", "[MountTable]")
+{
+    std::istringstream mountInfo(
+        "22 1 8:1 / / rw,relatime shared:1 - ext4 /dev/sda1 rw\n"
+        "23 22 0:21 / /proc rw,nosuid - proc proc rw\n"
+        "24 22 0:5 / /home/user/remote rw shared:7 - nfs4 server:/export rw\n"
+        "25 22 0:45 / /home/user/my\\040drive rw - fuse.sshfs host: rw\n"
+        "26 22 8:2 / /home/user/data rw - ext4 /dev/sda2 rw\n"
+        "27 22 0:30 / /mnt/auto rw - autofs systemd-1 rw\n"
+        "28 27 0:31 / /mnt/auto rw - nfs server:/auto rw\n"
+        "29 22 0:32 / /net rw - autofs -hosts rw\n"
+        "30 29 0:33 / /net/host rw - nfs4 host:/ rw\n"
+        "malformed line\n");
+    const auto mounts = MountTable::parse(mountInfo);
+
+    SECTION("mount points are recognized")
+    {
+        CHECK(mounts.isMountPoint("/"));
+        CHECK(mounts.isMountPoint("/home/user/remote"));
+        CHECK(mounts.isMountPoint("/home/user/my drive"));
+        CHECK(!mounts.isMountPoint("/home/user"));
+    }
+
+    SECTION("file systems are classified")
+    {
+        CHECK(mounts.kindAt("/") == MountTable::LOCAL);
+        CHECK(mounts.kindAt("/proc") == MountTable::PSEUDO);
+        CHECK(mounts.kindAt("/home/user/remote") == MountTable::REMOTE);
+        CHECK(mounts.kindAt("/home/user/my drive") == MountTable::REMOTE);
+        CHECK(mounts.kindAt("/home/user/data") == MountTable::LOCAL);
+        CHECK(mounts.kindAt("/home/user") == MountTable::LOCAL);
+
+        // the mounted file system covers the automount point
+        CHECK(mounts.kindAt("/mnt/auto") == MountTable::REMOTE);
+
+        CHECK(MountTable::kindOfType("tmpfs") == MountTable::LOCAL);
+        CHECK(MountTable::kindOfType("fuseblk") == MountTable::LOCAL);
+        CHECK(MountTable::kindOfType("cifs") == MountTable::REMOTE);
+        CHECK(MountTable::kindOfType("sysfs") == MountTable::PSEUDO);
+    }
+
+    SECTION("pseudo file systems are skipped")
+    {
+        CHECK(mounts.isSkipped("/", "/proc", false));
+        CHECK(mounts.isSkipped("/", "/proc/self/fd", false));
+        CHECK(!mounts.isSkipped("/", "/home/user/remote", false));
+        CHECK(!mounts.isSkipped("/", "/home/user/data/dir", false));
+        CHECK(!mounts.isSkipped("/", "/", false));
+
+        // the mounts of an indirect automount map are crawled, the map is not
+        CHECK(mounts.isSkipped("/", "/net", false));
+        CHECK(!mounts.isSkipped("/", "/net/host", false));
+        CHECK(!mounts.isSkipped("/", "/net/host/dir", false));
+        CHECK(mounts.kindAt("/net/host") == MountTable::REMOTE);
+
+        // a pseudo file system is watched if it is the root itself
+        CHECK(!mounts.isSkipped("/proc", "/proc/self", false));
+    }
+
+    SECTION("the crawl stays on one file system")
+    {
+        CHECK(mounts.isSkipped("/", "/home/user/data", true));
+        CHECK(mounts.isSkipped("/", "/home/user/data/dir", true));
+        CHECK(mounts.isSkipped("/home", "/home/user/remote/dir", true));
+        CHECK(!mounts.isSkipped("/", "/home/user/dir", true));
+        CHECK(!mounts.isSkipped("/home/user/data", "/home/user/data/dir", true));
+    }
+}
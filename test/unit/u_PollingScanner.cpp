@@ -0,0 +1,199 @@
+#include "catch_wrapper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "pfw/PollingScanner.h"
+#include "pfw/polling/PollingService.h"
+
+#include "testutil/FileSandbox.h"
+
+using namespace std::chrono_literals;
+using namespace pfw;
+
+namespace {
+
+bool isChange(const PollingScanner::Change &change,
+              EventType                     type,
+              const fs::path &              relativePath)
+{
+    return change.type == type && change.relativePath == relativePath;
+}
+
+bool containsChange(const std::vector<PollingScanner::Change> &changes,
+                    EventType                                  type,
+                    const fs::path &                           relativePath)
+{
+    return std::any_of(changes.begin(), changes.end(),
+                       [&](const PollingScanner::Change &change) {
+                           return isChange(change, type, relativePath);
+                       });
+}
+
+// moves the mtime of a directory out of the window in which it is not trusted
+void ageDirectory(const fs::path &path)
+{
+    fs::last_write_time(path, fs::file_time_type::clock::now() - 1h);
+}
+
+}  // namespace
+
+TEST_CASE("test the polling scanner", "[PollingScanner]")
+{
+    FileSandbox sandbox;
+
+    sandbox.createDirectory("dir");
+    sandbox.createDirectory("dir/sub");
+    sandbox.createFile("dir/file", std::string("content"));
+    sandbox.createFile("dir/sub/file", std::string("content"));
+    for (const auto &dir : {"", "dir", "dir/sub"}) {
+        ageDirectory(sandbox.path() / dir);
+    }
+
+    const size_t   concurrency = GENERATE(1, 4);
+    PollingScanner scanner(sandbox.path(), concurrency);
+    scanner.reset();
+    CHECK(scanner.directoryCount() == 3);
+    CHECK(scanner.scan().empty());
+
+    SECTION("modification in an unchanged directory")
+    {
+        sandbox.modifyFile("dir/sub/file", "modified content");
+
+        const auto changes = scanner.scan();
+        REQUIRE(changes.size() == 1);
+        CHECK(containsChange(changes, MODIFIED, "dir/sub/file"));
+    }
+
+    SECTION("creation and deletion")
+    {
+        sandbox.createFile("dir/sub/created");
+        sandbox.remove("dir/file");
+
+        const auto changes = scanner.scan();
+        CHECK(changes.size() == 2);
+        CHECK(containsChange(changes, CREATED, "dir/sub/created"));
+        CHECK(containsChange(changes, DELETED, "dir/file"));
+    }
+
+    SECTION("deleted directory")
+    {
+        sandbox.remove("dir/sub");
+
+        const auto changes = scanner.scan();
+        REQUIRE(changes.size() == 2);
+        CHECK(isChange(changes[0], DELETED, "dir/sub/file"));
+        CHECK(isChange(changes[1], DELETED, "dir/sub"));
+    }
+
+    SECTION("created directory")
+    {
+        sandbox.createDirectory("dir/new");
+        sandbox.createFile("dir/new/file");
+
+        const auto changes = scanner.scan();
+        REQUIRE(changes.size() == 2);
+        CHECK(isChange(changes[0], CREATED, "dir/new"));
+        CHECK(isChange(changes[1], CREATED, "dir/new/file"));
+        CHECK(scanner.directoryCount() == 4);
+    }
+
+    SECTION("renamed directory")
+    {
+        sandbox.rename("dir/sub", "dir/renamed");
+
+        const auto changes = scanner.scan();
+        REQUIRE(changes.size() == 2);
+        CHECK(isChange(changes[0], DELETED | RENAMED, "dir/sub"));
+        CHECK(isChange(changes[1], CREATED | RENAMED, "dir/renamed"));
+    }
+
+    SECTION("deleted file whose inode is reused")
+    {
+        // only the mtime tells the files of the same size apart
+        fs::last_write_time(sandbox.path() / "dir/file",
+                            fs::file_time_type::clock::now() - 1h);
+        scanner.scan();
+
+        sandbox.remove("dir/file");
+        sandbox.createFile("dir/created", std::string("content"));
+
+        const auto changes = scanner.scan();
+        REQUIRE(changes.size() == 2);
+        CHECK(isChange(changes[0], DELETED, "dir/file"));
+        CHECK(isChange(changes[1], CREATED, "dir/created"));
+    }
+
+    SECTION("replaced file")
+    {
+        sandbox.createFile("dir/other", std::string("content"));
+        sandbox.remove("dir/file");
+        sandbox.rename("dir/other", "dir/file");
+
+        const auto changes = scanner.scan();
+        CHECK(containsChange(changes, DELETED, "dir/file"));
+        CHECK(containsChange(changes, CREATED, "dir/file"));
+    }
+
+    SECTION("serialized snapshot")
+    {
+        std::string data;
+        scanner.serialize(data);
+
+        sandbox.createFile("dir/sub/created");
+        sandbox.modifyFile("dir/file", "modified content");
+
+        PollingScanner restored(sandbox.path(), concurrency);
+        REQUIRE(restored.deserialize(data.data(), data.size()));
+        CHECK(restored.directoryCount() == 3);
+
+        const auto changes = restored.scan();
+        CHECK(changes.size() == 2);
+        CHECK(containsChange(changes, CREATED, "dir/sub/created"));
+        CHECK(containsChange(changes, MODIFIED, "dir/file"));
+
+        CHECK(!restored.deserialize(data.data(), data.size() - 1));
+        CHECK(restored.directoryCount() == 0);
+    }
+}
+
+TEST_CASE("test the polling service", "[PollingService]")
+{
+    FileSandbox sandbox;
+    sandbox.createDirectory("watched");
+    sandbox.createDirectory("watched/excluded");
+
+    std::mutex            eventsMutex;
+    std::vector<EventPtr> events;
+    auto filter = std::make_shared<Filter>(
+        [&](std::vector<EventPtr> &&batch) {
+            std::lock_guard<std::mutex> lock(eventsMutex);
+            for (auto &event : batch) {
+                events.emplace_back(std::move(event));
+            }
+        },
+        FilterOptions{{}, {"excluded"}});
+
+    PollingService service(filter, sandbox.path() / "watched", 20ms);
+    REQUIRE(service.isWatching());
+
+    sandbox.createFile("watched/file");
+    sandbox.createFile("watched/excluded/file");
+    std::this_thread::sleep_for(200ms);
+
+    {
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        REQUIRE(events.size() == 1);
+        CHECK(events[0]->type == CREATED);
+        CHECK(events[0]->relativePath == "file");
+        CHECK(events[0]->root == sandbox.path() / "watched");
+        events.clear();
+    }
+
+    sandbox.remove("watched");
+    std::this_thread::sleep_for(200ms);
+    CHECK(!service.isWatching());
+}
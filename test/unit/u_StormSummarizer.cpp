@@ -0,0 +1,158 @@
+#include "catch_wrapper.h"
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "pfw/FileSystemWatcher.h"
+#include "pfw/StormSummarizer.h"
+#include "pfw/internal/definitions.h"
+#include "pfw/replay/ReplayBackend.h"
+
+#include "testutil/FileSandbox.h"
+
+using namespace std::chrono_literals;
+using namespace pfw;
+
+namespace {
+
+void add(std::vector<EventPtr> &events,
+         EventType              type,
+         const fs::path &       directory,
+         size_t                 count,
+         const fs::path &       root)
+{
+    for (size_t i = 0; i < count; ++i) {
+        events.emplace_back(std::make_unique<Event>(
+            type, directory / ("file" + std::to_string(i)), root));
+    }
+}
+
+std::vector<fs::path> paths(const std::vector<EventPtr> &events)
+{
+    std::vector<fs::path> result;
+    for (const auto &event : events) {
+        result.push_back(event->relativePath);
+    }
+    return result;
+}
+
+}  // namespace
+
+TEST_CASE("test the storm summarizer", "[StormSummarizer]")
+{
+    FileSandbox sandbox;
+    sandbox.createDirectory("checkout");
+    sandbox.createDirectory("checkout/src");
+    sandbox.createDirectory("checkout/doc");
+
+    SECTION("a quiet batch is left alone")
+    {
+        std::vector<EventPtr> events;
+        add(events, CREATED, "checkout/src", 4, sandbox.path());
+        StormSummarizer::summarize(events, 4);
+        CHECK(events.size() == 4);
+
+        StormSummarizer::summarize(events, 0);
+        CHECK(events.size() == 4);
+    }
+
+    SECTION("a storm becomes its lowest common directory")
+    {
+        std::vector<EventPtr> events;
+        add(events, MODIFIED, "", 2, sandbox.path());
+        add(events, CREATED, "checkout/src", 6, sandbox.path());
+        add(events, MODIFIED, "checkout/doc", 6, sandbox.path());
+        events.emplace_back(
+            std::make_unique<Event>(FAILED, "error", sandbox.path()));
+        StormSummarizer::summarize(events, 4);
+
+        REQUIRE(paths(events) ==
+                std::vector<fs::path>{"file0", "file1", "checkout", "error"});
+        CHECK(events[2]->type == (SUBTREE | MODIFIED));
+        CHECK(events[2]->root == sandbox.path());
+        CHECK(events[3]->type == FAILED);
+    }
+
+    SECTION("the siblings of a single storm are kept")
+    {
+        std::vector<EventPtr> events;
+        add(events, CREATED, "checkout/doc", 2, sandbox.path());
+        add(events, DELETED, "checkout/gone", 10, sandbox.path());
+        add(events, CREATED, "checkout/src", 2, sandbox.path());
+        StormSummarizer::summarize(events, 4);
+
+        REQUIRE(paths(events) ==
+                std::vector<fs::path>{"checkout/doc/file0",
+                                      "checkout/doc/file1", "checkout/gone",
+                                      "checkout/src/file0",
+                                      "checkout/src/file1"});
+        CHECK(events[2]->type == (SUBTREE | DELETED));
+    }
+
+    SECTION("the roots are summarized on their own")
+    {
+        std::vector<EventPtr> events;
+        add(events, CREATED, "checkout/src", 3, sandbox.path());
+        add(events, CREATED, "checkout/src", 3, "/other");
+        StormSummarizer::summarize(events, 4);
+        CHECK(events.size() == 6);
+    }
+
+    SECTION("a backend without a collector summarizes as well")
+    {
+        std::vector<EventPtr> events;
+
+        WatcherOptions options({}, BackendRegistry::REPLAY);
+        options.stormThreshold = 10;
+
+        FileSystemWatcher watcher(
+            sandbox.path(), 10ms,
+            [&](std::vector<EventPtr> &&batch) { events = std::move(batch); },
+            options);
+        auto *backend = dynamic_cast<ReplayBackend *>(watcher.backend());
+        REQUIRE(backend != nullptr);
+
+        std::vector<EventPtr> replayed;
+        add(replayed, CREATED, "checkout/src", 20, fs::path());
+        backend->replay(std::move(replayed));
+
+        REQUIRE(events.size() == 1);
+        CHECK(events[0]->type == (SUBTREE | MODIFIED));
+        CHECK(events[0]->relativePath == "checkout/src");
+    }
+
+#if !defined(PFW_USE_POLLING) && !defined(PFW_APPLE)
+    SECTION("the collector summarizes a storm")
+    {
+        std::mutex            eventsMutex;
+        std::vector<EventPtr> events;
+
+        WatcherOptions options;
+        options.stormThreshold = 10;
+
+        FileSystemWatcher watcher(
+            sandbox.path(), 300ms,
+            [&](std::vector<EventPtr> &&batch) {
+                std::lock_guard<std::mutex> lock(eventsMutex);
+                for (auto &event : batch) {
+                    events.emplace_back(std::move(event));
+                }
+            },
+            options);
+        std::this_thread::sleep_for(100ms);
+
+        for (int i = 0; i < 200; ++i) {
+            sandbox.createFile("checkout/src/file" + std::to_string(i));
+        }
+        std::this_thread::sleep_for(800ms);
+
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        REQUIRE(!events.empty());
+        CHECK(events.size() < 20);
+        CHECK(events[0]->type == (SUBTREE | MODIFIED));
+        CHECK(events[0]->relativePath == "checkout/src");
+    }
+#endif
+}
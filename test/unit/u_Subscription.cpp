@@ -0,0 +1,177 @@
+#include "catch_wrapper.h"
+
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+
+#include "pfw/FileSystemWatcher.h"
+#include "pfw/Subscription.h"
+#include "pfw/replay/ReplayBackend.h"
+
+#include "testutil/FileSandbox.h"
+
+using namespace std::chrono_literals;
+using namespace pfw;
+
+namespace {
+
+EventBatch batch(EventType type, const fs::path &root)
+{
+    auto events = std::make_shared<std::vector<SharedEvent>>();
+    events->emplace_back(std::make_shared<Event>(type, "file", root));
+    return events;
+}
+
+std::vector<EventPtr> events(EventType type, std::vector<fs::path> paths)
+{
+    std::vector<EventPtr> result;
+    for (const auto &path : paths) {
+        result.emplace_back(std::make_unique<Event>(type, path, "/root"));
+    }
+    return result;
+}
+
+// runs the scheduled tasks on request
+struct ManualExecutor {
+    std::vector<std::function<void()>> tasks;
+
+    std::function<void(std::function<void()>)> executor()
+    {
+        return [this](std::function<void()> task) {
+            tasks.push_back(std::move(task));
+        };
+    }
+
+    // the options of a subscription whose tasks are run by the executor
+    SubscriptionOptions options()
+    {
+        SubscriptionOptions result;
+        result.executor = executor();
+        return result;
+    }
+
+    void run()
+    {
+        auto pending = std::move(tasks);
+        tasks.clear();
+        for (auto &task : pending) {
+            task();
+        }
+    }
+};
+
+}  // namespace
+
+TEST_CASE("test the subscriptions", "[Subscription]")
+{
+    SECTION("a slow subscriber does not delay the others")
+    {
+        std::promise<void> release;
+        auto               released = release.get_future().share();
+        Subscription       slow(
+            [&](const EventBatch &) { released.wait(); });
+
+        std::mutex              receivedMutex;
+        std::condition_variable receivedCondition;
+        size_t                  received = 0;
+        Subscription            fast([&](const EventBatch &) {
+            std::lock_guard<std::mutex> lock(receivedMutex);
+            ++received;
+            receivedCondition.notify_all();
+        });
+
+        for (int i = 0; i < 3; ++i) {
+            const auto published = batch(CREATED, "/root");
+            slow.publish(published);
+            fast.publish(published);
+        }
+
+        std::unique_lock<std::mutex> lock(receivedMutex);
+        CHECK(receivedCondition.wait_for(lock, 2s,
+                                         [&]() { return received == 3; }));
+        lock.unlock();
+        release.set_value();
+    }
+
+    SECTION("a subscriber which falls behind receives an overflow")
+    {
+        ManualExecutor executor;
+        auto           options = executor.options();
+        options.capacity       = 2;
+
+        std::vector<EventBatch> received;
+        Subscription            subscription(
+            [&](const EventBatch &b) { received.push_back(b); }, options);
+
+        subscription.publish(batch(CREATED, "/a"));
+        subscription.publish(batch(CREATED, "/a"));
+        subscription.publish(batch(CREATED, "/b"));
+        const auto last = batch(CREATED, "/c");
+        subscription.publish(last);
+        REQUIRE(executor.tasks.size() == 1);
+        CHECK(subscription.dropped() == 3);
+
+        executor.run();
+        REQUIRE(received.size() == 2);
+        REQUIRE(received[0]->size() == 2);
+        CHECK((*received[0])[0]->type == BUFFER_OVERFLOW);
+        CHECK((*received[0])[0]->root == "/a");
+        CHECK((*received[0])[1]->root == "/b");
+        CHECK(received[1] == last);
+    }
+
+    SECTION("a closed subscription receives nothing")
+    {
+        ManualExecutor executor;
+        size_t         received = 0;
+        Subscription   subscription([&](const EventBatch &) { ++received; },
+                                  executor.options());
+
+        subscription.publish(batch(CREATED, "/root"));
+        subscription.close();
+        subscription.publish(batch(CREATED, "/root"));
+        executor.run();
+        CHECK(received == 0);
+    }
+
+    SECTION("the subscribers of a watcher share the batches")
+    {
+        FileSandbox    sandbox;
+        WatcherOptions options({}, BackendRegistry::REPLAY);
+
+        std::vector<EventPtr> delivered;
+        FileSystemWatcher     watcher(
+            sandbox.path(), 10ms,
+            [&](std::vector<EventPtr> &&events) {
+                delivered = std::move(events);
+            },
+            options);
+
+        ManualExecutor          executor;
+        std::vector<EventBatch> first;
+        std::vector<EventBatch> second;
+        watcher.subscribe([&](const EventBatch &b) { first.push_back(b); },
+                          executor.options());
+        auto subscription = watcher.subscribe(
+            [&](const EventBatch &b) { second.push_back(b); },
+            executor.options());
+
+        auto *backend = dynamic_cast<ReplayBackend *>(watcher.backend());
+        REQUIRE(backend != nullptr);
+        backend->replay(events(CREATED, {"a", "b"}));
+        executor.run();
+
+        CHECK(delivered.size() == 2);
+        REQUIRE(first.size() == 1);
+        REQUIRE(second.size() == 1);
+        CHECK(first[0] == second[0]);
+        CHECK((*first[0])[1]->relativePath == "b");
+
+        watcher.unsubscribe(subscription);
+        backend->replay(events(MODIFIED, {"a"}));
+        executor.run();
+        CHECK(first.size() == 2);
+        CHECK(second.size() == 1);
+    }
+}
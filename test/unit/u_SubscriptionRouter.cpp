@@ -0,0 +1,142 @@
+#include "catch_wrapper.h"
+
+#include <map>
+#include <string>
+
+#include "pfw/SubscriptionRouter.h"
+
+using namespace pfw;
+
+namespace {
+
+EventPtr event(EventType type, const fs::path &relativePath,
+               const fs::path &root = "/root")
+{
+    return std::make_unique<Event>(type, relativePath, root);
+}
+
+}  // namespace
+
+TEST_CASE("test the subscription router", "[SubscriptionRouter]")
+{
+    std::vector<std::function<void()>> tasks;
+    auto executor = [&](std::function<void()> task) {
+        tasks.push_back(std::move(task));
+    };
+
+    std::map<std::string, std::vector<EventBatch>> received;
+    SubscriptionRouter                             router;
+    std::vector<std::shared_ptr<Subscription>>     subscriptions;
+    auto subscribe = [&](const std::string &name, const fs::path &root,
+                         const fs::path &subtree) {
+        SubscriptionOptions options;
+        options.executor = executor;
+        options.root     = root;
+        options.subtree  = subtree;
+        subscriptions.push_back(std::make_shared<Subscription>(
+            [&, name](const EventBatch &batch) {
+                received[name].push_back(batch);
+            },
+            options));
+        router.add(subscriptions.back());
+    };
+    auto deliver = [&](std::vector<EventPtr> events) {
+        router.publish(events);
+        for (auto &task : tasks) {
+            task();
+        }
+        tasks.clear();
+    };
+    auto paths = [&](const std::string &name) {
+        std::vector<fs::path> result;
+        for (const auto &batch : received[name]) {
+            for (const auto &event : *batch) {
+                result.push_back(event->relativePath);
+            }
+        }
+        return result;
+    };
+
+    CHECK(router.empty());
+    subscribe("all", "", "");
+    subscribe("src", "/root", "src");
+    subscribe("linux", "", "src/linux");
+    subscribe("doc", "/root", "doc");
+    subscribe("other", "/other", "");
+    CHECK(!router.empty());
+
+    SECTION("each subscriber receives its part of the batch")
+    {
+        std::vector<EventPtr> events;
+        events.push_back(event(CREATED, "src/main.cpp"));
+        events.push_back(event(MODIFIED, "src/linux/inotify.cpp"));
+        events.push_back(event(MODIFIED, "src"));
+        events.push_back(event(DELETED, "doc"));
+        events.push_back(event(BUFFER_OVERFLOW, "", "/other"));
+        deliver(std::move(events));
+
+        CHECK(paths("all").size() == 5);
+        CHECK(paths("src") ==
+              std::vector<fs::path>{"src/main.cpp", "src/linux/inotify.cpp",
+                                    "src"});
+        // an overflow of any root might affect a subtree of every root
+        CHECK(paths("linux") ==
+              std::vector<fs::path>{"src/linux/inotify.cpp", ""});
+        CHECK(paths("doc") == std::vector<fs::path>{"doc"});
+        CHECK(paths("other") == std::vector<fs::path>{""});
+
+        // the events are shared, not copied per subscriber
+        CHECK((*received["src"][0])[0] == (*received["all"][0])[0]);
+    }
+
+    SECTION("a removed directory reaches the subtrees below it")
+    {
+        std::vector<EventPtr> events;
+        events.push_back(event(DELETED, "src"));
+        deliver(std::move(events));
+
+        CHECK(paths("src") == std::vector<fs::path>{"src"});
+        CHECK(paths("linux") == std::vector<fs::path>{"src"});
+        CHECK(paths("doc").empty());
+    }
+
+    SECTION("a rename reaches the subtrees of both paths")
+    {
+        std::vector<EventPtr> events;
+        events.push_back(event(RENAMED, "doc/moved.md"));
+        events.back()->previousPath = "src/moved.md";
+        deliver(std::move(events));
+
+        CHECK(paths("src") == std::vector<fs::path>{"doc/moved.md"});
+        CHECK(paths("doc") == std::vector<fs::path>{"doc/moved.md"});
+        CHECK(paths("linux").empty());
+    }
+
+    SECTION("failures reach every subscriber of their root")
+    {
+        std::vector<EventPtr> events;
+        events.push_back(event(FAILED, "watching failed"));
+        events.push_back(event(FAILED, "the service failed", ""));
+        deliver(std::move(events));
+
+        const std::vector<fs::path> both = {"watching failed",
+                                            "the service failed"};
+        CHECK(paths("src") == both);
+        CHECK(paths("linux") == both);
+        CHECK(paths("doc") == both);
+        CHECK(paths("other") == std::vector<fs::path>{"the service failed"});
+        CHECK(paths("all").size() == 2);
+    }
+
+    SECTION("a removed subscription receives nothing")
+    {
+        router.remove(subscriptions[1]);
+
+        std::vector<EventPtr> events;
+        events.push_back(event(CREATED, "src/main.cpp"));
+        deliver(std::move(events));
+
+        CHECK(paths("src").empty());
+        CHECK(paths("all").size() == 1);
+    }
+}
@@ -0,0 +1,111 @@
+#include "catch_wrapper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "pfw/FileSystemWatcher.h"
+#include "pfw/replay/ReplayBackend.h"
+
+#include "testutil/FileSandbox.h"
+
+using namespace std::chrono_literals;
+using namespace pfw;
+
+TEST_CASE("test the tree snapshot", "[TreeSnapshot]")
+{
+    FileSandbox sandbox;
+    sandbox.createDirectory("watched");
+    sandbox.createDirectory("watched/dir");
+    sandbox.createFile("watched/dir/modified", std::string("content"));
+    sandbox.createFile("watched/deleted");
+
+    std::mutex                   eventsMutex;
+    std::vector<EventPtr>        events;
+    std::vector<std::thread::id> threads;
+    auto                         callback = [&](std::vector<EventPtr> &&batch) {
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        threads.push_back(std::this_thread::get_id());
+        for (auto &event : batch) {
+            events.emplace_back(std::move(event));
+        }
+    };
+
+    WatcherOptions options;
+    options.snapshotPath = sandbox.path() / "snapshot";
+
+    SECTION("the changes while no watcher was running are reported")
+    {
+        {
+            FileSystemWatcher watcher(sandbox.path() / "watched", 10ms,
+                                      callback, options);
+            REQUIRE(watcher.isWatching());
+        }
+        REQUIRE(fs::exists(options.snapshotPath));
+
+        sandbox.createFile("watched/dir/created");
+        sandbox.modifyFile("watched/dir/modified", "modified content");
+        sandbox.remove("watched/deleted");
+
+        events.clear();
+        threads.clear();
+        FileSystemWatcher watcher(sandbox.path() / "watched", 10ms, callback,
+                                  options);
+        std::this_thread::sleep_for(200ms);
+
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        REQUIRE(events.size() == 3);
+        for (const auto &event : events) {
+            CHECK(event->root == sandbox.path() / "watched");
+        }
+        CHECK(std::any_of(events.begin(), events.end(),
+                          [](const EventPtr &event) {
+                              return event->type == CREATED &&
+                                     event->relativePath == "dir/created";
+                          }));
+        CHECK(std::any_of(events.begin(), events.end(),
+                          [](const EventPtr &event) {
+                              return event->type == MODIFIED &&
+                                     event->relativePath == "dir/modified";
+                          }));
+        CHECK(std::any_of(events.begin(), events.end(),
+                          [](const EventPtr &event) {
+                              return event->type == DELETED &&
+                                     event->relativePath == "deleted";
+                          }));
+        // the constructor does not invoke the callback
+        CHECK(std::find(threads.begin(), threads.end(),
+                        std::this_thread::get_id()) == threads.end());
+    }
+
+    SECTION("the backend is held back until the snapshot is delivered")
+    {
+        options.backend = BackendRegistry::REPLAY;
+        {
+            FileSystemWatcher watcher(sandbox.path() / "watched", 10ms,
+                                      callback, options);
+        }
+        REQUIRE(fs::exists(options.snapshotPath));
+
+        sandbox.createFile("watched/file");
+
+        events.clear();
+        FileSystemWatcher watcher(sandbox.path() / "watched", 10ms, callback,
+                                  options);
+        auto *backend = dynamic_cast<ReplayBackend *>(watcher.backend());
+        REQUIRE(backend != nullptr);
+
+        std::vector<EventPtr> live;
+        live.emplace_back(std::make_unique<Event>(DELETED, "file"));
+        backend->replay(std::move(live));
+        std::this_thread::sleep_for(200ms);
+
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        REQUIRE(events.size() == 2);
+        CHECK(events[0]->type == CREATED);
+        CHECK(events[0]->relativePath == "file");
+        CHECK(events[1]->type == DELETED);
+        CHECK(events[1]->relativePath == "file");
+    }
+}